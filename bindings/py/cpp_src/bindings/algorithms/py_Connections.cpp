@@ -106,6 +106,15 @@ R"(Compatibility Warning: This classes API is unstable and may change without wa
 
     py_Connections.def("reset", &Connections::reset);
 
+    py_Connections.def("setArenaStorage", &Connections::setArenaStorage,
+R"(Allocate the per segment and per cell lists from an arena instead of the heap.)",
+        py::arg("arena"));
+
+    py_Connections.def("getArenaStorage", &Connections::getArenaStorage);
+
+    py_Connections.def("compact", &Connections::compact,
+R"(Repack the per segment and per cell lists, returning unused memory to the system.)");
+
     py_Connections.def("computeActivity",
         [](Connections &self, SDR &activePresynapticCells, bool learn=true) {
             // Call the C++ method.
@@ -217,5 +226,16 @@ R"(Returns pair of:
      py::arg("file"), py::arg("fmt") = "BINARY",
      "Deserializes object from file. file: filename to read from.  fmt: format recorded by saveToFile(). ");
 
+    py_Connections.def("saveSnapshot",
+     static_cast<void (htm::Connections::*)(const std::string &) const>(&htm::Connections::saveSnapshot),
+     py::arg("file"),
+     R"(Saves to a snapshot file, which loads much faster than saveToFile() for large
+models.  Not portable between machines with a different byte order.)");
+
+    py_Connections.def("loadSnapshot",
+     static_cast<void (htm::Connections::*)(const std::string &)>(&htm::Connections::loadSnapshot),
+     py::arg("file"),
+     R"(Loads a snapshot file written by saveSnapshot().)");
+
   } // End function init_Connections
 }   // End namespace htm_ext
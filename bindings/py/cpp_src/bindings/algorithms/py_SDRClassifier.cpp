@@ -81,6 +81,7 @@ A larger alpha results in faster adaptation to the data.)",
             py::arg("alpha") = 0.001);
 
         py_Classifier.def("infer", &Classifier::infer,
+            py::call_guard<py::gil_scoped_release>(),
 R"(Compute the likelihoods for each category / bucket.
 
 Argument pattern is the SDR containing the active input bits.
@@ -88,12 +89,16 @@ Argument pattern is the SDR containing the active input bits.
 Returns the Probablility Distribution Function (PDF) of the categories.
 The PDF is a list of probablilities which sums to 1.  Each index in this list is
 a category label, and each value is the likelihood of the that category.
-Use "numpy.argmax" to find the category with the greatest probablility.)",
+Use "numpy.argmax" to find the category with the greatest probablility.
+
+infer() and learn() release the GIL. Several Classifiers may be used from
+different threads at once, but not one Classifier.)",
 
             py::arg("pattern"));
 
         py_Classifier.def("learn", 
           static_cast<void (htm::Classifier::*)(const htm::SDR&, const std::vector<UInt>&)>(&Classifier::learn),
+            py::call_guard<py::gil_scoped_release>(),
 R"(Learn from example data.
 Argument pattern is the SDR containing the active input bits.
 Argument classification is the current category or bucket index.
@@ -103,6 +108,7 @@ This may also be a list for when the input has multiple categories.)",
 
         py_Classifier.def("learn", 
           static_cast<void (htm::Classifier::*)(const htm::SDR&, UInt)>(&Classifier::learn),
+            py::call_guard<py::gil_scoped_release>(),
                 py::arg("pattern"),
                 py::arg("classification"));
                 
@@ -200,15 +206,20 @@ A larger alpha results in faster adaptation to the data.)",
 R"(For use with time series datasets.)");
 
         py_Predictor.def("infer", &Predictor::infer,
+            py::call_guard<py::gil_scoped_release>(),
 R"(Compute the likelihoods.
 
 Argument pattern is the SDR containing the active input bits.
 
 Returns a dictionary whos keys are prediction steps, and values are PDFs.
-See help(Classifier.infer) for details about PDFs.)",
+See help(Classifier.infer) for details about PDFs.
+
+Releases the GIL, as does learn(). One Predictor must not be used by several
+threads at once.)",
             py::arg("pattern"));
 
         py_Predictor.def("learn", static_cast<void (htm::Predictor::*)(UInt, const htm::SDR&, const std::vector<UInt>&)>(&Predictor::learn),
+            py::call_guard<py::gil_scoped_release>(),
 R"(Learn from example data.
 
 Argument recordNum is an incrementing integer for each record.
@@ -223,6 +234,7 @@ This may also be a list for when the input has multiple categories.)",
             py::arg("classification"));
 
         py_Predictor.def("learn", static_cast<void (htm::Predictor::*)(UInt, const htm::SDR&, UInt)>(&Predictor::learn),
+            py::call_guard<py::gil_scoped_release>(),
                 py::arg("recordNum"),
                 py::arg("pattern"),
                 py::arg("classification"));
@@ -32,6 +32,7 @@ PyBind11 bindings for SpatialPooler class
 
 #include <htm/algorithms/SpatialPooler.hpp>
 #include <htm/types/Sdr.hpp>
+#include <htm/utils/ThreadPool.hpp>
 
 #include "bindings/engine/py_utils.hpp"
 
@@ -256,6 +257,17 @@ Argument wrapAround boolean value that determines whether or not inputs
          static_cast<void (htm::SpatialPooler::*)(std::string, std::string)>(&htm::SpatialPooler::loadFromFile), 
          py::arg("file"), py::arg("fmt") = "BINARY",
          R"(Deserializes object from file. file: filename to read from.  fmt: format recorded by saveToFile(). )");
+
+       py_SpatialPooler.def("saveSnapshot",
+         static_cast<void (htm::SpatialPooler::*)(const std::string &) const>(&htm::SpatialPooler::saveSnapshot),
+         py::arg("file"),
+         R"(Saves to a snapshot file, which loads much faster than saveToFile() for large
+models.  Not portable between machines with a different byte order.)");
+
+       py_SpatialPooler.def("loadSnapshot",
+         static_cast<void (htm::SpatialPooler::*)(const std::string &)>(&htm::SpatialPooler::loadSnapshot),
+         py::arg("file"),
+         R"(Loads a snapshot file written by saveSnapshot().)");
 				
 
         // loadFromString, loads SP from a JSON encoded string produced by writeToString().
@@ -282,14 +294,22 @@ R"(See also standard library function: pickle.dumps(...))");
         // compute
         py_SpatialPooler.def("compute", [](SpatialPooler& self, const SDR& input, const bool learn, SDR& output)
             { 
-	      const auto& overlaps = self.compute( input, learn, output ); 
-	      return py::array_t<SynapseIdx>( overlaps.size(), overlaps.data());  
+	      const std::vector<SynapseIdx> *overlaps;
+	      {
+	        py::gil_scoped_release release;
+	        overlaps = &self.compute( input, learn, output );
+	      }
+	      return py::array_t<SynapseIdx>( overlaps->size(), overlaps->data());  
 	    },
 R"(
 This is the main workhorse method of the SpatialPooler class. This method
 takes an input SDR and computes the set of output active columns. If 'learn' is
 set to True, this method also performs learning.
 
+The GIL is released while computing, so that other Python threads can run.
+Different SpatialPooler instances may compute concurrently. A single instance,
+and the input and output SDRs, must not be used by another thread meanwhile.
+
 Argument input An SDR that comprises the input to the spatial pooler.  The size
         of the SDR must match total number of input bits implied by the
         constructor (also returned by the method getNumInputs).
@@ -313,6 +333,73 @@ Argument output An SDR representing the winning columns after
         py::arg("output")
         ); 
 
+        // computeBatch
+        py_SpatialPooler.def("computeBatch", [](SpatialPooler& self, py::array_t<Byte, py::array::c_style | py::array::forcecast> inputs)
+            {
+              NTA_CHECK(inputs.ndim() == 2) << "computeBatch: expected a 2D array of shape (samples, numInputs)";
+              const size_t numSamples = static_cast<size_t>(inputs.shape(0));
+              const size_t numInputs  = static_cast<size_t>(inputs.shape(1));
+              NTA_CHECK(numInputs == self.getNumInputs()) << "computeBatch: input has " << numInputs
+                                                          << " columns, expected " << self.getNumInputs();
+
+              std::vector<SDR> inputSDRs(numSamples, SDR({ self.getNumInputs() }));
+              const Byte *data = inputs.data();
+              for(size_t i = 0; i < numSamples; i++) {
+                inputSDRs[i].setDense(SDR_dense_t(data + i * numInputs, data + (i + 1) * numInputs));
+              }
+
+              std::vector<SDR> outputSDRs;
+              {
+                py::gil_scoped_release release;
+                self.computeBatch(inputSDRs, outputSDRs);
+              }
+
+              const size_t numColumns = self.getNumColumns();
+              py::array_t<Byte> result({ numSamples, numColumns });
+              Byte *out = result.mutable_data();
+              for(size_t i = 0; i < numSamples; i++) {
+                const auto &dense = outputSDRs[i].getDense();
+                std::copy(dense.begin(), dense.end(), out + i * numColumns);
+              }
+              return result;
+            },
+R"(
+Batch inference, without learning. Computes the active columns for each row
+of inputs, with the same results as calling compute(input, False, output) for
+each row in order. The rows are processed in parallel when setNumThreads() was
+called with more than one thread. Releases the GIL like compute().
+
+Only the iteration counter changes; duty cycles, boost factors and
+permanences are not updated.
+
+Argument inputs A 2D array of shape (samples, numInputs), the dense input of
+        each sample.
+
+Returns a 2D uint8 array of shape (samples, numColumns), the dense active
+        columns of each sample.
+)",
+        py::arg("inputs"));
+
+        py_SpatialPooler.def("computeBatch", [](SpatialPooler& self, const std::vector<SDR>& inputs)
+            {
+              std::vector<SDR> outputs;
+              {
+                py::gil_scoped_release release;
+                self.computeBatch(inputs, outputs);
+              }
+              return outputs;
+            },
+R"(Batch inference on a list of input SDRs, returns a list of active column SDRs.)",
+        py::arg("inputs"));
+
+        py_SpatialPooler.def("setNumThreads", [](SpatialPooler& self, UInt numThreads)
+            {
+              self.setThreadPool(numThreads != 1u ? std::make_shared<ThreadPool>(numThreads) : nullptr);
+            },
+R"(Number of threads used by computeBatch() and for computing the overlaps.
+1 (default) runs serially, 0 uses one thread per core.)",
+        py::arg("numThreads"));
+
         // setBoostFactors
         py_SpatialPooler.def("setBoostFactors", [](SpatialPooler& self, py::array& x)
         {
@@ -185,6 +185,17 @@ Argument anomalyMode (optional, default ANMode::RAW) selects mode for `TM.anomal
          py::arg("file"), py::arg("fmt") = "BINARY",
          R"(Deserializes object from file. file: filename to read from.  fmt: format recorded by saveToFile(). )");
 
+       py_HTM.def("saveSnapshot",
+         static_cast<void (htm::TemporalMemory::*)(const std::string &) const>(&htm::TemporalMemory::saveSnapshot),
+         py::arg("file"),
+         R"(Saves to a snapshot file, which loads much faster than saveToFile() for large
+models.  Not portable between machines with a different byte order.)");
+
+       py_HTM.def("loadSnapshot",
+         static_cast<void (htm::TemporalMemory::*)(const std::string &)>(&htm::TemporalMemory::loadSnapshot),
+         py::arg("file"),
+         R"(Loads a snapshot file written by saveSnapshot().)");
+
         // writeToString, save TM to a JSON encoded string usable by loadFromString()
         py_HTM.def("writeToString", [](const TemporalMemory& self)
         {
@@ -244,18 +255,24 @@ dendrite segments.  Grow and reinforce synapses.)"
 
         py_HTM.def("compute", [](HTM_t& self, const SDR &activeColumns, bool learn)
             { self.compute(activeColumns, learn); },
+                py::call_guard<py::gil_scoped_release>(),
                 py::arg("activeColumns"),
                 py::arg("learn") = true);
 
         py_HTM.def("compute", [](HTM_t& self, const SDR &activeColumns, bool learn,
                                  const SDR &externalPredictiveInputsActive, const SDR &externalPredictiveInputsWinners)
             { self.compute(activeColumns, learn, externalPredictiveInputsActive, externalPredictiveInputsWinners); },
+                py::call_guard<py::gil_scoped_release>(),
 R"(Perform one time step of the Temporal Memory algorithm.
 
 This method calls activateDendrites, then calls activateCells. Using
 the TemporalMemory via its compute method ensures that you'll always
 be able to call getActiveCells at the end of the time step.
 
+The GIL is released during compute. Separate TemporalMemory instances can
+run on separate Python threads; one instance and its input SDRs must only
+be used by one thread at a time.
+
 Argument activeColumns
     SDR of active mini-columns.
 
@@ -192,8 +192,12 @@ namespace htm_ext
                 }
               }, "Create an Array object from an SDR object.", 
                  py::arg("sdr"), py::arg("copy")=true)
-            .def("getSDR", [](Array& self){ return self.getSDR(); 
-              },  "Returns an SDR object if the Array contains type SDR.");
+            .def("getSDR", [](Array& self){
+                // A view of the SDR in the buffer, which keeps the buffer alive.
+                return std::shared_ptr<SDR>(&self.getSDR(), [keepAlive = self](SDR*) {});
+              },
+R"(Returns the SDR object if the Array contains type SDR.
+This is not a copy, the SDR shares its data with the Array.)");
 
 
 
@@ -255,7 +259,8 @@ namespace htm_ext
             .def("askImplForOutputDimensions", &Region::askImplForOutputDimensions)
             .def("askImplForInputDimensions", &Region::askImplForInputDimensions);
                         
-        // These return the buffer's Array object
+        // These return the buffer's Array object. The Array shares the buffer,
+        // use numpy.asarray(array) for a view of it without copying.
         py_Region.def("getInputArray", &Region::getInputData)
             .def("getOutputArray", &Region::getOutputData);
             
@@ -451,12 +456,34 @@ namespace htm_ext
             .def("setPhases",          &htm::Network::setPhases)
             .def("getExecutionMap",    &htm::Network::getExecutionMap);
             
-        py_Network.def("run", (void (htm::Network::*)(int n)) &htm::Network::run
-             , "Executes all phases n times."
+        // run() releases the GIL. Initialization calls into the Python
+        // regions, it is done first while holding the GIL. Python regions
+        // take the GIL back in compute().
+        py_Network.def("run", [](htm::Network &self, int n) {
+                self.initialize();
+                py::gil_scoped_release release;
+                self.run(n);
+             }
+             , R"(Executes all phases n times.
+
+The GIL is released while running, except in regions written in Python.
+Different Networks may run concurrently on Python threads. A Network must not
+be used by another thread while it runs.)"
              , py::arg("n"));
-        py_Network.def("run", (void (htm::Network::*)(int n, std::vector<UInt32> phases)) &htm::Network::run
-             , "Execute a set of phases in the given order, repeating n times."
+        py_Network.def("run", [](htm::Network &self, int n, std::vector<UInt32> phases) {
+                self.initialize();
+                py::gil_scoped_release release;
+                self.run(n, phases);
+             }
+             , "Execute a set of phases in the given order, repeating n times. Releases the GIL like run(n)."
              , py::arg("n"), py::arg("phases"));
+
+        py_Network.def("setNumThreads", [](htm::Network &self, UInt numThreads) {
+                self.setThreadPool(numThreads != 1u ? std::make_shared<ThreadPool>(numThreads) : nullptr);
+             }
+             , R"(Number of threads used by run() to compute independent regions at once.
+1 (default) runs serially, 0 uses one thread per core.)"
+             , py::arg("numThreads"));
              
 
         py_Network.def("initialize", &htm::Network::initialize);
@@ -506,8 +533,6 @@ namespace htm_ext
                 else NTA_THROW << "setInputData(): Unexpected data type in the array!  info.format=" << info.format;
                 // for info.format codes, see https://docs.python.org/3.7/library/array.html
                 Array s(type, info.ptr, size);
-                std::cout << "src: " << s << std::endl;
-
                 net.setInputData(name, s);
             });
             
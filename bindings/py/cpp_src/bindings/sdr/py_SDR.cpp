@@ -151,7 +151,7 @@ current value.)");
                 }
                 return py::array(self->dimensions, strides, self->getDense().data(), destructor);
             },
-            [](SDR &self, py::array_t<Byte> dense) {
+            [](SDR &self, py::array_t<Byte, py::array::c_style | py::array::forcecast> dense) {
                 py::buffer_info buf = dense.request();
                 if( buf.ndim == 1 ) {
                     NTA_CHECK( (UInt) buf.shape[0] == self.size )
@@ -176,7 +176,10 @@ This format allows random-access queries of the SDRs values.
 
 After modifying this array you MUST assign the array back into the SDR, in order
 to notify the SDR that its dense array has changed and its cached data is out of
-date.  If you did't copy this data, then SDR won't copy either.)");
+date.  If you did't copy this data, then SDR won't copy either.
+
+Non contiguous arrays and arrays of other types than uint8 are converted before
+they are copied into the SDR.)");
 
         py_SDR.def_property("sparse",
             [](shared_ptr<SDR> self) {
@@ -185,9 +188,37 @@ date.  If you did't copy this data, then SDR won't copy either.)");
                         delete reinterpret_cast<shared_ptr<SDR>*>(keepAlive); });
                 return py::array(self->getSum(), self->getSparse().data(), destructor);
             },
-            [](SDR &self, SDR_sparse_t data) {
-                NTA_CHECK( data.size() <= self.size );
-                // Sort data and check for duplicates.
+            [](SDR &self, py::object value) {
+                const py::array sparse = py::array::ensure( value );
+                if( ! sparse )
+                    throw py::type_error("Sparse data must be an array of integers!");
+                NTA_CHECK( sparse.ndim() == 1 ) << "Sparse data must be one dimensional!";
+                NTA_CHECK( (UInt) sparse.shape(0) <= self.size );
+                // Only integers are accepted, other types would be truncated
+                // or wrap around.  An empty list converts to a float array.
+                const char kind = sparse.dtype().kind();
+                if( sparse.size() > 0 && kind != 'u' && kind != 'i' )
+                    throw py::type_error("Sparse data must be integers!");
+                SDR_sparse_t data( sparse.shape(0) );
+                if( py::isinstance<py::array_t<ElemSparse, py::array::c_style>>( sparse )) {
+                    // Copy straight out of the numpy buffer, and swap into the SDR.
+                    const ElemSparse *begin = (const ElemSparse*) sparse.data();
+                    std::copy( begin, begin + data.size(), data.begin() );
+                }
+                else {
+                    const auto values = py::array_t<Int64, py::array::c_style | py::array::forcecast>::ensure( sparse );
+                    NTA_CHECK( values ) << "Sparse data must be integers!";
+                    const Int64 *v = values.data();
+                    for( size_t i = 0; i < data.size(); i++ ) {
+                        const Int64 idx = v[i];
+                        if( idx < 0 )
+                            throw py::type_error("Sparse data must not be negative!");
+                        NTA_CHECK( (UInt64) idx < self.size )
+                            << "Index " << idx << " out of bounds of the SDR of size " << self.size;
+                        data[i] = (ElemSparse) idx;
+                    }
+                }
+                // Sort data and check for duplicates and bounds.
                 if( ! is_sorted( data.begin(), data.end() ))
                     sort( data.begin(), data.end() );
                 UInt previous = -1;
@@ -196,11 +227,17 @@ date.  If you did't copy this data, then SDR won't copy either.)");
                         << "Sparse data must not contain duplicates!";
                     previous = idx;
                 }
+                NTA_CHECK( data.empty() || data.back() < self.size )
+                    << "Index " << data.back() << " out of bounds of the SDR of size " << self.size;
                 self.setSparse( data ); },
 R"(A numpy array containing the indices of only the true values in the SDR.
 These are indices into the flattened SDR. This format allows for quickly
 accessing all of the true bits in the SDR.
 
+Reading returns a view of the SDR's data, not a copy. Assigning a contiguous
+numpy array of uint32 copies it once, other integer arrays and lists are
+converted first.  Negative and non integer indices raise a TypeError.
+
 Sparse data must contain no duplicates.)");
 
         py_SDR.def_property("coordinates",
@@ -147,9 +147,11 @@ Argument period is time constant for exponential moving average.)",
 
         py_ActivationFrequency.def_property_readonly("activationFrequency",
             [](const ActivationFrequency &self) {
-                auto capsule = py::capsule(&self, [](void *self) {});
-                return py::array(self.activationFrequency.size(), self.activationFrequency.data(), capsule); },
-                    "Data Buffer of Activation Frequencies");
+                const auto &frequencies = self.getActivationFrequency();
+                return py::array(frequencies.size(), frequencies.data()); },
+R"(Activation Frequencies, a new array with the current values each time the
+property is read.  The frequencies are computed when read, the array does not
+change as more data is added.)");
         py_ActivationFrequency.def( "min",     &ActivationFrequency::min, "Minimum of Activation Frequencies");
         py_ActivationFrequency.def( "max",     &ActivationFrequency::max, "Maximum of Activation Frequencies");
         py_ActivationFrequency.def( "mean",    &ActivationFrequency::mean,"Average of Activation Frequencies" );
@@ -0,0 +1,157 @@
+/* ----------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+#include <bindings/suppress_register.hpp>  //include before pybind11.h
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+
+#include <sstream>
+
+#include <htm/types/SdrIndex.hpp>
+
+namespace py = pybind11;
+
+using namespace std;
+using namespace htm;
+
+namespace htm_ext
+{
+    // Matches as a list of (id, overlap) tuples.
+    static py::list toList(const vector<SdrIndex::Match> &matches)
+    {
+        py::list out;
+        for( const auto &m : matches )
+            out.append( py::make_tuple( m.id, m.overlap ) );
+        return out;
+    }
+
+    void init_SdrIndex(py::module& m)
+    {
+        py::class_<SdrIndex> py_SdrIndex(m, "SdrIndex",
+R"(Stores SDRs and finds the stored SDRs which have the largest overlap with a
+query SDR.
+
+The index keeps, for every bit, the list of the stored SDRs which have that bit
+active.  A query only visits the lists of its own active bits, so it is much
+faster than comparing the query with every stored SDR.
+
+Stored SDRs are identified by the id returned from add().  Ids are not reused
+after remove().
+
+Example Usage:
+    index = SdrIndex( [1000] )
+    A = SDR( 1000 ).randomize( 0.02 )
+    a = index.add( A )
+    index.query( A, k = 10 )  ->  [(a, 20)]
+)");
+
+        py_SdrIndex.def( py::init<vector<UInt>>(),
+R"(Argument dimensions of the SDRs which will be stored.)",
+            py::arg("dimensions"));
+
+        py_SdrIndex.def_property_readonly( "dimensions",
+            [](const SdrIndex &self) { return self.dimensions(); },
+            "Dimensions of the stored SDRs.");
+
+        py_SdrIndex.def( "__len__", &SdrIndex::size,
+            "Number of SDRs currently stored.");
+
+        py_SdrIndex.def( "__contains__", &SdrIndex::contains,
+            "True if the id refers to a stored SDR.");
+
+        py_SdrIndex.def( "add", &SdrIndex::add,
+R"(Stores a copy of the given SDR.  Returns the id of the stored SDR.)",
+            py::arg("sdr"));
+
+        py_SdrIndex.def( "remove", &SdrIndex::remove,
+R"(Removes a stored SDR.  Argument id was returned by add().)",
+            py::arg("id"));
+
+        py_SdrIndex.def( "getSparse", [](const SdrIndex &self, UInt id) {
+                const auto &sparse = self.getSparse( id );
+                return py::array_t<ElemSparse>( sparse.size(), sparse.data() );
+            },
+R"(Returns the indices of the active bits of a stored SDR.)",
+            py::arg("id"));
+
+        py_SdrIndex.def( "query", [](const SdrIndex &self, const SDR &sdr, UInt k, UInt minOverlap) {
+                vector<SdrIndex::Match> matches;
+                {
+                    py::gil_scoped_release release;
+                    matches = self.query( sdr, k, minOverlap );
+                }
+                return toList( matches );
+            },
+R"(Finds the stored SDRs with the largest overlap with the query.
+
+Argument sdr is the query, it must have the same size as the stored SDRs.
+Argument k is the maximum number of matches to return.
+Argument minOverlap, stored SDRs with a smaller overlap are not returned.
+
+Returns a list of up to k (id, overlap) tuples, by decreasing overlap and then
+by id.
+
+Releases the GIL.  Queries may run concurrently from several threads, but
+the index must not be modified (add, remove, loading) while a query runs.)",
+            py::arg("sdr"), py::arg("k"), py::arg("minOverlap") = 1u);
+
+        py_SdrIndex.def( "queryBatch", [](const SdrIndex &self, const vector<SDR> &sdrs, UInt k, UInt minOverlap) {
+                vector<vector<SdrIndex::Match>> results;
+                {
+                    py::gil_scoped_release release;
+                    results = self.queryBatch( sdrs, k, minOverlap );
+                }
+                py::list out;
+                for( const auto &matches : results )
+                    out.append( toList( matches ) );
+                return out;
+            },
+R"(Runs query() for each SDR in the list, in parallel when setNumThreads() was
+called with more than one thread.  Returns a list with the result of each
+query.
+
+Releases the GIL.  The index must not be modified (add, remove, loading)
+while a batch runs.)",
+            py::arg("sdrs"), py::arg("k"), py::arg("minOverlap") = 1u);
+
+        py_SdrIndex.def( "setNumThreads", [](SdrIndex &self, UInt numThreads) {
+                self.setThreadPool( numThreads != 1u ? std::make_shared<ThreadPool>(numThreads) : nullptr );
+            },
+R"(Number of threads used by queryBatch().
+1 (default) runs serially, 0 uses one thread per core.)",
+            py::arg("numThreads"));
+
+        py_SdrIndex.def( "__eq__", [](const SdrIndex &self, const SdrIndex &other)
+            { return self == other; });
+        py_SdrIndex.def( "__ne__", [](const SdrIndex &self, const SdrIndex &other)
+            { return self != other; });
+
+        py_SdrIndex.def(py::pickle(
+            [](const SdrIndex& self) {
+                std::stringstream ss;
+                self.save(ss);
+                return py::bytes(ss.str());
+        },
+            [](const py::bytes& s) {
+                std::istringstream ss(s);
+                SdrIndex self;
+                self.load(ss);
+                return self;
+        }));
+    }
+}
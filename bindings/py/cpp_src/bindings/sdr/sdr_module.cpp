@@ -30,6 +30,7 @@ namespace htm_ext
 {
     void init_SDR(py::module&);
     void init_SDR_Metrics(py::module&);
+    void init_SdrIndex(py::module&);
 
 } // namespace htm_ext
 
@@ -38,4 +39,5 @@ using namespace htm_ext;
 PYBIND11_MODULE(sdr, m) {
     init_SDR(m);
     init_SDR_Metrics(m);
+    init_SdrIndex(m);
 }
@@ -650,6 +650,8 @@ namespace py = pybind11;
 
     void PyBindRegion::compute()
     {
+        // Network.run() releases the GIL, and may call this from a worker thread.
+        py::gil_scoped_acquire gil;
         const Spec& ns = nodeSpec_;
 
         // Prepare the inputs dict
@@ -18,6 +18,7 @@
 import unittest
 import pytest
 import sys
+import os
 
 from htm.bindings.sdr import SDR
 from htm.bindings.math import Random
@@ -436,7 +437,35 @@ class ConnectionsTest(unittest.TestCase):
     n = co.numConnectedSynapses(seg) #uses dataForSegment()
     co.destroySegment(seg)
     self.assertEqual(co.numSegments(), 0, "segment should have been removed")
-    
+
+  def testSnapshot(self):
+    co = Connections(NUM_CELLS, 0.51)
+    random = Random(42)
+    for cell in range(0, NUM_CELLS, 16):
+      seg = co.createSegment(cell, 1)
+      for presyn in random.sample(np.arange(1024, dtype="uint32"), 20):
+        co.createSynapse(seg, presyn, random.getReal64())
+    co.destroySegment(co.segmentsForCell(16)[0])
+    inputSDR = SDR(1024).randomize(.1)
+    co.computeActivity(inputSDR, True)
+
+    file = "connections_test_snapshot.bin"
+    co.saveSnapshot(file)
+    co2 = Connections(1, 0.5)
+    co2.loadSnapshot(file)
+    os.remove(file)
+    self.assertEqual(str(co), str(co2))
+    self.assertEqual(co.numSegments(), co2.numSegments())
+    self.assertEqual(co.numSynapses(), co2.numSynapses())
+    self.assertTrue(np.array_equal(co.computeActivity(inputSDR, False),
+                                   co2.computeActivity(inputSDR, False)))
+
+    # A file which is not a snapshot is rejected.
+    with open(file, "wb") as f:
+      f.write(b"not a snapshot" * 10)
+    with pytest.raises(RuntimeError):
+      co2.loadSnapshot(file)
+    os.remove(file)
 
 
 
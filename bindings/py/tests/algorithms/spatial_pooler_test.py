@@ -244,6 +244,60 @@ class SpatialPoolerTest(unittest.TestCase):
      self.assertEqual(str(sp), str(sp3), "HTM SpatialPooler serialization (using saveToFile/loadFromFile) failed.")
      os.remove(file)
 
+  def testSpatialPoolerSnapshot(self):
+     inputs = SDR( 100 ).randomize( .05 )
+     active = SDR( 100 )
+     sp = SP( inputs.dimensions, active.dimensions, stimulusThreshold = 1 )
+     for _ in range(10):
+       sp.compute( inputs, True, active )
+
+     file = "spatial_pooler_test_snapshot.bin"
+     sp.saveSnapshot(file)
+     sp2 = SP()
+     sp2.loadSnapshot(file)
+     os.remove(file)
+     self.assertEqual(str(sp), str(sp2))
+
+
+  def testComputeBatch(self):
+    """ Check that computeBatch matches calling compute without learning. """
+    inputs = [SDR( 100 ).randomize( .1 ) for _ in range(20)]
+    sp = SP( [100], [200], stimulusThreshold = 1, seed = 42 )
+    ref = SP( [100], [200], stimulusThreshold = 1, seed = 42 )
+    sp.setNumThreads( 4 )
+
+    batch = np.array([x.dense for x in inputs], dtype=np.uint8)
+    out = sp.computeBatch( batch )
+    self.assertEqual( out.shape, (20, 200) )
+
+    active = SDR( 200 )
+    for i, x in enumerate(inputs):
+      ref.compute( x, False, active )
+      self.assertTrue( np.array_equal( out[i], active.dense ) )
+    self.assertEqual( sp.getIterationNum(), ref.getIterationNum() )
+
+  def testComputeOnThreads(self):
+    """ Independent SPs learn on Python threads, compute releases the GIL. """
+    import threading
+    inputs = [SDR( 100 ).randomize( .1 ) for _ in range(50)]
+
+    def run(sp, results):
+      active = SDR( 200 )
+      for x in inputs:
+        sp.compute( x, True, active )
+        results.append( list(active.sparse) )
+
+    serial = []
+    run( SP( [100], [200], stimulusThreshold = 1, seed = 42 ), serial )
+
+    results = [[] for _ in range(4)]
+    threads = [threading.Thread( target = run, args = (SP( [100], [200], stimulusThreshold = 1, seed = 42 ), r) )
+               for r in results]
+    for t in threads: t.start()
+    for t in threads: t.join()
+    for r in results:
+      self.assertEqual( r, serial )
+
 
 if __name__ == "__main__":
   unittest.main()
@@ -131,6 +131,25 @@ class TemporalMemoryBindingsTest(unittest.TestCase):
     self.assertEqual(str(tm), str(tm3), "TemporalMemory serialization (using saveToFile/loadFromFile) failed.")
     os.remove(file)
 
+  def testTemporalMemorySnapshot(self):
+    inputs = SDR( 100 ).randomize( .05 )
+    tm = TM( inputs.dimensions )
+    for _ in range(10):
+      tm.compute( inputs, True )
+
+    file = "temporalMemory_test_snapshot.bin"
+    tm.saveSnapshot(file)
+    tm2 = TM()
+    tm2.loadSnapshot(file)
+    os.remove(file)
+    self.assertEqual(str(tm), str(tm2))
+
+    # Both continue identically.
+    inputs.addNoise( .5 )
+    tm.compute( inputs, True )
+    tm2.compute( inputs, True )
+    self.assertEqual(tm.getActiveCells(), tm2.getActiveCells())
+
   def testPredictiveCells(self):
     """
     This tests that we don't get empty predicitve cells
@@ -325,6 +325,12 @@ class NetworkTest(unittest.TestCase):
     #print(EXPECTED_RESULT3)
     self.assertTrue(np.array_equal(sdr.sparse, EXPECTED_RESULT3))
 
+    # The SDR of an output is a view of the output buffer, not a copy.
+    sdr = sp.getOutputArray("bottomUpOut").getSDR()
+    encoder.setParameterReal64("sensedValue", -0.8)
+    net.run(1)
+    self.assertTrue(np.array_equal(sdr.sparse, sp.getOutputArray("bottomUpOut").getSDR().sparse))
+
   def testExecuteCommand1(self):
     """
     Check to confirm that the ExecuteCommand( ) funtion works.
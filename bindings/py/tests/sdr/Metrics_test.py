@@ -93,6 +93,17 @@ Entropy 0.918296""")
         decay = 1. - alpha
         assert( np.all( AF.activationFrequency == .02 * decay + alpha ))
 
+    def testAF_arrayIsCopy(self):
+        X  = sdr.SDR( 2 )
+        AF = sdr.ActivationFrequency( X, period = 10 )
+        X.sparse = [0]
+        before = AF.activationFrequency
+        values = before.copy()
+        X.sparse = [1]
+        AF.activationFrequency # Reading again does not change the first array.
+        assert( np.all( before == values ))
+        assert( AF.activationFrequency[1] > values[1] )
+
     def testOverlapExample(self):
         A = sdr.SDR( dimensions = 2000 )
         B = sdr.Overlap( A, period = 1000 )
@@ -131,6 +131,11 @@ class SdrTest(unittest.TestCase):
         A.dense = np.zeros( A.size, dtype=np.int8 )
         A.dense = [1] * A.size
         B.dense = [[[1]] * 100 for _ in range(100)]
+        # Test assign non contiguous data.
+        data = np.zeros( 2 * A.size, dtype=np.uint8 )
+        data[ 2 * 5 ] = 1
+        A.dense = data[::2]
+        assert( list(A.sparse) == [5] )
 
     def testDenseInplace(self):
         # Check that assigning dense data to itself (ie: sdr.dense = sdr.dense)
@@ -160,6 +165,30 @@ class SdrTest(unittest.TestCase):
         B.sparse = []
         assert( not B.dense.any() )
 
+        # Test assign numpy data, of the same and of other types.
+        B.sparse = np.array([9, 3, 7], dtype=np.uint32)
+        assert( list(B.sparse) == [3, 7, 9] )
+        B.sparse = np.array([1, 2], dtype=np.int64)
+        assert( list(B.sparse) == [1, 2] )
+        try:
+            B.sparse = [1, 1]
+        except RuntimeError:
+            pass
+        else:
+            self.fail()
+
+        # Test negative, non integer and out of bounds indices.
+        with self.assertRaises(TypeError):
+            B.sparse = [-1]
+        with self.assertRaises(TypeError):
+            B.sparse = np.array([-1], dtype=np.int32)
+        with self.assertRaises(TypeError):
+            B.sparse = [2.7]
+        with self.assertRaises(RuntimeError):
+            B.sparse = [B.size]
+        with self.assertRaises(RuntimeError):
+            B.sparse = np.array([B.size], dtype=np.uint32)
+
         # Test wrong dimensions assigned
         C = SDR( 1000 )
         C.randomize( .98 )
@@ -0,0 +1,62 @@
+# ----------------------------------------------------------------------
+# HTM Community Edition of NuPIC
+# Copyright (C) 2020, Numenta, Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero Public License version 3 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU Affero Public License for more details.
+#
+# You should have received a copy of the GNU Affero Public License
+# along with this program.  If not, see http://www.gnu.org/licenses.
+# ----------------------------------------------------------------------
+
+"""Unit tests for SdrIndex python bindings"""
+
+import pickle
+import unittest
+
+from htm.bindings.sdr import SDR, SdrIndex
+
+class SdrIndexTest(unittest.TestCase):
+    def testExampleUsage(self):
+        index = SdrIndex( [10] )
+        A = SDR( 10 ); A.sparse = [0, 1, 2, 3]
+        B = SDR( 10 ); B.sparse = [2, 3, 4, 5]
+        a = index.add( A )
+        b = index.add( B )
+        assert(len(index) == 2)
+        Q = SDR( 10 ); Q.sparse = [1, 2, 3, 4]
+        assert(index.query( Q, k = 10 ) == [(a, 3), (b, 3)])
+        assert(index.query( Q, k = 10, minOverlap = 4 ) == [])
+        index.remove( a )
+        assert(a not in index)
+        assert(index.query( Q, 1 ) == [(b, 3)])
+        assert(list(index.getSparse( b )) == [2, 3, 4, 5])
+
+    def testQueryBatch(self):
+        index = SdrIndex( [1000] )
+        stored = [SDR( 1000 ).randomize( 0.05 ) for _ in range(100)]
+        for sdr in stored:
+            index.add( sdr )
+        queries = [SDR( 1000 ).randomize( 0.05 ) for _ in range(10)]
+        index.setNumThreads( 4 )
+        results = index.queryBatch( queries, k = 3 )
+        assert(len(results) == len(queries))
+        for query, matches in zip(queries, results):
+            assert(matches == index.query( query, k = 3 ))
+            for id, overlap in matches:
+                assert(overlap == query.getOverlap( stored[id] ))
+
+    def testPickle(self):
+        index = SdrIndex( [100] )
+        for _ in range(5):
+            index.add( SDR( 100 ).randomize( 0.1 ) )
+        index.remove( 2 )
+        copy = pickle.loads( pickle.dumps( index ))
+        assert(copy == index)
+        assert(len(copy) == 4)
@@ -56,6 +56,11 @@
 //       Execute a predefined command on a region. <command> must start with the
 //       command name followed by the arguments.
 //       The data could also be in the body.
+//  PUT  /network/<id>/profile?action=<enable|disable|reset>
+//       Turn profiling of all regions and links on or off, or reset it.
+//  GET  /network/<id>/profile?format=<JSON|PROMETHEUS>
+//       Get the latency histograms of the regions and links. The PROMETHEUS
+//       format can be scraped directly by a Prometheus server.
 //
 //  GET  /hi
 //       Respond with "Hello World\n" as a way to check client to server connection.
@@ -296,6 +301,39 @@ public:
       res.set_content(result + "\n", "application/json");
     });
 
+    //  PUT  /network/<id>/profile?action=<enable|disable|reset>
+    //       Turn profiling of all regions and links on or off, or reset it.
+    svr.Put("/network/.*/profile", [](const Request &req, Response &res) {
+      std::vector<std::string> flds = Path::split(req.path, '/');
+      std::string id = flds[2];
+      std::string action = req.body;
+      auto ix = req.params.find("action");
+      if (ix != req.params.end())
+        action = ix->second;
+
+      RESTapi *interface = RESTapi::getInstance();
+      std::string result = interface->put_profile_request(id, action);
+      res.set_content(result + "\n", "application/json");
+    });
+
+    //  GET  /network/<id>/profile?format=<JSON|PROMETHEUS>
+    //       Get the latency histograms of the regions and links.
+    svr.Get("/network/.*/profile", [](const Request &req, Response &res) {
+      std::vector<std::string> flds = Path::split(req.path, '/');
+      std::string id = flds[2];
+      std::string format = "JSON";
+      auto ix = req.params.find("format");
+      if (ix != req.params.end())
+        format = ix->second;
+
+      RESTapi *interface = RESTapi::getInstance();
+      std::string result = interface->get_profile_request(id, format);
+      if (result.compare(0, 1, "{") == 0)
+        res.set_content(result + "\n", "application/json");
+      else
+        res.set_content(result, "text/plain; version=0.0.4");
+    });
+
     //  GET /stop
     //    Halt the server.
     svr.Get("/stop", [&](const Request & /*req*/, Response & /*res*/) { svr.stop(); });
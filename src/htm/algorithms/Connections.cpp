@@ -25,7 +25,14 @@
 #include <iostream>
 #include <set>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #include <htm/algorithms/Connections.hpp>
+#include <htm/types/Snapshot.hpp>
 
 
 using std::endl;
@@ -36,6 +43,255 @@ using namespace htm;
 
 //!using Permanence = UInt16; //TODO try this optimization, overrides Permanence(=Real) from Connections.hpp 
 
+
+/**
+ * Vectorized permanence update for a whole segment.
+ *
+ * Adds updates[i] to permanences[i], clips the result to
+ * [minPermanence, maxPermanence] and sets crossed[i] iff the synapse moved
+ * across the connected threshold.
+ *
+ * Uses AVX (8 lanes) or SSE2 (4 lanes) when the compiler targets them, with
+ * a scalar loop for the tail and for other platforms. All variants perform
+ * the same single precision add/min/max, so the results are bit-identical.
+ */
+static void adaptPermanences(Permanence *permanences,
+                               const Permanence *updates,
+                               Byte *crossed,
+                               const size_t size,
+                               const Permanence connectedThreshold) {
+  size_t i = 0u;
+#if defined(__AVX__)
+  const __m256 lo  = _mm256_set1_ps(minPermanence);
+  const __m256 hi  = _mm256_set1_ps(maxPermanence);
+  const __m256 thr = _mm256_set1_ps(connectedThreshold);
+  for(; i + 8u <= size; i += 8u) {
+    const __m256 before = _mm256_loadu_ps(permanences + i);
+    const __m256 after  = _mm256_min_ps(_mm256_max_ps(
+                            _mm256_add_ps(before, _mm256_loadu_ps(updates + i)), lo), hi);
+    _mm256_storeu_ps(permanences + i, after);
+    const int flips = _mm256_movemask_ps(_mm256_cmp_ps(before, thr, _CMP_GE_OQ)) ^
+                      _mm256_movemask_ps(_mm256_cmp_ps(after,  thr, _CMP_GE_OQ));
+    for(size_t k = 0u; k < 8u; k++) {
+      crossed[i + k] = static_cast<Byte>((flips >> k) & 1);
+    }
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128 lo  = _mm_set1_ps(minPermanence);
+  const __m128 hi  = _mm_set1_ps(maxPermanence);
+  const __m128 thr = _mm_set1_ps(connectedThreshold);
+  for(; i + 4u <= size; i += 4u) {
+    const __m128 before = _mm_loadu_ps(permanences + i);
+    const __m128 after  = _mm_min_ps(_mm_max_ps(
+                            _mm_add_ps(before, _mm_loadu_ps(updates + i)), lo), hi);
+    _mm_storeu_ps(permanences + i, after);
+    const int flips = _mm_movemask_ps(_mm_cmpge_ps(before, thr)) ^
+                      _mm_movemask_ps(_mm_cmpge_ps(after,  thr));
+    for(size_t k = 0u; k < 4u; k++) {
+      crossed[i + k] = static_cast<Byte>((flips >> k) & 1);
+    }
+  }
+#endif
+  for(; i < size; i++) {
+    const Permanence before = permanences[i];
+    Permanence after = before + updates[i];
+    after = std::min(after, maxPermanence);
+    after = std::max(after, minPermanence);
+    permanences[i] = after;
+    crossed[i] = static_cast<Byte>((before >= connectedThreshold) != (after >= connectedThreshold));
+  }
+}
+
+
+/**
+ * PresynapticIndex
+ */
+static constexpr const UInt32 MIN_BUCKET_CAPACITY = 4u;
+
+Synapse PresynapticIndex::push_back(const CellIdx cell, const Synapse synapse, const Segment segment) {
+  if(cell >= buckets_.size()) {
+    buckets_.resize(static_cast<size_t>(cell) + 1u);
+  }
+  if(buckets_[cell].size == buckets_[cell].capacity) {
+    grow_(cell);
+  }
+  Bucket &bucket = buckets_[cell];
+  synapses_[bucket.offset + bucket.size] = synapse;
+  segments_[bucket.offset + bucket.size] = segment;
+  return bucket.size++;
+}
+
+
+Synapse PresynapticIndex::remove(const CellIdx cell, const Synapse index) {
+  NTA_ASSERT(cell < buckets_.size());
+  Bucket &bucket = buckets_[cell];
+  NTA_ASSERT(index < bucket.size);
+
+  const size_t last = bucket.offset + bucket.size - 1u;
+  const Synapse move = synapses_[last];
+  synapses_[bucket.offset + index] = move;
+  segments_[bucket.offset + index] = segments_[last];
+  bucket.size--;
+  return move;
+}
+
+
+void PresynapticIndex::grow_(const CellIdx cell) {
+  Bucket &bucket = buckets_[cell];
+  const UInt32 capacity = std::max(MIN_BUCKET_CAPACITY, bucket.capacity * 2u);
+
+  if(bucket.offset + bucket.capacity == synapses_.size()) {
+    // The bucket is at the end of the pool, it can grow in place.
+    synapses_.resize(bucket.offset + capacity);
+    segments_.resize(bucket.offset + capacity);
+  }
+  else {
+    // Move the bucket to the end of the pool.
+    const size_t offset = synapses_.size();
+    synapses_.resize(offset + capacity);
+    segments_.resize(offset + capacity);
+    std::copy_n(synapses_.begin() + bucket.offset, bucket.size, synapses_.begin() + offset);
+    std::copy_n(segments_.begin() + bucket.offset, bucket.size, segments_.begin() + offset);
+    holes_ += bucket.capacity;
+    bucket.offset = offset;
+  }
+  bucket.capacity = capacity;
+
+  if(holes_ > synapses_.size() / 2u) {
+    compact();
+  }
+}
+
+
+void PresynapticIndex::compact() {
+  size_t total = 0u;
+  for(const auto &bucket : buckets_) {
+    total += bucket.capacity;
+  }
+  vector<Synapse> synapses(total);
+  vector<Segment> segments(total);
+
+  size_t offset = 0u;
+  for(auto &bucket : buckets_) {
+    std::copy_n(synapses_.begin() + bucket.offset, bucket.size, synapses.begin() + offset);
+    std::copy_n(segments_.begin() + bucket.offset, bucket.size, segments.begin() + offset);
+    bucket.offset = offset;
+    offset += bucket.capacity;
+  }
+  synapses_.swap(synapses);
+  segments_.swap(segments);
+  holes_ = 0u;
+}
+
+
+void PresynapticIndex::clear() {
+  buckets_.clear();
+  synapses_.clear();
+  segments_.clear();
+  holes_ = 0u;
+}
+
+
+size_t PresynapticIndex::numPresynapticCells() const {
+  return std::count_if(buckets_.cbegin(), buckets_.cend(), [](const Bucket &b) { return b.size > 0u; });
+}
+
+
+void PresynapticIndex::toLists(Lists<Synapse> &synapses, Lists<Segment> &segments) const {
+  synapses.clear();
+  segments.clear();
+  for(CellIdx cell = 0u; cell < buckets_.size(); cell++) {
+    if(buckets_[cell].size == 0u) continue;
+    const auto syns = this->synapses(cell);
+    const auto segs = this->segments(cell);
+    synapses[cell].assign(syns.begin(), syns.end());
+    segments[cell].assign(segs.begin(), segs.end());
+  }
+}
+
+
+void PresynapticIndex::fromLists(const Lists<Synapse> &synapses, const Lists<Segment> &segments) {
+  NTA_CHECK(synapses.size() == segments.size()) << "PresynapticIndex: mismatched synapse and segment lists.";
+  clear();
+
+  // Lay the buckets out in the order of the presynaptic cells.
+  size_t numCells = 0u;
+  size_t total    = 0u;
+  for(const auto &it : synapses) {
+    numCells = std::max(numCells, static_cast<size_t>(it.first) + 1u);
+    total   += it.second.size();
+  }
+  buckets_.resize(numCells);
+  synapses_.resize(total);
+  segments_.resize(total);
+
+  size_t offset = 0u;
+  for(CellIdx cell = 0u; cell < numCells; cell++) {
+    const auto syns = synapses.find(cell);
+    if(syns == synapses.end()) continue;
+    const auto found = segments.find(cell);
+    NTA_CHECK(found != segments.end())
+        << "PresynapticIndex: cell " << cell << " has synapses but no segment list.";
+    const auto &segs = found->second;
+    NTA_CHECK(syns->second.size() == segs.size()) << "PresynapticIndex: mismatched synapse and segment lists.";
+
+    Bucket &bucket  = buckets_[cell];
+    bucket.offset   = offset;
+    bucket.size     = static_cast<UInt32>(segs.size());
+    bucket.capacity = bucket.size;
+    std::copy(syns->second.begin(), syns->second.end(), synapses_.begin() + offset);
+    std::copy(segs.begin(), segs.end(), segments_.begin() + offset);
+    offset += bucket.capacity;
+  }
+}
+
+
+void PresynapticIndex::saveSnapshot(SnapshotWriter &snapshot, const std::string &prefix) const {
+  snapshot.add(prefix + "buckets",  buckets_);
+  snapshot.add(prefix + "synapses", synapses_);
+  snapshot.add(prefix + "segments", segments_);
+  snapshot.addValue(prefix + "holes", static_cast<UInt64>(holes_));
+}
+
+
+void PresynapticIndex::loadSnapshot(const SnapshotReader &snapshot, const std::string &prefix) {
+  snapshot.read(prefix + "buckets",  buckets_);
+  snapshot.read(prefix + "synapses", synapses_);
+  snapshot.read(prefix + "segments", segments_);
+  holes_ = static_cast<size_t>(snapshot.getValue<UInt64>(prefix + "holes"));
+  NTA_CHECK(synapses_.size() == segments_.size()) << "PresynapticIndex: mismatched synapse and segment lists.";
+  // The buckets must lie inside the pool, without overlapping each other.
+  vector<const Bucket *> byOffset;
+  byOffset.reserve(buckets_.size());
+  for(const auto &bucket : buckets_) {
+    NTA_CHECK(bucket.size <= bucket.capacity && bucket.offset <= synapses_.size() &&
+              bucket.capacity <= synapses_.size() - bucket.offset)
+        << "PresynapticIndex: corrupt snapshot.";
+    if(bucket.capacity > 0u) byOffset.push_back(&bucket);
+  }
+  std::sort(byOffset.begin(), byOffset.end(),
+            [](const Bucket *a, const Bucket *b) { return a->offset < b->offset; });
+  for(size_t i = 1u; i < byOffset.size(); i++) {
+    NTA_CHECK(byOffset[i - 1u]->offset + byOffset[i - 1u]->capacity <= byOffset[i]->offset)
+        << "PresynapticIndex: corrupt snapshot, overlapping buckets.";
+  }
+}
+
+
+bool PresynapticIndex::operator==(const PresynapticIndex &o) const {
+  const size_t numCells = std::max(buckets_.size(), o.buckets_.size());
+  for(CellIdx cell = 0u; cell < numCells; cell++) {
+    const auto a = synapses(cell);
+    const auto b = o.synapses(cell);
+    if(a.size() != b.size() or not std::equal(a.begin(), a.end(), b.begin())) return false;
+    const auto c = segments(cell);
+    const auto d = o.segments(cell);
+    if(not std::equal(c.begin(), c.end(), d.begin())) return false;
+  }
+  return true;
+}
+
+
 Connections::Connections(const CellIdx numCells, 
 		         const Permanence connectedThreshold, 
 			 const bool timeseries) {
@@ -51,8 +307,6 @@ void Connections::initialize(CellIdx numCells, Permanence connectedThreshold, bo
   destroyedSynapses_.clear();
   potentialSynapsesForPresynapticCell_.clear();
   connectedSynapsesForPresynapticCell_.clear();
-  potentialSegmentsForPresynapticCell_.clear();
-  connectedSegmentsForPresynapticCell_.clear();
   eventHandlers_.clear();
   NTA_CHECK(connectedThreshold >= minPermanence);
   NTA_CHECK(connectedThreshold <= maxPermanence);
@@ -114,7 +368,7 @@ Segment Connections::createSegment(const CellIdx cell,
   NTA_ASSERT(numSegments(cell) <= maxSegmentsPerCell);
 
   // Proceed to create a new segment.
-  const SegmentData& segmentData = SegmentData(cell);
+  const SegmentData& segmentData = SegmentData(cell, allocator_);
   Segment segment;
   if (!destroyedSegments_.empty() ) { //reuse old, destroyed segs
     segment = destroyedSegments_.back();
@@ -152,21 +406,21 @@ Synapse Connections::createSynapse(Segment segment,
   // That would give such input a stronger connection.
   // Synapses are supposed to have binary effects (0 or 1) but duplicate synapses give
   // them (synapses 0/1) varying levels of strength.
-  for (const Synapse& syn : synapsesForSegment(segment)) {
-    const CellIdx existingPresynapticCell = dataForSynapse(syn).presynapticCell; //TODO 1; add way to get all presynaptic cells for segment (fast)
-    if (presynapticCell == existingPresynapticCell) {
-      //synapse (connecting to this presyn cell) already exists on the segment; don't create a new one, exit early and return the existing
-      NTA_ASSERT(synapseExists_(syn));
-      //TODO what is the strategy on creating a new synapse, while the same already exists (on the same segment, presynapticCell) ??
-      //1. just keep the older (former default)
-      //2. throw an error (ideally, user should not createSynapse() but rather updateSynapsePermanence())
-      //3. create a duplicit new synapse -- NO. This is the only choice that is incorrect! HTM works on binary synapses, duplicates would break that.
-      //4. update to the max of the permanences (default)
-
-      auto& synData = synapses_[syn];
-      if(permanence > synData.permanence) updateSynapsePermanence(syn, permanence);
-      return syn;
-    }
+  const auto &existingPresynapticCells = segments_[segment].presynapticCells;
+  const auto existing = std::find(existingPresynapticCells.cbegin(), existingPresynapticCells.cend(), presynapticCell);
+  if (existing != existingPresynapticCells.cend()) {
+    const Synapse syn = segments_[segment].synapses[std::distance(existingPresynapticCells.cbegin(), existing)];
+    //synapse (connecting to this presyn cell) already exists on the segment; don't create a new one, exit early and return the existing
+    NTA_ASSERT(synapseExists_(syn));
+    //TODO what is the strategy on creating a new synapse, while the same already exists (on the same segment, presynapticCell) ??
+    //1. just keep the older (former default)
+    //2. throw an error (ideally, user should not createSynapse() but rather updateSynapsePermanence())
+    //3. create a duplicit new synapse -- NO. This is the only choice that is incorrect! HTM works on binary synapses, duplicates would break that.
+    //4. update to the max of the permanences (default)
+
+    auto& synData = synapses_[syn];
+    if(permanence > synData.permanence) updateSynapsePermanence(syn, permanence);
+    return syn;
   } //else: the new synapse is not duplicit, so keep creating it. 
 
   // Get an index into the synapses_ list, for the new synapse to reside at.
@@ -189,12 +443,13 @@ Synapse Connections::createSynapse(Segment segment,
   // Start in disconnected state.
   synapseData.permanence           = connectedThreshold_ - static_cast<Permanence>(1.0);
   synapseData.presynapticMapIndex_ = 
-    (Synapse)potentialSynapsesForPresynapticCell_[presynapticCell].size();
-  potentialSynapsesForPresynapticCell_[presynapticCell].push_back(synapse);
-  potentialSegmentsForPresynapticCell_[presynapticCell].push_back(segment);
+    potentialSynapsesForPresynapticCell_.push_back(presynapticCell, synapse, segment);
 
   SegmentData &segmentData = segments_[segment];
+  synapseData.segmentIndex_ = static_cast<Synapse>(segmentData.synapses.size());
   segmentData.synapses.push_back(synapse);
+  segmentData.presynapticCells.push_back(presynapticCell);
+  segmentData.permanences.push_back(synapseData.permanence);
 
 
   for (auto h : eventHandlers_) {
@@ -216,7 +471,7 @@ bool Connections::synapseExists_(const Synapse synapse, bool fast) const {
   if(!fast) {
   //proper but slow method to check for valid, existing synapse
   const SynapseData &synapseData = synapses_[synapse];
-  const vector<Synapse> &synapsesOnSegment =
+  const auto &synapsesOnSegment =
       segments_[synapseData.segment].synapses;
   const bool found = (std::find(synapsesOnSegment.begin(), synapsesOnSegment.end(), synapse) != synapsesOnSegment.end());
   //validate the fast & slow methods for same result:
@@ -239,20 +494,11 @@ bool Connections::synapseExists_(const Synapse synapse, bool fast) const {
  */
 void Connections::removeSynapseFromPresynapticMap_(
     const Synapse index,
-    vector<Synapse> &preSynapses,
-    vector<Segment> &preSegments)
+    const CellIdx presynapticCell,
+    PresynapticIndex &presynapticIndex)
 {
-  NTA_ASSERT( !preSynapses.empty() );
-  NTA_ASSERT( index < preSynapses.size() );
-  NTA_ASSERT( preSynapses.size() == preSegments.size() );
-
-  const auto move = preSynapses.back();
+  const auto move = presynapticIndex.remove(presynapticCell, index);
   synapses_[move].presynapticMapIndex_ = index;
-  preSynapses[index] = move;
-  preSynapses.pop_back();
-
-  preSegments[index] = preSegments.back();
-  preSegments.pop_back();
 }
 
 
@@ -296,33 +542,27 @@ void Connections::destroySynapse(const Synapse synapse) {
 
     removeSynapseFromPresynapticMap_(
       synapseData.presynapticMapIndex_,
-      connectedSynapsesForPresynapticCell_.at( presynCell ),
-      connectedSegmentsForPresynapticCell_.at( presynCell ));
-
-    if( connectedSynapsesForPresynapticCell_.at( presynCell ).empty() ){
-      connectedSynapsesForPresynapticCell_.erase( presynCell );
-      connectedSegmentsForPresynapticCell_.erase( presynCell );
-    }
+      presynCell,
+      connectedSynapsesForPresynapticCell_);
   }
   else {
     removeSynapseFromPresynapticMap_(
       synapseData.presynapticMapIndex_,
-      potentialSynapsesForPresynapticCell_.at( presynCell ),
-      potentialSegmentsForPresynapticCell_.at( presynCell ));
-
-    if( potentialSynapsesForPresynapticCell_.at( presynCell ).empty() ){
-      potentialSynapsesForPresynapticCell_.erase( presynCell );
-      potentialSegmentsForPresynapticCell_.erase( presynCell );
-    }
+      presynCell,
+      potentialSynapsesForPresynapticCell_);
   }
 
-  for(auto i = 0u; i < segmentData.synapses.size(); i++) {
-    if (segmentData.synapses[i] == synapse) {
-      segmentData.synapses[i] = segmentData.synapses.back();
-      segmentData.synapses.pop_back();
-      break;
-    }
-  }
+  // Swap the last synapse of the segment into the hole.
+  const auto i = synapseData.segmentIndex_;
+  NTA_ASSERT(segmentData.synapses[i] == synapse);
+  const Synapse moved = segmentData.synapses.back();
+  segmentData.synapses[i]         = moved;
+  segmentData.presynapticCells[i] = segmentData.presynapticCells.back();
+  segmentData.permanences[i]      = segmentData.permanences.back();
+  synapses_[moved].segmentIndex_  = i;
+  segmentData.synapses.pop_back();
+  segmentData.presynapticCells.pop_back();
+  segmentData.permanences.pop_back();
 
   destroyedSynapses_.push_back(synapse);
 }
@@ -340,51 +580,70 @@ void Connections::updateSynapsePermanence(const Synapse synapse,
 
   // update the permanence
   synData.permanence = permanence;
+  segments_[synData.segment].permanences[synData.segmentIndex_] = permanence;
 
   if( before == after ) { //no change in dis/connected status
       return;
   }
+  updateConnected_(synapse, after);
+
+  for (auto h : eventHandlers_) { //TODO handle callbacks in performance-critical method only in Debug?
+    h.second->onUpdateSynapsePermanence(synapse, permanence);
+  }
+}
+
+
+void Connections::updateConnected_(const Synapse synapse, const bool connected) {
+    auto &synData         = synapses_[synapse];
     const auto &presyn    = synData.presynapticCell;
-    auto &potentialPresyn = potentialSynapsesForPresynapticCell_[presyn];
-    auto &potentialPreseg = potentialSegmentsForPresynapticCell_[presyn];
-    auto &connectedPresyn = connectedSynapsesForPresynapticCell_[presyn];
-    auto &connectedPreseg = connectedSegmentsForPresynapticCell_[presyn];
     const auto &segment   = synData.segment;
     auto &segmentData     = segments_[segment];
-    
-    if( after ) { //connect
+
+    if( connected ) { //connect
       segmentData.numConnected++;
 
       // Remove this synapse from presynaptic potential synapses.
       removeSynapseFromPresynapticMap_( synData.presynapticMapIndex_,
-                                        potentialPresyn, potentialPreseg );
+                                        presyn, potentialSynapsesForPresynapticCell_ );
 
       // Add this synapse to the presynaptic connected synapses.
-      synData.presynapticMapIndex_ = (Synapse)connectedPresyn.size();
-      connectedPresyn.push_back( synapse );
-      connectedPreseg.push_back( segment );
+      synData.presynapticMapIndex_ = connectedSynapsesForPresynapticCell_.push_back( presyn, synapse, segment );
     }
     else { //disconnected
       segmentData.numConnected--;
 
       // Remove this synapse from presynaptic connected synapses.
       removeSynapseFromPresynapticMap_( synData.presynapticMapIndex_,
-                                        connectedPresyn, connectedPreseg );
+                                        presyn, connectedSynapsesForPresynapticCell_ );
 
       // Add this synapse to the presynaptic connected synapses.
-      synData.presynapticMapIndex_ = (Synapse)potentialPresyn.size();
-      potentialPresyn.push_back( synapse );
-      potentialPreseg.push_back( segment );
+      synData.presynapticMapIndex_ = potentialSynapsesForPresynapticCell_.push_back( presyn, synapse, segment );
     }
+}
 
-    for (auto h : eventHandlers_) { //TODO handle callbacks in performance-critical method only in Debug?
-      h.second->onUpdateSynapsePermanence(synapse, permanence);
-    }
+
+void Connections::rebuildSegmentArrays_(const Segment segment) {
+  auto &segData = segments_[segment];
+  segData.presynapticCells.resize(segData.synapses.size());
+  segData.permanences.resize(segData.synapses.size());
+  for(size_t i = 0u; i < segData.synapses.size(); i++) {
+    auto &synData = synapses_[segData.synapses[i]];
+    synData.segmentIndex_       = static_cast<Synapse>(i);
+    segData.presynapticCells[i] = synData.presynapticCell;
+    segData.permanences[i]      = synData.permanence;
+  }
+}
+
+
+void Connections::rebuildSegmentArrays_() {
+  for(Segment segment = 0u; segment < segments_.size(); segment++) {
+    rebuildSegmentArrays_(segment);
+  }
 }
 
 
 SegmentIdx Connections::idxOnCellForSegment(const Segment segment) const {
-  const vector<Segment> &segments = segmentsForCell(cellForSegment(segment));
+  const auto &segments = segmentsForCell(cellForSegment(segment));
   const auto it = std::find(segments.begin(), segments.end(), segment);
   NTA_ASSERT(it != segments.end());
   return (SegmentIdx)std::distance(segments.begin(), it);
@@ -405,15 +664,11 @@ bool Connections::compareSegments(const Segment a, const Segment b) const {
 vector<Synapse> Connections::synapsesForPresynapticCell(const CellIdx presynapticCell) const {
   vector<Synapse> all;
 
-  if (potentialSynapsesForPresynapticCell_.count(presynapticCell)) {
-    const auto& potential = potentialSynapsesForPresynapticCell_.at(presynapticCell);
-    all.assign(potential.cbegin(), potential.cend());
-  }
+  const auto potential = potentialSynapsesForPresynapticCell_.synapses(presynapticCell);
+  all.assign(potential.begin(), potential.end());
 
-  if (connectedSynapsesForPresynapticCell_.count(presynapticCell)) {
-    const auto& connected = connectedSynapsesForPresynapticCell_.at(presynapticCell);
-    all.insert( all.cend(), connected.cbegin(), connected.cend());
-  }
+  const auto connected = connectedSynapsesForPresynapticCell_.synapses(presynapticCell);
+  all.insert( all.cend(), connected.begin(), connected.end());
 
   return all;
 }
@@ -431,23 +686,11 @@ void Connections::reset() noexcept
 vector<SynapseIdx> Connections::computeActivity(const vector<CellIdx> &activePresynapticCells, const bool learn) {
 
   vector<SynapseIdx> numActiveConnectedSynapsesForSegment(segments_.size(), 0);
-  if(learn) iteration_++;
-
-  if( timeseries_ ) {
-    // Before each cycle of computation move the currentUpdates to the previous
-    // updates, and zero the currentUpdates in preparation for learning.
-    previousUpdates_.swap( currentUpdates_ );
-    currentUpdates_.clear();
-  }
+  startComputeActivity_(learn);
 
   // Iterate through all connected synapses.
-  for (const auto& cell : activePresynapticCells) {
-    if (connectedSegmentsForPresynapticCell_.count(cell)) {
-      for(const auto& segment : connectedSegmentsForPresynapticCell_.at(cell)) {
-        ++numActiveConnectedSynapsesForSegment[segment];
-      }
-    }
-  }
+  countActiveSynapses_(connectedSynapsesForPresynapticCell_, activePresynapticCells,
+                       numActiveConnectedSynapsesForSegment);
   return numActiveConnectedSynapsesForSegment;
 }
 
@@ -467,17 +710,235 @@ vector<SynapseIdx> Connections::computeActivity(
              numActiveConnectedSynapsesForSegment.end(),
              numActivePotentialSynapsesForSegment.begin());
 
+  countActiveSynapses_(potentialSynapsesForPresynapticCell_, activePresynapticCells,
+                       numActivePotentialSynapsesForSegment);
+  return numActiveConnectedSynapsesForSegment;
+}
+
+
+vector<SynapseIdx> Connections::countActiveSynapses(const vector<CellIdx> &activePresynapticCells) const {
+  vector<SynapseIdx> numActiveConnectedSynapsesForSegment(segments_.size(), 0);
   for (const auto& cell : activePresynapticCells) {
-    if (potentialSegmentsForPresynapticCell_.count(cell)) {
-      for(const auto& segment : potentialSegmentsForPresynapticCell_.at(cell)) {
-        ++numActivePotentialSynapsesForSegment[segment];
-      }
+    for(const auto segment : connectedSynapsesForPresynapticCell_.segments(cell)) {
+      ++numActiveConnectedSynapsesForSegment[segment];
     }
   }
   return numActiveConnectedSynapsesForSegment;
 }
 
 
+void Connections::startComputeActivity_(const bool learn) {
+  if(learn) iteration_++;
+
+  if( timeseries_ ) {
+    // Before each cycle of computation move the currentUpdates to the previous
+    // updates, and zero the currentUpdates in preparation for learning.
+    previousUpdates_.swap( currentUpdates_ );
+    currentUpdates_.clear();
+  }
+}
+
+
+void Connections::setArenaStorage(const bool arena) {
+  if( arena == getArenaStorage() ) return;
+  relocateLists_(arena ? SlabAllocator<char>(new SlabArena()) : SlabAllocator<char>());
+}
+
+
+void Connections::compact() {
+  relocateLists_(getArenaStorage() ? SlabAllocator<char>(new SlabArena()) : SlabAllocator<char>());
+  potentialSynapsesForPresynapticCell_.compact();
+  connectedSynapsesForPresynapticCell_.compact();
+}
+
+
+void Connections::relocateLists_(const SlabAllocator<char> &allocator) {
+  vector<SegmentData> segments;
+  segments.reserve(segments_.size());
+  for(const auto &segData : segments_) { //also the destroyed ones, they keep their cell
+    segments.emplace_back(segData.cell, allocator);
+    segments.back().numConnected = segData.numConnected;
+  }
+
+  // Lay out the lists cell by cell, so that the segments of a cell are close.
+  vector<CellData> cells(cells_.size());
+  for(size_t cell = 0u; cell < cells_.size(); cell++) {
+    const auto &from = cells_[cell].segments;
+    cells[cell].segments.assign(from.begin(), from.end());
+    for(const auto segment : from) {
+      const SegmentData &src = segments_[segment];
+      SegmentData       &dst = segments[segment];
+      dst.synapses.assign(src.synapses.begin(), src.synapses.end());
+      dst.presynapticCells.assign(src.presynapticCells.begin(), src.presynapticCells.end());
+      dst.permanences.assign(src.permanences.begin(), src.permanences.end());
+    }
+  }
+
+  allocator_ = allocator;
+  cells_.swap(cells);
+  segments_.swap(segments);
+  //the old lists are freed here, and with them the old arena
+}
+
+
+void Connections::computeActivitySparse(vector<SynapseIdx> &numActiveConnectedSynapsesForSegment,
+                                        vector<SynapseIdx> &numActivePotentialSynapsesForSegment,
+                                        vector<Segment> &touchedSegments,
+                                        const vector<CellIdx> &activePresynapticCells,
+                                        const bool learn) {
+  startComputeActivity_(learn);
+
+  // Clear the counts of the previous call, only where they can be non zero.
+  const size_t numSegments = segments_.size();
+  for(const auto segment : touchedSegments) {
+    if( segment < numActiveConnectedSynapsesForSegment.size() ) numActiveConnectedSynapsesForSegment[segment] = 0u;
+    if( segment < numActivePotentialSynapsesForSegment.size() ) numActivePotentialSynapsesForSegment[segment] = 0u;
+  }
+  touchedSegments.clear();
+  numActiveConnectedSynapsesForSegment.resize(numSegments, 0u);
+  numActivePotentialSynapsesForSegment.resize(numSegments, 0u);
+
+  // With a thread pool and enough synapses to visit, the dense parallel
+  // count followed by a scan of all segments is faster. Same rule as in
+  // countActiveSynapses_().
+  size_t work = 0u;
+  if( threadPool_ and threadPool_->numThreads() > 1u ) {
+    for(const auto cell : activePresynapticCells) {
+      work += connectedSynapsesForPresynapticCell_.size(cell) +
+              potentialSynapsesForPresynapticCell_.size(cell);
+    }
+  }
+  if( work >= std::max<size_t>(numSegments, 4096u) ) {
+    countActiveSynapses_(connectedSynapsesForPresynapticCell_, activePresynapticCells,
+                         numActiveConnectedSynapsesForSegment);
+    countActiveSynapses_(potentialSynapsesForPresynapticCell_, activePresynapticCells,
+                         numActivePotentialSynapsesForSegment);
+    for(Segment segment = 0u; segment < numSegments; segment++) {
+      numActivePotentialSynapsesForSegment[segment] += numActiveConnectedSynapsesForSegment[segment];
+      if( numActivePotentialSynapsesForSegment[segment] > 0u ) {
+        touchedSegments.push_back(segment);
+      }
+    }
+    return;
+  }
+
+  // The potential count includes the connected synapses, a segment is
+  // touched when its potential count leaves zero.
+  for(const auto cell : activePresynapticCells) {
+    for(const auto segment : connectedSynapsesForPresynapticCell_.segments(cell)) {
+      ++numActiveConnectedSynapsesForSegment[segment];
+      if( numActivePotentialSynapsesForSegment[segment]++ == 0u ) {
+        touchedSegments.push_back(segment);
+      }
+    }
+  }
+  for(const auto cell : activePresynapticCells) {
+    for(const auto segment : potentialSynapsesForPresynapticCell_.segments(cell)) {
+      if( numActivePotentialSynapsesForSegment[segment]++ == 0u ) {
+        touchedSegments.push_back(segment);
+      }
+    }
+  }
+}
+
+
+void Connections::sortSegments(vector<Segment> &segments) const {
+  const size_t size = segments.size();
+  if( size < 64u ) { // not worth the radix passes
+    std::sort(segments.begin(), segments.end(),
+              [&](const Segment a, const Segment b) { return compareSegments(a, b); });
+    return;
+  }
+
+  // Key: cell in the high half, segment index in the low half.
+  static_assert(sizeof(CellIdx) <= 4u and sizeof(Segment) <= 4u, "key must fit into 64 bits");
+  vector<UInt64> keys(size), sorted(size);
+  UInt64 anyBits = 0u, allBits = ~UInt64(0u);
+  for(size_t i = 0u; i < size; i++) {
+    const Segment segment = segments[i];
+    keys[i] = (static_cast<UInt64>(segments_[segment].cell) << 32u) | segment;
+    anyBits |= keys[i];
+    allBits &= keys[i];
+  }
+
+  // LSD radix sort, one byte per pass. Bytes which are equal in all keys
+  // are skipped.
+  for(UInt shift = 0u; shift < 64u; shift += 8u) {
+    if( (((anyBits ^ allBits) >> shift) & 0xFFu) == 0u ) continue;
+    size_t offsets[257] = {0u};
+    for(const auto key : keys) {
+      offsets[((key >> shift) & 0xFFu) + 1u]++;
+    }
+    for(size_t b = 1u; b < 257u; b++) {
+      offsets[b] += offsets[b - 1u];
+    }
+    for(const auto key : keys) {
+      sorted[offsets[(key >> shift) & 0xFFu]++] = key;
+    }
+    keys.swap(sorted);
+  }
+
+  for(size_t i = 0u; i < size; i++) {
+    segments[i] = static_cast<Segment>(keys[i] & 0xFFFFFFFFu);
+  }
+}
+
+
+void Connections::countActiveSynapses_(const PresynapticIndex &presynapticIndex,
+                                       const vector<CellIdx> &activePresynapticCells,
+                                       vector<SynapseIdx> &numActiveSynapsesForSegment) {
+  const size_t numTasks = threadPool_ ? threadPool_->numThreads() : 1u;
+  size_t work = 0u;
+  if( numTasks > 1u ) {
+    for (const auto& cell : activePresynapticCells) {
+      work += presynapticIndex.size(cell);
+    }
+  }
+
+  // Each task visits (work / numTasks) synapses, but the reduction reads
+  // (numTasks * numSegments) counters split across the tasks. Only go
+  // parallel when the synapse walk dominates.
+  const size_t numSegments = numActiveSynapsesForSegment.size();
+  if( numTasks <= 1u or work < std::max<size_t>(numSegments, 4096u) ) {
+    for (const auto& cell : activePresynapticCells) {
+      for(const auto segment : presynapticIndex.segments(cell)) {
+        ++numActiveSynapsesForSegment[segment];
+      }
+    }
+    return;
+  }
+
+  partialCounts_.resize(numTasks);
+  for(auto &partial : partialCounts_) {
+    partial.resize(numSegments, 0u); //new segments start at zero, old ones are already zeroed
+  }
+
+  // Phase 1: each task counts a contiguous slice of the active cells.
+  threadPool_->parallelFor(numTasks, [&](size_t task) {
+    auto &partial = partialCounts_[task];
+    const auto range = ThreadPool::split(activePresynapticCells.size(), numTasks, task);
+    for(size_t i = range.first; i < range.second; i++) {
+      for(const auto segment : presynapticIndex.segments(activePresynapticCells[i])) {
+        ++partial[segment];
+      }
+    }
+  });
+
+  // Phase 2: each task sums a slice of the segments over all partial
+  // counts, and zeroes them for the next call. Integer addition is
+  // associative, so this matches the serial result exactly.
+  threadPool_->parallelFor(numTasks, [&](size_t task) {
+    const auto range = ThreadPool::split(numSegments, numTasks, task);
+    for(auto &partial : partialCounts_) {
+      for(size_t segment = range.first; segment < range.second; segment++) {
+        numActiveSynapsesForSegment[segment] += partial[segment];
+        partial[segment] = 0u;
+      }
+    }
+  });
+}
+
+
 void Connections::adaptSegment(const Segment segment, 
                                const SDR &inputs,
                                const Permanence increment,
@@ -485,56 +946,106 @@ void Connections::adaptSegment(const Segment segment,
 			       const bool pruneZeroSynapses, 
 			       const UInt segmentThreshold)
 {
+  if( not timeseries_ ) {
+    endAdaptSegment(beginAdaptSegment(segment, inputs, increment, decrement,
+                                      pruneZeroSynapses, segmentThreshold));
+    return;
+  }
+
   const auto &inputArray = inputs.getDense();
+  SegmentAdaptation adaptation{segment, {}, {}, pruneZeroSynapses, segmentThreshold};
 
-  if( timeseries_ ) {
-    previousUpdates_.resize( synapses_.size(), minPermanence );
-    currentUpdates_.resize(  synapses_.size(), minPermanence );
-  }
+  previousUpdates_.resize( synapses_.size(), minPermanence );
+  currentUpdates_.resize(  synapses_.size(), minPermanence );
 
-  vector<Synapse> destroyLater;
   for(const auto synapse: synapsesForSegment(segment)) {
-      const SynapseData &synapseData = dataForSynapse(synapse);
+    const SynapseData &synapseData = dataForSynapse(synapse);
 
-      Permanence update;
-      if( inputArray[synapseData.presynapticCell] ) {
-        update = increment;
-      } else {
-        update = -decrement;
-      }
+    Permanence update;
+    if( inputArray[synapseData.presynapticCell] ) {
+      update = increment;
+    } else {
+      update = -decrement;
+    }
 
     //prune permanences that reached zero
     if (pruneZeroSynapses and 
         synapseData.permanence + update < htm::minPermanence + htm::Epsilon) { //new value will disconnect the synapse
-      destroyLater.push_back(synapse);
-      prunedSyns_++; //for statistics
+      adaptation.pruned.push_back(synapse);
       continue;
     }
 
     //update synapse, but for TS only if changed
-    if(timeseries_) {
-      if( update != previousUpdates_[synapse] ) {
-        updateSynapsePermanence(synapse, synapseData.permanence + update);
-      }
-      currentUpdates_[ synapse ] = update;
-    } else {
+    if( update != previousUpdates_[synapse] ) {
       updateSynapsePermanence(synapse, synapseData.permanence + update);
     }
+    currentUpdates_[ synapse ] = update;
+  }
+  endAdaptSegment(adaptation);
+}
+
+
+Connections::SegmentAdaptation Connections::beginAdaptSegment(const Segment segment,
+                                                              const SDR &inputs,
+                                                              const Permanence increment,
+                                                              const Permanence decrement,
+                                                              const bool pruneZeroSynapses,
+                                                              const UInt segmentThreshold,
+                                                              const size_t task)
+{
+  NTA_CHECK(not timeseries_) << "beginAdaptSegment is not available in timeseries mode, use adaptSegment.";
+  const auto &inputArray = inputs.getDense();
+  //concurrent callers reserved their tasks, so this only grows for serial callers
+  if(task >= adaptScratch_.size()) {
+    reserveAdaptTasks(task + 1u);
+  }
+  auto &scratch = adaptScratch_[task];
+
+  // Compute the update of every synapse, then apply them to the whole segment at once.
+  const auto &presynapticCells = segments_[segment].presynapticCells;
+  scratch.updates.resize(presynapticCells.size());
+  for(size_t i = 0u; i < presynapticCells.size(); i++) {
+    scratch.updates[i] = inputArray[presynapticCells[i]] ? increment : -decrement;
+  }
+
+  SegmentAdaptation adaptation{segment, {}, {}, pruneZeroSynapses, segmentThreshold};
+  updateSegmentPermanences_(segment, scratch.updates, scratch.flags, pruneZeroSynapses,
+                            adaptation.crossed, adaptation.pruned);
+  return adaptation;
+}
+
+
+void Connections::reserveAdaptTasks(const size_t numTasks) {
+  if(adaptScratch_.size() < numTasks) {
+    adaptScratch_.resize(numTasks);
+  }
+}
+
+
+void Connections::endAdaptSegment(const SegmentAdaptation &adaptation)
+{
+  for(const auto synapse : adaptation.crossed) {
+    const Permanence permanence = synapses_[synapse].permanence;
+    updateConnected_(synapse, permanence >= connectedThreshold_);
+    for (auto h : eventHandlers_) {
+      h.second->onUpdateSynapsePermanence(synapse, permanence);
+    }
   }
 
   //destroy synapses accumulated for pruning
-  for(const auto pruneSyn : destroyLater) {
+  for(const auto pruneSyn : adaptation.pruned) {
     destroySynapse(pruneSyn);
   }
+  prunedSyns_ += static_cast<Synapse>(adaptation.pruned.size()); //for statistics
 
   //destroy segment if it has too few synapses left -> will never be able to connect again
   #ifdef NTA_ASSERTIONS_ON
-  if(segmentThreshold > 0) {
-    NTA_ASSERT(pruneZeroSynapses) << "Setting segmentThreshold only makes sense when pruneZeroSynapses is allowed.";
+  if(adaptation.segmentThreshold > 0) {
+    NTA_ASSERT(adaptation.pruneZeroSynapses) << "Setting segmentThreshold only makes sense when pruneZeroSynapses is allowed.";
   }
   #endif
-  if(pruneZeroSynapses and synapsesForSegment(segment).size() < segmentThreshold) { 
-    destroySegment(segment);
+  if(adaptation.pruneZeroSynapses and synapsesForSegment(adaptation.segment).size() < adaptation.segmentThreshold) { 
+    destroySegment(adaptation.segment);
     prunedSegs_++; //statistics
   }
 }
@@ -557,7 +1068,7 @@ void Connections::raisePermanencesToThreshold(
   if( segData.numConnected >= segmentThreshold )
     return;   // The segment already satisfies the requirement, done.
 
-  vector<Synapse> &synapses = segData.synapses;
+  auto &synapses = segData.synapses;
   if( synapses.empty())
     return;   // No synapses to raise permanences to, no work to do.
 
@@ -586,6 +1097,7 @@ void Connections::raisePermanencesToThreshold(
     { return synapses_[A].permanence > synapses_[B].permanence; };
   // Do a partial sort, it's faster than a full sort.
   std::nth_element(synapses.begin(), minPermSynPtr, synapses.end(), permanencesGreater);
+  rebuildSegmentArrays_(segment); //synapses were reordered
 
   const auto increment = connectedThreshold_ - synapses_[ *minPermSynPtr ].permanence;
   if( increment <= static_cast<Permanence>(0.0) ) // If minPermSynPtr is already connected then ...
@@ -650,20 +1162,55 @@ void Connections::synapseCompetition(
 
 
 void Connections::bumpSegment(const Segment segment, const Permanence delta) {
-  // TODO: vectorize?
-  for( const auto syn : synapsesForSegment(segment) ) {
-    updateSynapsePermanence(syn, synapses_[syn].permanence + delta);
-  }
+  reserveAdaptTasks(1u);
+  auto &scratch = adaptScratch_[0];
+  scratch.updates.assign(synapsesForSegment(segment).size(), delta);
+  SegmentAdaptation adaptation{segment, {}, {}, false, 0u};
+  updateSegmentPermanences_(segment, scratch.updates, scratch.flags, false,
+                            adaptation.crossed, adaptation.pruned);
+  endAdaptSegment(adaptation);
 }
 
 
-vector<CellIdx> Connections::presynapticCellsForSegment(const Segment segment) const { //TODO optimize by storing the vector in SegmentData?
-  set<CellIdx> presynCells;
-  for(const auto synapse: synapsesForSegment(segment)) {
-    const auto presynapticCell = dataForSynapse(synapse).presynapticCell;
-    presynCells.insert(presynapticCell);
+void Connections::updateSegmentPermanences_(const Segment segment,
+                                            const vector<Permanence> &updates,
+                                            vector<Byte> &flags,
+                                            const bool pruneZeroSynapses,
+                                            vector<Synapse> &crossed,
+                                            vector<Synapse> &pruned) {
+  auto &segData = segments_[segment];
+  const size_t numSynapses = segData.synapses.size();
+  NTA_ASSERT(updates.size() == numSynapses);
+
+  flags.resize(numSynapses);
+  adaptPermanences(segData.permanences.data(), updates.data(), flags.data(),
+                   numSynapses, connectedThreshold_);
+
+  // Write back to the synapses, and collect those which need bookkeeping.
+  for(size_t i = 0u; i < numSynapses; i++) {
+    const Synapse    synapse    = segData.synapses[i];
+    const Permanence permanence = segData.permanences[i];
+
+    //prune permanences that reached zero
+    if( pruneZeroSynapses and permanence < htm::minPermanence + htm::Epsilon ) {
+      pruned.push_back(synapse);
+      continue;
+    }
+
+    synapses_[synapse].permanence = permanence;
+    if( flags[i] ) {
+      crossed.push_back(synapse);
+    }
   }
-  return vector<CellIdx>(std::begin(presynCells), std::end(presynCells));
+}
+
+
+vector<CellIdx> Connections::presynapticCellsForSegment(const Segment segment) const {
+  // createSynapse() does not allow duplicates, so sorting is enough.
+  const auto &cells = segments_[segment].presynapticCells;
+  vector<CellIdx> presynCells(cells.begin(), cells.end());
+  std::sort(presynCells.begin(), presynCells.end());
+  return presynCells;
 }
 
 
@@ -747,7 +1294,7 @@ namespace htm {
 std::ostream& operator<< (std::ostream& stream, const Connections& self)
 {
   stream << "Connections:" << std::endl;
-  const auto numPresyns = self.potentialSynapsesForPresynapticCell_.size();
+  const auto numPresyns = self.potentialSynapsesForPresynapticCell_.numPresynapticCells();
   stream << "    Inputs (" << numPresyns
          << ") ~> Outputs (" << self.cells_.size()
          << ") via Segments (" << self.numSegments() << ")" << std::endl;
@@ -815,6 +1362,202 @@ std::ostream& operator<< (std::ostream& stream, const Connections& self)
 
 
 
+namespace {
+  // Snapshot records of Connections. These mirror the serialized members of
+  // SegmentData and SynapseData, which are not trivially copyable.
+  struct ConnectionsSnapshotInfo {
+    UInt32     version;
+    Permanence connectedThreshold;
+    UInt32     iteration;
+    UInt32     timeseries;
+    Synapse    prunedSyns;
+    Segment    prunedSegs;
+  };
+
+  struct SegmentSnapshot {
+    CellIdx    cell;
+    SynapseIdx numConnected;
+    UInt16     reserved;
+    UInt32     numSynapses;
+  };
+
+  struct SynapseSnapshot {
+    CellIdx    presynapticCell;
+    Permanence permanence;
+    Segment    segment;
+    Synapse    presynapticMapIndex;
+  };
+}
+
+
+void Connections::saveSnapshot(const std::string &path) const {
+  SnapshotWriter snapshot("Connections");
+  saveSnapshot(snapshot, "");
+  snapshot.saveFile(path);
+}
+
+
+void Connections::loadSnapshot(const std::string &path) {
+  SnapshotReader snapshot(path);
+  NTA_CHECK(snapshot.kind() == "Connections")
+      << "'" << path << "' is a snapshot of " << snapshot.kind() << ", not of Connections.";
+  loadSnapshot(snapshot, "");
+}
+
+
+void Connections::saveSnapshot(SnapshotWriter &snapshot, const std::string &prefix) const {
+  ConnectionsSnapshotInfo info;
+  info.version            = VERSION;
+  info.connectedThreshold = connectedThreshold_;
+  info.iteration          = iteration_;
+  info.timeseries         = timeseries_ ? 1u : 0u;
+  info.prunedSyns         = prunedSyns_;
+  info.prunedSegs         = prunedSegs_;
+  snapshot.addValue(prefix + "info", info);
+
+  // The per cell and per segment lists are flattened, with their lengths.
+  vector<UInt32>  cellCounts;
+  vector<Segment> cellSegments;
+  cellCounts.reserve(cells_.size());
+  for(const auto &cellData : cells_) {
+    cellCounts.push_back(static_cast<UInt32>(cellData.segments.size()));
+    cellSegments.insert(cellSegments.end(), cellData.segments.begin(), cellData.segments.end());
+  }
+  snapshot.add(prefix + "cellSegmentCounts", std::move(cellCounts));
+  snapshot.add(prefix + "cellSegments",      std::move(cellSegments));
+
+  vector<SegmentSnapshot> segments;
+  vector<Synapse>         segmentSynapses;
+  segments.reserve(segments_.size());
+  segmentSynapses.reserve(synapses_.size());
+  for(const auto &segData : segments_) {
+    segments.push_back({segData.cell, segData.numConnected, 0u,
+                        static_cast<UInt32>(segData.synapses.size())});
+    segmentSynapses.insert(segmentSynapses.end(), segData.synapses.begin(), segData.synapses.end());
+  }
+  snapshot.add(prefix + "segments",        std::move(segments));
+  snapshot.add(prefix + "segmentSynapses", std::move(segmentSynapses));
+
+  vector<SynapseSnapshot> synapses;
+  synapses.reserve(synapses_.size());
+  for(const auto &synData : synapses_) {
+    synapses.push_back({synData.presynapticCell, synData.permanence,
+                        synData.segment, synData.presynapticMapIndex_});
+  }
+  snapshot.add(prefix + "synapses", std::move(synapses));
+
+  snapshot.add(prefix + "destroyedSegments", destroyedSegments_);
+  snapshot.add(prefix + "destroyedSynapses", destroyedSynapses_);
+  snapshot.add(prefix + "previousUpdates",   previousUpdates_);
+  snapshot.add(prefix + "currentUpdates",    currentUpdates_);
+
+  potentialSynapsesForPresynapticCell_.saveSnapshot(snapshot, prefix + "potential.");
+  connectedSynapsesForPresynapticCell_.saveSnapshot(snapshot, prefix + "connected.");
+}
+
+
+void Connections::loadSnapshot(const SnapshotReader &snapshot, const std::string &prefix) {
+  const auto info = snapshot.getValue<ConnectionsSnapshotInfo>(prefix + "info");
+  NTA_CHECK(info.version <= VERSION)
+      << "Connections snapshot version " << info.version << " is newer than " << VERSION;
+  connectedThreshold_ = info.connectedThreshold;
+  iteration_          = info.iteration;
+  timeseries_         = info.timeseries != 0u;
+  prunedSyns_         = info.prunedSyns;
+  prunedSegs_         = info.prunedSegs;
+
+  const auto synapses = snapshot.get<SynapseSnapshot>(prefix + "synapses");
+  synapses_.resize(synapses.size());
+  for(size_t i = 0u; i < synapses.size(); i++) {
+    SynapseData &synData         = synapses_[i];
+    synData.presynapticCell      = synapses[i].presynapticCell;
+    synData.permanence           = synapses[i].permanence;
+    synData.segment              = synapses[i].segment;
+    synData.presynapticMapIndex_ = synapses[i].presynapticMapIndex;
+  }
+
+  const auto segments        = snapshot.get<SegmentSnapshot>(prefix + "segments");
+  const auto segmentSynapses = snapshot.get<Synapse>(prefix + "segmentSynapses");
+  segments_.clear();
+  segments_.reserve(segments.size());
+  const Synapse *nextSynapse = segmentSynapses.begin();
+  for(const auto &seg : segments) {
+    NTA_CHECK(seg.numSynapses <= static_cast<size_t>(segmentSynapses.end() - nextSynapse))
+        << "Connections: corrupt snapshot.";
+    segments_.emplace_back(seg.cell, allocator_);
+    segments_.back().numConnected = seg.numConnected;
+    segments_.back().synapses.assign(nextSynapse, nextSynapse + seg.numSynapses);
+    nextSynapse += seg.numSynapses;
+    for(const auto syn : segments_.back().synapses) {
+      NTA_CHECK(syn < synapses_.size()) << "Connections: corrupt snapshot.";
+    }
+  }
+  for(const auto &synData : synapses_) {
+    NTA_CHECK(synData.segment < segments_.size())
+        << "Connections: corrupt snapshot, synapse of segment " << synData.segment
+        << " but there are " << segments_.size() << " segments.";
+  }
+
+  const auto cellCounts   = snapshot.get<UInt32>(prefix + "cellSegmentCounts");
+  const auto cellSegments = snapshot.get<Segment>(prefix + "cellSegments");
+  cells_.assign(cellCounts.size(), CellData());
+  const Segment *nextSegment = cellSegments.begin();
+  for(size_t cell = 0u; cell < cellCounts.size(); cell++) {
+    NTA_CHECK(cellCounts[cell] <= static_cast<size_t>(cellSegments.end() - nextSegment))
+        << "Connections: corrupt snapshot.";
+    cells_[cell].segments.assign(nextSegment, nextSegment + cellCounts[cell]);
+    nextSegment += cellCounts[cell];
+    for(const auto seg : cells_[cell].segments) {
+      NTA_CHECK(seg < segments_.size()) << "Connections: corrupt snapshot.";
+    }
+  }
+
+  snapshot.read(prefix + "destroyedSegments", destroyedSegments_);
+  snapshot.read(prefix + "destroyedSynapses", destroyedSynapses_);
+  snapshot.read(prefix + "previousUpdates",   previousUpdates_);
+  snapshot.read(prefix + "currentUpdates",    currentUpdates_);
+
+  potentialSynapsesForPresynapticCell_.loadSnapshot(snapshot, prefix + "potential.");
+  connectedSynapsesForPresynapticCell_.loadSnapshot(snapshot, prefix + "connected.");
+  // Destroyed synapses keep stale data, check the synapses of the segments.
+  for(Segment segment = 0u; segment < segments_.size(); segment++) {
+    for(const auto synapse : segments_[segment].synapses) {
+      const SynapseData &synData = synapses_[synapse];
+      NTA_CHECK(synData.segment == segment) << "Connections: corrupt snapshot.";
+      const auto &map = synData.permanence >= connectedThreshold_
+                        ? connectedSynapsesForPresynapticCell_
+                        : potentialSynapsesForPresynapticCell_;
+      NTA_CHECK(synData.presynapticMapIndex_ < map.size(synData.presynapticCell) and
+                map.synapses(synData.presynapticCell).begin()[synData.presynapticMapIndex_] == synapse and
+                map.segments(synData.presynapticCell).begin()[synData.presynapticMapIndex_] == segment)
+          << "Connections: corrupt snapshot, synapse " << synapse
+          << " is not in the presynaptic map of cell " << synData.presynapticCell << ".";
+    }
+  }
+  // computeActivity() indexes the segment counts with the maps' segments,
+  // so every entry of the maps must point back at a live synapse.
+  for(const bool connected : {false, true}) {
+    const auto &map = connected ? connectedSynapsesForPresynapticCell_
+                                : potentialSynapsesForPresynapticCell_;
+    for(CellIdx cell = 0u; cell < map.numBuckets(); cell++) {
+      const auto syns = map.synapses(cell);
+      const auto segs = map.segments(cell);
+      for(size_t i = 0u; i < syns.size(); i++) {
+        const Synapse synapse = syns.begin()[i];
+        NTA_CHECK(synapse < synapses_.size()) << "Connections: corrupt snapshot.";
+        const SynapseData &synData = synapses_[synapse];
+        NTA_CHECK(synData.segment == segs.begin()[i] and synData.presynapticCell == cell and
+                  synData.presynapticMapIndex_ == i and
+                  (synData.permanence >= connectedThreshold_) == connected)
+            << "Connections: corrupt snapshot, presynaptic map of cell " << cell
+            << " holds a stale entry for synapse " << synapse << ".";
+      }
+    }
+  }
+  rebuildSegmentArrays_();
+}
+
+
 bool Connections::operator==(const Connections &o) const {
   try {
   NTA_CHECK (cells_.size() == o.cells_.size()) << "Connections equals: cells_" << cells_.size() << " vs. " << o.cells_.size();
@@ -848,8 +1591,6 @@ bool Connections::operator==(const Connections &o) const {
 
   NTA_CHECK(potentialSynapsesForPresynapticCell_ == o.potentialSynapsesForPresynapticCell_);
   NTA_CHECK(connectedSynapsesForPresynapticCell_ == o.connectedSynapsesForPresynapticCell_);
-  NTA_CHECK(potentialSegmentsForPresynapticCell_ == o.potentialSegmentsForPresynapticCell_);
-  NTA_CHECK(connectedSegmentsForPresynapticCell_ == o.connectedSegmentsForPresynapticCell_);
 
   NTA_CHECK (timeseries_ == o.timeseries_ ) << "Connections equals: timeseries_";
   NTA_CHECK (previousUpdates_ == o.previousUpdates_ ) << "Connections equals: previousUpdates_";
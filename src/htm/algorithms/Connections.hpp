@@ -24,8 +24,10 @@
 
 #include <limits>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 #include <deque>
@@ -33,10 +35,15 @@
 #include <htm/types/Types.hpp>
 #include <htm/types/Serializable.hpp>
 #include <htm/types/Sdr.hpp>
+#include <htm/utils/SlabAllocator.hpp>
+#include <htm/utils/ThreadPool.hpp>
 
 namespace htm {
 
 
+class SnapshotWriter;
+class SnapshotReader;
+
 //TODO instead of typedefs, use templates for proper type-checking?
 using CellIdx   = htm::ElemSparse; // CellIdx must match with ElemSparse, defined in Sdr.hpp
 using SegmentIdx= UInt16; /** Index of segment in cell. */
@@ -75,6 +82,7 @@ struct SynapseData: public Serializable {
   Permanence permanence;
   Segment segment;
   Synapse presynapticMapIndex_;
+  Synapse segmentIndex_; //position in SegmentData::synapses, not serialized (rebuilt on load)
 
   SynapseData() {}
 
@@ -124,13 +132,26 @@ struct SynapseData: public Serializable {
  *
  * @param cell
  * The cell that this segment is on.
+ *
+ * @param presynapticCells, permanences
+ * Structure-of-arrays copy of the synapses' presynapticCell and permanence,
+ * in the same order as `synapses`. Kept contiguous so that whole segment
+ * updates (adaptSegment, bumpSegment) can be vectorized. Owned by
+ * Connections, not serialized (rebuilt on load).
+ *
+ * The presynapticCells and permanences are allocated from the arena of
+ * Connections, if it has one, see Connections::setArenaStorage().
  */
 struct SegmentData: public Serializable {
-  SegmentData(const CellIdx cell) : cell(cell), numConnected(0) {} //default constructor
+  SegmentData(const CellIdx cell, const SlabAllocator<char> &allocator = {}) //default constructor
+    : cell(cell), numConnected(0),
+      presynapticCells(allocator), permanences(allocator) {}
 
   std::vector<Synapse> synapses;
   CellIdx cell; //mother cell that this segment originates from
   SynapseIdx numConnected; //number of permanences from `synapses` that are >= synPermConnected, ie connected synapses
+  SlabVector<CellIdx>    presynapticCells;
+  SlabVector<Permanence> permanences;
 
   //Serialize
   SegmentData() {}; //empty constructor for serialization, do not use
@@ -205,6 +226,123 @@ struct CellData : public Serializable {
 };
 
 
+//TODO in c++20 use std::identity
+struct Identity { constexpr size_t operator()( const CellIdx t ) const noexcept { return t; };   };
+
+
+/**
+ * PresynapticIndex class used in Connections.
+ *
+ * @b Description
+ * A CSR-style (compressed sparse row) store which maps each presynaptic cell
+ * to the list of synapses (and their segments) that it innervates.
+ *
+ * All lists live in one contiguous pool and are addressed by a dense vector of
+ * buckets indexed directly by the presynaptic CellIdx, so a lookup is a single
+ * array index and iterating a cell's segments streams through memory.
+ *
+ * Each bucket reserves some slack so that lists can grow without moving. A
+ * bucket which runs out of capacity is moved to the end of the pool, leaving a
+ * hole behind. When the holes take up more than half of the pool it is
+ * compacted. The order of the elements within a bucket is always preserved, so
+ * the position of a synapse in its bucket (`presynapticMapIndex_`) stays valid.
+ */
+class PresynapticIndex {
+public:
+  /** Read-only view of a contiguous range of the pool. */
+  template<typename T>
+  struct Range {
+    const T *first;
+    const T *last;
+    const T *begin() const noexcept { return first; }
+    const T *end()   const noexcept { return last; }
+    size_t   size()  const noexcept { return static_cast<size_t>(last - first); }
+    bool     empty() const noexcept { return first == last; }
+  };
+
+  /**
+   * Appends a synapse to the bucket of the presynaptic cell.
+   *
+   * @retval Position of the new synapse in the bucket of `cell`.
+   */
+  Synapse push_back(const CellIdx cell, const Synapse synapse, const Segment segment);
+
+  /**
+   * Removes the element at position `index` of the bucket of `cell`, by moving
+   * the last element of the bucket over it.
+   *
+   * @retval The synapse which now occupies position `index`, or `synapse` at
+   *         `index` itself if it was the last element of the bucket.
+   */
+  Synapse remove(const CellIdx cell, const Synapse index);
+
+  inline Range<Synapse> synapses(const CellIdx cell) const noexcept {
+    if(cell >= buckets_.size()) return {nullptr, nullptr};
+    const Bucket &b = buckets_[cell];
+    const Synapse *data = synapses_.data() + b.offset;
+    return {data, data + b.size};
+  }
+
+  inline Range<Segment> segments(const CellIdx cell) const noexcept {
+    if(cell >= buckets_.size()) return {nullptr, nullptr};
+    const Bucket &b = buckets_[cell];
+    const Segment *data = segments_.data() + b.offset;
+    return {data, data + b.size};
+  }
+
+  inline size_t size(const CellIdx cell) const noexcept {
+    return cell < buckets_.size() ? buckets_[cell].size : 0u;
+  }
+
+  /** Number of presynaptic cells which have at least one synapse. */
+  size_t numPresynapticCells() const;
+
+  /** One past the highest presynaptic cell that has a bucket. */
+  size_t numBuckets() const noexcept { return buckets_.size(); }
+
+  /**
+   * Repacks the pool so that there are no holes between the buckets. Each
+   * bucket keeps its capacity, so the slack for future growth is retained.
+   */
+  void compact();
+
+  void clear();
+
+  /**
+   * Serialization helpers. The on-disk format is one list of synapses and one
+   * list of segments for each presynaptic cell which has any synapses.
+   */
+  template<typename T>
+  using Lists = std::unordered_map<CellIdx, std::vector<T>, Identity>;
+  void toLists(Lists<Synapse> &synapses, Lists<Segment> &segments) const;
+  void fromLists(const Lists<Synapse> &synapses, const Lists<Segment> &segments);
+
+  /**
+   * Snapshot helpers. The buckets and the pool are stored as they are, holes
+   * included, so that loading is a plain copy. See Snapshot.hpp
+   */
+  void saveSnapshot(SnapshotWriter &snapshot, const std::string &prefix) const;
+  void loadSnapshot(const SnapshotReader &snapshot, const std::string &prefix);
+
+  bool operator==(const PresynapticIndex &o) const;
+  inline bool operator!=(const PresynapticIndex &o) const { return !operator==(o); }
+
+private:
+  struct Bucket {
+    UInt64 offset   = 0;
+    UInt32 size     = 0;
+    UInt32 capacity = 0;
+  };
+
+  void grow_(const CellIdx cell);
+
+  std::vector<Bucket>  buckets_;   // indexed by presynaptic cell
+  std::vector<Synapse> synapses_;  // the pool, parallel to segments_
+  std::vector<Segment> segments_;
+  size_t               holes_ = 0; // slots left behind by relocated buckets
+};
+
+
 /**
  * A base class for Connections event handlers.
  *
@@ -573,6 +711,107 @@ public:
   std::vector<SynapseIdx> computeActivity(const std::vector<CellIdx> &activePresynapticCells, 
 		                          const bool learn = true);
 
+  /**
+   * Count the active connected synapses of each segment, like
+   * computeActivity(activePresynapticCells, learn=false). This method is
+   * const: it does not touch the time-series state and always runs
+   * serially, so it may be called from several threads at once (for
+   * example to run inference on many inputs in parallel).
+   *
+   * @param activePresynapticCells Active cells in the input.
+   *
+   * @return numActiveConnectedSynapsesForSegment
+   */
+  std::vector<SynapseIdx> countActiveSynapses(const std::vector<CellIdx> &activePresynapticCells) const;
+
+  /**
+   * Sparse variant of computeActivity(), for callers which only look at the
+   * segments that have active synapses. Its cost scales with the number of
+   * active synapses rather than with the number of segments.
+   *
+   * The count vectors are kept by the caller across calls. On entry they must
+   * be zero, except for the segments listed in touchedSegments, which is the
+   * output of the previous call (or empty). They are reset and resized to
+   * segmentFlatListLength().
+   *
+   * @param numActiveConnectedSynapsesForSegment Output, active connected
+   *        synapse counts per segment.
+   * @param numActivePotentialSynapsesForSegment Output, active potential
+   *        synapse counts per segment.
+   * @param touchedSegments Output, every segment with at least one active
+   *        potential synapse, in no particular order.
+   * @param activePresynapticCells Active cells in the input.
+   * @param learn Enable learning updates, see computeActivity().
+   */
+  void computeActivitySparse(std::vector<SynapseIdx> &numActiveConnectedSynapsesForSegment,
+                             std::vector<SynapseIdx> &numActivePotentialSynapsesForSegment,
+                             std::vector<Segment> &touchedSegments,
+                             const std::vector<CellIdx> &activePresynapticCells,
+                             const bool learn = true);
+
+  /**
+   * Sort segments into the order of compareSegments(): by cell, then by
+   * segment index. Uses a radix sort on the (cell, segment) key, so it is
+   * linear in the number of segments.
+   */
+  void sortSegments(std::vector<Segment> &segments) const;
+
+  /**
+   * Use a pool of threads in computeActivity(). The active presynaptic cells
+   * are split across the threads, each thread counts into its own partial
+   * overlap vector and the partial vectors are then summed. The result is
+   * identical to the serial computation.
+   *
+   * Small inputs are still computed serially, the parallel path is only taken
+   * when the number of synapses to visit outweighs the cost of the reduction.
+   * Each thread keeps a counter for every segment, so memory use grows with
+   * (numThreads * numSegments).
+   *
+   * The pool is not serialized and is shared when Connections is copied.
+   *
+   * @param pool ThreadPool to use, or nullptr (default) to always run serially.
+   */
+  void setThreadPool(std::shared_ptr<ThreadPool> pool) { threadPool_ = pool; }
+  std::shared_ptr<ThreadPool> getThreadPool() const { return threadPool_; }
+
+  /**
+   * Storage mode of the per segment arrays of presynaptic cells and
+   * permanences, which adaptSegment() and bumpSegment() work on.
+   *
+   * By default every array is a separate heap allocation, so a large model
+   * holds millions of small allocations which fragment the heap. With arena
+   * storage the arrays are allocated from a SlabArena instead: there is no
+   * per allocation overhead, freed arrays are recycled by size, and the
+   * arrays of a cell's segments sit next to each other in memory.
+   * The lists returned by segmentsForCell() and synapsesForSegment() stay
+   * plain std::vectors in either mode.
+   *
+   * The arena is never compacted behind the caller's back. Call compact()
+   * when getArena()->bytesFree() grows large, eg. after heavy pruning.
+   *
+   * The storage mode is not serialized. Copies of Connections, by copy
+   * construction or copy assignment, share the arena of the original.
+   *
+   * @param arena true for arena storage, false for the heap (default).
+   */
+  void setArenaStorage(const bool arena);
+  bool getArenaStorage() const { return allocator_.arena() != nullptr; }
+
+  /** The arena of the arena storage mode, or nullptr. For statistics. */
+  const SlabArena *getArena() const { return allocator_.arena(); }
+
+  /**
+   * Repacks the per segment and per cell lists with no spare capacity and
+   * frees the lists of destroyed segments. With arena storage the arrays
+   * move, in cell order, into a new arena and the old one is returned to the
+   * system. Also compacts the presynaptic maps. Only called explicitly, and
+   * by load() in arena mode.
+   *
+   * Segment and synapse indices do not change, but references to the lists
+   * (eg. from synapsesForSegment()) become invalid.
+   */
+  void compact();
+
   /**
    * The primary method in charge of learning.   Adapts the permanence values of
    * the synapses based on the input SDR.  Learning is applied to a single
@@ -599,6 +838,52 @@ public:
 		    const bool pruneZeroSynapses = false,
 		    const UInt segmentThreshold = 0);
 
+  /**
+   * Pending bookkeeping of an adaptSegment() which was split in two phases,
+   * returned by beginAdaptSegment().
+   */
+  struct SegmentAdaptation {
+    Segment segment;
+    std::vector<Synapse> crossed; //synapses which crossed the connected threshold
+    std::vector<Synapse> pruned;  //synapses which reached minPermanence, to be destroyed
+    bool pruneZeroSynapses;
+    UInt segmentThreshold;
+  };
+
+  /**
+   * adaptSegment() split in two phases, for callers which learn on many
+   * segments in parallel. Calling endAdaptSegment(beginAdaptSegment(...))
+   * is equivalent to adaptSegment(...).
+   *
+   * beginAdaptSegment() updates the permanences of the segment's synapses.
+   * It only writes data owned by that segment, so it may be called
+   * concurrently for distinct segments, provided that inputs.getDense() was
+   * called before (SDR converts its formats lazily). Concurrent callers must
+   * call reserveAdaptTasks() first and pass distinct task numbers, the task
+   * selects the scratch buffers used by the call.
+   *
+   * endAdaptSegment() moves the synapses which crossed the connected
+   * threshold between the presynaptic maps, notifies the event handlers and
+   * prunes synapses and the segment. It modifies shared structures and must
+   * not run concurrently with anything else.
+   *
+   * Not available in timeseries mode.
+   */
+  SegmentAdaptation beginAdaptSegment(const Segment segment,
+                                      const SDR &inputs,
+                                      const Permanence increment,
+                                      const Permanence decrement,
+                                      const bool pruneZeroSynapses = false,
+                                      const UInt segmentThreshold = 0,
+                                      const size_t task = 0u);
+  void endAdaptSegment(const SegmentAdaptation &adaptation);
+
+  /**
+   * Allocate the scratch buffers of beginAdaptSegment() for numTasks
+   * concurrent callers, with task numbers 0 .. numTasks-1.
+   */
+  void reserveAdaptTasks(const size_t numTasks);
+
   /**
    * Ensures a minimum number of connected synapses.  This raises permance
    * values until the desired number of synapses have permanences above the
@@ -683,10 +968,15 @@ public:
     ar(CEREAL_NVP(destroyedSynapses_));
     ar(CEREAL_NVP(destroyedSegments_));
 
-    ar(CEREAL_NVP(potentialSynapsesForPresynapticCell_));
-    ar(CEREAL_NVP(connectedSynapsesForPresynapticCell_));
-    ar(CEREAL_NVP(potentialSegmentsForPresynapticCell_));
-    ar(CEREAL_NVP(connectedSegmentsForPresynapticCell_));
+    // The presynaptic indexes are stored as one list per presynaptic cell.
+    PresynapticIndex::Lists<Synapse> potentialSynapses, connectedSynapses;
+    PresynapticIndex::Lists<Segment> potentialSegments, connectedSegments;
+    potentialSynapsesForPresynapticCell_.toLists(potentialSynapses, potentialSegments);
+    connectedSynapsesForPresynapticCell_.toLists(connectedSynapses, connectedSegments);
+    ar(cereal::make_nvp("potentialSynapsesForPresynapticCell_", potentialSynapses));
+    ar(cereal::make_nvp("connectedSynapsesForPresynapticCell_", connectedSynapses));
+    ar(cereal::make_nvp("potentialSegmentsForPresynapticCell_", potentialSegments));
+    ar(cereal::make_nvp("connectedSegmentsForPresynapticCell_", connectedSegments));
 
     ar(CEREAL_NVP(timeseries_));
     ar(CEREAL_NVP(previousUpdates_));
@@ -709,10 +999,18 @@ public:
     ar(CEREAL_NVP(destroyedSynapses_));
     ar(CEREAL_NVP(destroyedSegments_));
 
-    ar(CEREAL_NVP(potentialSynapsesForPresynapticCell_));
-    ar(CEREAL_NVP(connectedSynapsesForPresynapticCell_));
-    ar(CEREAL_NVP(potentialSegmentsForPresynapticCell_));
-    ar(CEREAL_NVP(connectedSegmentsForPresynapticCell_));
+    PresynapticIndex::Lists<Synapse> potentialSynapses, connectedSynapses;
+    PresynapticIndex::Lists<Segment> potentialSegments, connectedSegments;
+    ar(cereal::make_nvp("potentialSynapsesForPresynapticCell_", potentialSynapses));
+    ar(cereal::make_nvp("connectedSynapsesForPresynapticCell_", connectedSynapses));
+    ar(cereal::make_nvp("potentialSegmentsForPresynapticCell_", potentialSegments));
+    ar(cereal::make_nvp("connectedSegmentsForPresynapticCell_", connectedSegments));
+    potentialSynapsesForPresynapticCell_.fromLists(potentialSynapses, potentialSegments);
+    connectedSynapsesForPresynapticCell_.fromLists(connectedSynapses, connectedSegments);
+    rebuildSegmentArrays_();
+    if( getArenaStorage() ) {
+      compact(); //the lists were loaded onto the heap
+    }
 
     ar(CEREAL_NVP(timeseries_));
     ar(CEREAL_NVP(previousUpdates_));
@@ -722,6 +1020,29 @@ public:
     ar(CEREAL_NVP(prunedSegs_));
   }
 
+  /**
+   * Snapshot of the Connections, see Snapshot.hpp
+   *
+   * Writes every table of the Connections, including both presynaptic
+   * indexes, as flat sections. Loading copies each section in bulk instead of
+   * rebuilding the indexes, which makes it much faster than load() for large
+   * models. The snapshot is not portable between machines with a different
+   * byte order.
+   *
+   * @param path File to write or read.
+   */
+  void saveSnapshot(const std::string &path) const;
+  void loadSnapshot(const std::string &path);
+
+  /**
+   * Adds the sections of this Connections to a snapshot, or loads them from
+   * a snapshot, for use by classes which own a Connections.
+   *
+   * @param prefix Prepended to the names of the sections.
+   */
+  void saveSnapshot(SnapshotWriter &snapshot, const std::string &prefix) const;
+  void loadSnapshot(const SnapshotReader &snapshot, const std::string &prefix);
+
   /**
    * Gets the number of cells.
    *
@@ -821,25 +1142,79 @@ protected:
    *
    * @param Synapse Index of synapse in presynaptic vector.
    *
-   * @param vector<Synapse> ynapsesForPresynapticCell must a vector from be
-   * either potentialSynapsesForPresynapticCell_ or
-   * connectedSynapsesForPresynapticCell_, depending on whether the synapse is
-   * connected or not.
+   * @param CellIdx presynaptic cell of the synapse.
    *
-   * @param vector<Synapse> segmentsForPresynapticCell must be a vector from
-   * either potentialSegmentsForPresynapticCell_ or
-   * connectedSegmentsForPresynapticCell_, depending on whether the synapse is
+   * @param PresynapticIndex must be either potentialSynapsesForPresynapticCell_
+   * or connectedSynapsesForPresynapticCell_, depending on whether the synapse is
    * connected or not.
    */
   void removeSynapseFromPresynapticMap_(const Synapse index,
-                              std::vector<Synapse> &synapsesForPresynapticCell,
-                              std::vector<Segment> &segmentsForPresynapticCell);
+                              const CellIdx presynapticCell,
+                              PresynapticIndex &presynapticIndex);
 
   /** 
    *  Remove least useful Segment from cell. 
    */
   void pruneSegment_(const CellIdx& cell);
 
+  /**
+   * Move a synapse between the potential and connected presynaptic maps,
+   * after its permanence crossed the connected threshold.
+   */
+  void updateConnected_(const Synapse synapse, const bool connected);
+
+  /**
+   * Copy all per segment and per cell lists into new lists, with no spare
+   * capacity, allocated by allocator.
+   */
+  void relocateLists_(const SlabAllocator<char> &allocator);
+
+  /**
+   * Rebuild SegmentData::presynapticCells, SegmentData::permanences and
+   * SynapseData::segmentIndex_ from synapses_, for one or all segments.
+   */
+  void rebuildSegmentArrays_(const Segment segment);
+  void rebuildSegmentArrays_();
+
+  /**
+   * Add updates[i] to the permanence of the i'th synapse of the segment,
+   * vectorized over the whole segment. Synapses which crossed the connected
+   * threshold are appended to crossed, the caller must call updateConnected_
+   * for them. With pruneZeroSynapses, synapses which would reach
+   * minPermanence are left unchanged and appended to pruned, the caller must
+   * destroy them. Only writes data of this segment and its synapses.
+   */
+  void updateSegmentPermanences_(const Segment segment,
+                                 const std::vector<Permanence> &updates,
+                                 std::vector<Byte> &flags,
+                                 const bool pruneZeroSynapses,
+                                 std::vector<Synapse> &crossed,
+                                 std::vector<Synapse> &pruned);
+
+  /**
+   * Scratch buffers of updateSegmentPermanences_, resized and reused so that
+   * adapting a segment does not allocate.
+   */
+  struct AdaptScratch {
+    std::vector<Permanence> updates;
+    std::vector<Byte>       flags;
+  };
+
+  /**
+   * Per call bookkeeping of computeActivity(): advance the iteration, rotate
+   * the timeseries updates and compact the arena when it is due.
+   */
+  void startComputeActivity_(const bool learn);
+
+  /**
+   * Count, for each segment, the synapses of presynapticIndex whose
+   * presynaptic cell is active. Adds to the counts already in
+   * numActiveSynapsesForSegment. Uses threadPool_ when that pays off.
+   */
+  void countActiveSynapses_(const PresynapticIndex &presynapticIndex,
+                            const std::vector<CellIdx> &activePresynapticCells,
+                            std::vector<SynapseIdx> &numActiveSynapsesForSegment);
+
 private:
   std::vector<CellData>    cells_;
   std::vector<SegmentData> segments_;
@@ -850,13 +1225,8 @@ private:
   UInt32 iteration_ = 0;
 
   // Extra bookkeeping for faster computing of segment activity.
- 
-  struct identity { constexpr size_t operator()( const CellIdx t ) const noexcept { return t; };   };	//TODO in c++20 use std::identity 
-
-  std::unordered_map<CellIdx, std::vector<Synapse>, identity> potentialSynapsesForPresynapticCell_;
-  std::unordered_map<CellIdx, std::vector<Synapse>, identity> connectedSynapsesForPresynapticCell_;
-  std::unordered_map<CellIdx, std::vector<Segment>, identity> potentialSegmentsForPresynapticCell_;
-  std::unordered_map<CellIdx, std::vector<Segment>, identity> connectedSegmentsForPresynapticCell_;
+  PresynapticIndex potentialSynapsesForPresynapticCell_;
+  PresynapticIndex connectedSynapsesForPresynapticCell_;
 
   // These three members should be used when working with highly correlated
   // data. The vectors store the permanence changes made by adaptSegment.
@@ -871,6 +1241,14 @@ private:
   //for listeners //TODO listeners are not serialized, nor included in equals ==
   UInt32 nextEventToken_;
   std::map<UInt32, ConnectionsEventHandler *> eventHandlers_;
+
+  //for parallel computeActivity, not serialized
+  std::shared_ptr<ThreadPool> threadPool_;
+  std::vector<std::vector<SynapseIdx>> partialCounts_; //one per task, kept zeroed between calls
+  std::vector<AdaptScratch> adaptScratch_; //one per task of beginAdaptSegment, not serialized
+
+  //arena of the per segment and per cell lists, or none for the heap. Not serialized.
+  SlabAllocator<char> allocator_;
 }; // end class Connections
 
 } // end namespace htm
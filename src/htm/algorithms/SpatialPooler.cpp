@@ -24,8 +24,11 @@
 #include <iterator> //begin()
 #include <cmath> //fmod
 #include <numeric> //iota
+#include <deque>
+#include <sstream>
 
 #include <htm/algorithms/SpatialPooler.hpp>
+#include <htm/types/Snapshot.hpp>
 #include <htm/utils/Topology.hpp>
 #include <htm/utils/VectorHelpers.hpp>
 
@@ -66,6 +69,195 @@ private:
   vector<UInt> bounds_;
 };
 
+/**
+ * Neighborhoods of a 1D or 2D column topology.
+ *
+ * In one dimension the Neighborhood of a coordinate is a span of
+ * consecutive coordinates, truncated at the edges or (with wrapAround)
+ * cyclic. In 1D and 2D the neighborhood of a column is therefore a box,
+ * which lets local inhibition use sliding windows and a Fenwick tree
+ * instead of walking every neighbor of every column. 1D topologies are
+ * handled as a single row. The boxes include the center column.
+ */
+class BoxNeighborhood {
+public:
+  // Inclusive range of coordinates. With wrapAround lo/hi may be outside of
+  // [0, size) and are taken modulo size; hi - lo < size always holds.
+  struct Span {
+    Int lo;
+    Int hi;
+    UInt size() const { return static_cast<UInt>(hi - lo + 1); }
+  };
+
+  static bool supports(const vector<UInt> &dimensions) {
+    return dimensions.size() == 1u or dimensions.size() == 2u;
+  }
+
+  BoxNeighborhood(const vector<UInt> &dimensions, const UInt radius, const bool wrap)
+    : rows_(dimensions.size() == 2u ? dimensions[0] : 1u),
+      cols_(dimensions.back()),
+      wrap_(wrap) {
+    NTA_ASSERT(supports(dimensions));
+    for(UInt y = 0u; y < rows_; y++) {
+      rowSpans_.push_back(span_(y, dimensions.size() == 2u ? radius : 0u, rows_));
+    }
+    for(UInt x = 0u; x < cols_; x++) {
+      colSpans_.push_back(span_(x, radius, cols_));
+    }
+  }
+
+  UInt rows() const { return rows_; }
+  UInt cols() const { return cols_; }
+
+  /** Number of columns in the box of the given column, including itself. */
+  UInt boxSize(const UInt column) const {
+    return rowSpans_[column / cols_].size() * colSpans_[column % cols_].size();
+  }
+
+  /**
+   * When the center is the last column of its box, Neighborhood with
+   * skipCenter yields the first column of the box a second time instead of
+   * ending, and the cached neighbor lists contain that duplicate. It is
+   * reproduced here so that the results stay identical.
+   *
+   * @returns true if the neighbor list of the column has the duplicate.
+   */
+  bool hasDuplicate(const UInt column) const {
+    const auto &ys = rowSpans_[column / cols_];
+    const auto &xs = colSpans_[column % cols_];
+    return mod_(ys.hi, rows_) == column / cols_ and mod_(xs.hi, cols_) == column % cols_;
+  }
+
+  /** The first column of the box, in the order Neighborhood visits them. */
+  UInt firstInBox(const UInt column) const {
+    return static_cast<UInt>(mod_(rowSpans_[column / cols_].lo, rows_) * cols_ +
+                             mod_(colSpans_[column % cols_].lo, cols_));
+  }
+
+  /** out[column] = max of `in` over the box of the column. */
+  vector<Real> boxMax(const vector<Real> &in) const {
+    return separable_(in, [](const vector<Real> &line, const vector<Span> &spans, vector<Real> &out) {
+      // Monotonic deque, both ends of the spans are nondecreasing.
+      const Int n = static_cast<Int>(line.size());
+      deque<Int> window;
+      Int next = spans[0].lo;
+      for(size_t i = 0u; i < spans.size(); i++) {
+        for(; next <= spans[i].hi; next++) {
+          const Real v = line[mod_(next, n)];
+          while(!window.empty() and line[mod_(window.back(), n)] <= v) window.pop_back();
+          window.push_back(next);
+        }
+        while(window.front() < spans[i].lo) window.pop_front();
+        out[i] = line[mod_(window.front(), n)];
+      }
+    });
+  }
+
+  /** Counts points in boxes. Points are columns, added and removed one at a time. */
+  class Counter {
+  public:
+    Counter(const BoxNeighborhood &boxes)
+      : boxes_(boxes), tree_((boxes.rows_ + 1u) * (boxes.cols_ + 1u), 0) {}
+
+    void add(const UInt column, const Int delta) {
+      const UInt stride = boxes_.cols_ + 1u;
+      for(UInt y = column / boxes_.cols_ + 1u; y <= boxes_.rows_; y += y & (~y + 1u)) {
+        for(UInt x = column % boxes_.cols_ + 1u; x <= boxes_.cols_; x += x & (~x + 1u)) {
+          tree_[y * stride + x] += delta;
+        }
+      }
+    }
+
+    /** Number of points in the box of the column. */
+    Int count(const UInt column) const {
+      Int total = 0;
+      const auto rows = boxes_.split_(boxes_.rowSpans_[column / boxes_.cols_], boxes_.rows_);
+      const auto cols = boxes_.split_(boxes_.colSpans_[column % boxes_.cols_], boxes_.cols_);
+      for(UInt i = 0u; i < rows.count; i++) {
+        const Span &ys = rows.spans[i];
+        for(UInt j = 0u; j < cols.count; j++) {
+          const Span &xs = cols.spans[j];
+          total += prefix_(ys.hi, xs.hi) - prefix_(ys.lo - 1, xs.hi)
+                 - prefix_(ys.hi, xs.lo - 1) + prefix_(ys.lo - 1, xs.lo - 1);
+        }
+      }
+      return total;
+    }
+
+  private:
+    Int prefix_(const Int row, const Int col) const { // points in [0..row] x [0..col]
+      const UInt stride = boxes_.cols_ + 1u;
+      Int total = 0;
+      for(Int y = row + 1; y > 0; y -= y & -y) {
+        for(Int x = col + 1; x > 0; x -= x & -x) {
+          total += tree_[static_cast<UInt>(y) * stride + static_cast<UInt>(x)];
+        }
+      }
+      return total;
+    }
+
+    const BoxNeighborhood &boxes_;
+    vector<Int> tree_;
+  };
+
+private:
+  Span span_(const UInt x, const UInt radius, const UInt size) const {
+    const Int lo = static_cast<Int>(x) - static_cast<Int>(radius);
+    if(wrap_) {
+      return { lo, lo + static_cast<Int>(std::min<UInt>(2u * radius + 1u, size)) - 1 };
+    }
+    return { std::max<Int>(lo, 0), std::min<Int>(static_cast<Int>(x + radius), static_cast<Int>(size) - 1) };
+  }
+
+  // Split a cyclic span into at most two spans within [0, size). Fixed
+  // size, Counter::count() runs once per candidate column.
+  struct SplitSpan {
+    Span spans[2];
+    UInt count;
+  };
+  static SplitSpan split_(const Span &s, const UInt size) {
+    const Int n = static_cast<Int>(size);
+    if(s.lo < 0)  return { { {s.lo + n, n - 1}, {0, s.hi} }, 2u };
+    if(s.hi >= n) return { { {s.lo, n - 1}, {0, s.hi - n} }, 2u };
+    return { { s, s }, 1u };
+  }
+
+  static size_t mod_(const Int i, const Int n) {
+    return static_cast<size_t>(((i % n) + n) % n);
+  }
+  static size_t mod_(const Int i, const UInt n) { return mod_(i, static_cast<Int>(n)); }
+
+  // Applies a 1D window operation along the rows, then along the columns.
+  template<typename T, typename WindowOp>
+  vector<T> separable_(const vector<T> &in, WindowOp op) const {
+    NTA_ASSERT(in.size() == static_cast<size_t>(rows_) * cols_);
+    vector<T> tmp(in.size());
+    vector<T> line, out;
+    for(UInt y = 0u; y < rows_; y++) {
+      line.assign(in.begin() + y * cols_, in.begin() + (y + 1u) * cols_);
+      out.resize(cols_);
+      op(line, colSpans_, out);
+      std::copy(out.begin(), out.end(), tmp.begin() + y * cols_);
+    }
+    vector<T> result(in.size());
+    line.resize(rows_);
+    out.resize(rows_);
+    for(UInt x = 0u; x < cols_; x++) {
+      for(UInt y = 0u; y < rows_; y++) line[y] = tmp[y * cols_ + x];
+      op(line, rowSpans_, out);
+      for(UInt y = 0u; y < rows_; y++) result[y * cols_ + x] = out[y];
+    }
+    return result;
+  }
+
+  const UInt rows_;
+  const UInt cols_;
+  const bool wrap_;
+  vector<Span> rowSpans_;
+  vector<Span> colSpans_;
+};
+
+
 SpatialPooler::SpatialPooler() {
   // The current version number.
   version_ = 2;
@@ -165,7 +357,7 @@ void SpatialPooler::setInhibitionRadius(UInt inhibitionRadius) {
   NTA_ASSERT(inhibitionRadius > 0);
   if (inhibitionRadius_ != inhibitionRadius) {
     inhibitionRadius_ = inhibitionRadius;
-    neighborMap_ = Neighborhood::updateAllNeighbors(inhibitionRadius_, columnDimensions_, wrapAround_, /*skip_center=*/true);
+    neighborMap_ = NeighborLists(inhibitionRadius_, columnDimensions_, wrapAround_, /*skipCenter=*/true);
   }
 }
 
@@ -202,7 +394,12 @@ void SpatialPooler::setSpVerbosity(UInt spVerbosity) {
 
 bool SpatialPooler::getWrapAround() const { return wrapAround_; }
 
-void SpatialPooler::setWrapAround(bool wrapAround) { wrapAround_ = wrapAround; }
+void SpatialPooler::setWrapAround(bool wrapAround) {
+  wrapAround_ = wrapAround;
+  if (!columnDimensions_.empty()) {
+    neighborMap_ = NeighborLists(inhibitionRadius_, columnDimensions_, wrapAround_, /*skipCenter=*/true);
+  }
+}
 
 UInt SpatialPooler::getUpdatePeriod() const { return updatePeriod_; }
 
@@ -502,6 +699,49 @@ const vector<SynapseIdx> SpatialPooler::compute(const SDR &input, const bool lea
 }
 
 
+void SpatialPooler::computeBatch(const vector<SDR> &inputs, vector<SDR> &outputs) {
+  if( outputs.size() != inputs.size() ) {
+    outputs.assign(inputs.size(), SDR(columnDimensions_));
+  }
+  for(auto &active : outputs) {
+    active.reshape( columnDimensions_ );
+  }
+  if( inputs.empty() ) return;
+
+  // Without learning compute() only reads the SP, except for the bookkeeping
+  // below, so the samples are independent. Each task handles a contiguous
+  // slice of the samples and reuses one boosted overlaps buffer.
+  const auto pool = getThreadPool();
+  const size_t numTasks = pool ? std::min<size_t>(inputs.size(), 4u * pool->numThreads()) : 1u;
+  const auto runTask = [&](const size_t task) {
+    vector<Real> boosted(numColumns_);
+    const auto range = ThreadPool::split(inputs.size(), numTasks, task);
+    for(size_t i = range.first; i < range.second; i++) {
+      inputs[i].reshape( inputDimensions_ );
+      const auto overlaps = connections_.countActiveSynapses(inputs[i].getSparse());
+      boostOverlaps_(overlaps, boosted);
+      auto activeVector = inhibitColumns_(boosted);
+      sort( activeVector.begin(), activeVector.end() );
+      outputs[i].setSparse( activeVector );
+    }
+    if( range.second == inputs.size() ) { //compute() leaves the last sample's boosted overlaps behind
+      boostedOverlaps_ = boosted;
+    }
+  };
+  if( pool ) {
+    pool->parallelFor(numTasks, runTask);
+  } else {
+    runTask(0u);
+  }
+
+  // Without learning the bookkeeping only advances the iteration counter,
+  // the duty cycles are updated by learning steps only.
+  for(size_t i = 0; i < inputs.size(); i++) {
+    updateBookeepingVars_(false);
+  }
+}
+
+
 void SpatialPooler::boostOverlaps_(const vector<SynapseIdx> &overlaps, //TODO use Eigen sparse vector here
                                    vector<Real> &boosted) const {
   if(boostStrength_ < static_cast<Real>(htm::Epsilon)) { //boost ~ 0.0, we can skip these computations, just copy the data
@@ -619,9 +859,19 @@ void SpatialPooler::updateMinDutyCyclesGlobal_() {
 
 
 void SpatialPooler::updateMinDutyCyclesLocal_() {
+  if( BoxNeighborhood::supports(columnDimensions_) ) {
+    const BoxNeighborhood boxes(columnDimensions_, inhibitionRadius_, wrapAround_);
+    const auto maxOverlapDuty = boxes.boxMax(overlapDutyCycles_);
+    for (UInt i = 0; i < numColumns_; i++) {
+      minOverlapDutyCycles_[i] = maxOverlapDuty[i] * minPctOverlapDutyCycles_;
+    }
+    return;
+  }
+
+  vector<CellIdx> hood;
   for (UInt i = 0; i < numColumns_; i++) {
     Real maxOverlapDuty = overlapDutyCycles_[i]; //start with the center, which is column 'i'
-    const auto& hood = neighborMap_[i];
+    neighborMap_.neighbors(i, hood);
     for(const auto column : hood) {
       maxOverlapDuty = max(maxOverlapDuty, overlapDutyCycles_[column]);
     }
@@ -777,10 +1027,13 @@ void SpatialPooler::updateBoostFactorsGlobal_() {
 
 
 void SpatialPooler::updateBoostFactorsLocal_() {
+  // No box sums here: the float sum over the sorted neighbors is kept
+  // so that the boost factors stay bit identical.
+  vector<CellIdx> hood;
   for (UInt i = 0; i < numColumns_; ++i) {
     Real localActivityDensity = 0.0f;
     
-    const auto& hood = neighborMap_[i]; //hood is vector<> of cached neighborhood values
+    neighborMap_.neighbors(i, hood); //same values as a cached neighborhood
     //optimization: In wrapAround, number of neighbors to be considered is solely a function of the inhibition radius,
     // the number of dimensions, and of the size of each of those dimenions. 
     // Or in non-wrap, if we use cached hood, we obtain the value the same as hood.size()
@@ -841,6 +1094,8 @@ vector<CellIdx> SpatialPooler::inhibitColumns_(const vector<Real> &overlaps) con
   if (globalInhibition_ ||
       inhibitionRadius_ > *max_element(columnDimensions_.begin(), columnDimensions_.end())) {
     return inhibitColumnsGlobal_(overlaps, density);
+  } else if( BoxNeighborhood::supports(columnDimensions_) ) {
+    return inhibitColumnsLocalBox_(overlaps, density);
   } else {
     return inhibitColumnsLocal_(overlaps, density);
   }
@@ -852,10 +1107,25 @@ vector<CellIdx> SpatialPooler::inhibitColumnsGlobal_(const vector<Real> &overlap
   const UInt numDesired = static_cast<UInt>((density * numColumns_));
   NTA_CHECK(numDesired > 0) << "Not enough columns (" << numColumns_ << ") "
                             << "for desired density (" << density << ").";
-  // Sort the columns by the amount of overlap.  First make a list of all of the
-  // column indexes.
-  vector<CellIdx> activeColumns(numColumns_);
-  std::iota(activeColumns.begin(), activeColumns.end(), 0); //fill with sequence 0,1,..N
+  // Only columns which reach the stimulusThreshold can be active. With a
+  // sparse input most columns have zero overlap, so first collect the
+  // candidates instead of sorting all of the columns.
+  static thread_local vector<CellIdx> candidates; // scratch, reused between calls
+  candidates.clear();
+  for(CellIdx column = 0; column < numColumns_; column++) {
+    if( overlaps[column] > 0.0f and overlaps[column] >= stimulusThreshold_ ) {
+      candidates.push_back(column);
+    }
+  }
+  // With stimulusThreshold == 0 columns without any overlap may win too. They
+  // lose to every candidate, and among themselves the greater index wins.
+  if( stimulusThreshold_ == 0u ) {
+    for(CellIdx column = numColumns_; column-- > 0 and candidates.size() < numDesired; ) {
+      if( overlaps[column] == 0.0f ) {
+        candidates.push_back(column);
+      }
+    }
+  }
 
   // Compare the column indexes by their overlap.
   auto compare = [&overlaps](const UInt &a, const UInt &b) -> bool
@@ -866,23 +1136,19 @@ vector<CellIdx> SpatialPooler::inhibitColumnsGlobal_(const vector<Real> &overlap
   // faster than a regular sort because it stops after it partitions the
   // elements about the Nth element, with all elements on their correct side of
   // the Nth element.
-  std::nth_element(
-    activeColumns.begin(),
-    activeColumns.begin() + numDesired,
-    activeColumns.end(),
-    compare);
-  // Remove the columns which lost the competition.
-  activeColumns.resize(numDesired);
-  // Finish sorting the winner columns by their overlap.
-  std::sort(activeColumns.begin(), activeColumns.end(), compare);
-  // Remove sub-threshold winners
-  while( !activeColumns.empty() &&
-         overlaps[activeColumns.back()] < stimulusThreshold_) {
-      activeColumns.pop_back();
+  if( candidates.size() > numDesired ) {
+    std::nth_element(
+      candidates.begin(),
+      candidates.begin() + numDesired,
+      candidates.end(),
+      compare);
+    // Remove the columns which lost the competition.
+    candidates.resize(numDesired);
   }
-  
-  activeColumns.shrink_to_fit();
-  return activeColumns;
+  // Finish sorting the winner columns by their overlap.
+  std::sort(candidates.begin(), candidates.end(), compare);
+
+  return vector<CellIdx>(candidates.begin(), candidates.end());
 }
 
 
@@ -899,6 +1165,7 @@ vector<CellIdx> SpatialPooler::inhibitColumnsLocal_(const vector<Real> &overlaps
   // selected are treated as "bigger".
   vector<bool> alreadyUsedColumn(numColumns_, false); // in tie we prefer already used columns
 
+  vector<CellIdx> hood;
   for (UInt column = 0; column < numColumns_; column++) {
     if (overlaps[column] < stimulusThreshold_) { //TODO make connections.computeActivity() already drop sub-threshold columns
       continue;
@@ -907,7 +1174,7 @@ vector<CellIdx> SpatialPooler::inhibitColumnsLocal_(const vector<Real> &overlaps
     UInt otherBigger = 0; //how many neighbor columns are bigger/better than this column 'column'. 
     //..aka. how many times this column lost. 
 
-    const auto& hood = neighborMap_.at(column);
+    neighborMap_.neighbors(column, hood);
     // Optimization: In wrapAround, number of neighbors to be considered is solely a function of the inhibition radius, 
     // the number of dimensions, and of the size of each of those dimenion
     const UInt numNeighbors = static_cast<UInt>(hood.size());
@@ -935,6 +1202,69 @@ vector<CellIdx> SpatialPooler::inhibitColumnsLocal_(const vector<Real> &overlaps
 }
 
 
+vector<CellIdx> SpatialPooler::inhibitColumnsLocalBox_(const vector<Real> &overlaps,
+                                                       const Real density) const {
+  // Same result as the neighbor walk in inhibitColumnsLocal_(). A column
+  // loses to each neighbor with a greater overlap, and to each neighbor with
+  // an equal overlap which was already selected, ie. a selected neighbor with
+  // a smaller index. Processing the columns by decreasing overlap (and by
+  // index within equal overlaps) these are exactly the columns counted in
+  // `greater` and `equalSelected`, so each column needs only two box counts.
+  const BoxNeighborhood boxes(columnDimensions_, inhibitionRadius_, wrapAround_);
+
+  vector<CellIdx> candidates;
+  for (CellIdx column = 0; column < numColumns_; column++) {
+    if (overlaps[column] >= stimulusThreshold_) {
+      candidates.push_back(column);
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+    [&overlaps](const CellIdx a, const CellIdx b) { return overlaps[a] > overlaps[b]; });
+
+  BoxNeighborhood::Counter greater(boxes);
+  BoxNeighborhood::Counter equalSelected(boxes);
+  vector<bool> alreadyUsedColumn(numColumns_, false);
+  vector<CellIdx> activeColumns;
+  for (auto group = candidates.cbegin(); group != candidates.cend(); ) {
+    const auto groupEnd = std::find_if(group, candidates.cend(),
+      [&](const CellIdx c) { return overlaps[c] != overlaps[*group]; });
+    const size_t groupStart = activeColumns.size();
+
+    for (auto it = group; it != groupEnd; ++it) {
+      const CellIdx column = *it;
+      const bool duplicate = boxes.hasDuplicate(column);
+      const UInt numNeighbors = boxes.boxSize(column) - 1u + (duplicate ? 1u : 0u);
+      const UInt numDesiredLocalActive = static_cast<UInt>(0.5f + (density * (numNeighbors + 1)));
+      NTA_ASSERT(numDesiredLocalActive > 0);
+
+      Int otherBigger = greater.count(column) + equalSelected.count(column);
+      if (duplicate) {
+        const CellIdx first = boxes.firstInBox(column);
+        if (overlaps[first] > overlaps[column] || (overlaps[first] == overlaps[column] && alreadyUsedColumn[first])) {
+          otherBigger++;
+        }
+      }
+      if (otherBigger < static_cast<Int>(numDesiredLocalActive)) {
+        activeColumns.push_back(column);
+        alreadyUsedColumn[column] = true;
+        equalSelected.add(column, 1);
+      }
+    }
+
+    for (auto it = group; it != groupEnd; ++it) {
+      greater.add(*it, 1);
+    }
+    for (size_t i = groupStart; i < activeColumns.size(); i++) {
+      equalSelected.add(activeColumns[i], -1);
+    }
+    group = groupEnd;
+  }
+
+  std::sort(activeColumns.begin(), activeColumns.end());
+  return activeColumns;
+}
+
+
 bool SpatialPooler::isUpdateRound_() const {
   return (iterationNum_ % updatePeriod_) == 0;
 }
@@ -1001,6 +1331,34 @@ void SpatialPooler::printState(const vector<Real> &state, std::ostream& out) con
 }
 
 
+void SpatialPooler::saveSnapshot(const std::string &path) const {
+  // The members other than the connections are small, they are stored as one
+  // binary archive.
+  std::stringstream state;
+  {
+    cereal::BinaryOutputArchive ar(state);
+    saveState_(ar, false);
+  }
+  const std::string bytes = state.str();
+  SnapshotWriter snapshot("SpatialPooler");
+  snapshot.add("state", vector<char>(bytes.begin(), bytes.end()));
+  connections_.saveSnapshot(snapshot, "connections.");
+  snapshot.saveFile(path);
+}
+
+
+void SpatialPooler::loadSnapshot(const std::string &path) {
+  SnapshotReader snapshot(path);
+  NTA_CHECK(snapshot.kind() == "SpatialPooler")
+      << "'" << path << "' is a snapshot of " << snapshot.kind() << ", not of SpatialPooler.";
+  connections_.loadSnapshot(snapshot, "connections.");
+  const auto state = snapshot.get<char>("state");
+  std::istringstream in(std::string(state.begin(), state.end()));
+  cereal::BinaryInputArchive ar(in);
+  loadState_(ar, false);
+}
+
+
 /** equals implementation based on text serialization */
 bool SpatialPooler::operator==(const SpatialPooler& o) const{
   // Store the simple variables first.
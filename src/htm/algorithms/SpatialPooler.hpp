@@ -260,6 +260,34 @@ public:
   virtual const vector<SynapseIdx> compute(const SDR &input, const bool learn, SDR &active);
 
 
+  /**
+  Batch inference. Computes the active columns of many inputs without
+  learning, with the same results (and the same SpatialPooler state
+  afterwards) as calling compute(inputs[i], false, outputs[i]) for each i
+  in order. The samples are run in parallel on the thread pool given to
+  setThreadPool(), or serially if there is none.
+
+  As with compute() without learning, the only state which changes is the
+  iteration counter, which advances by inputs.size(). Duty cycles, boost
+  factors and permanences are not updated.
+
+  @param inputs Input SDRs, each must have getNumInputs() bits.
+
+  @param outputs The active columns for each input. It is resized to
+        inputs.size() if needed, existing SDRs must have getNumColumns() bits.
+   */
+  void computeBatch(const std::vector<SDR> &inputs, std::vector<SDR> &outputs);
+
+  /**
+  Threads used by computeBatch() and by the Connections' computeActivity().
+  The pool is not serialized.
+
+  @param pool ThreadPool to use, or nullptr to run serially.
+   */
+  void setThreadPool(std::shared_ptr<ThreadPool> pool) { connections_.setThreadPool(pool); }
+  std::shared_ptr<ThreadPool> getThreadPool() const { return connections_.getThreadPool(); }
+
+
   /**
    * Get the version number of this spatial pooler.
 
@@ -267,6 +295,18 @@ public:
    */
   virtual UInt version() const { return version_; };
 
+  /**
+  saveSnapshot()/loadSnapshot() Save the spatial pooler to a snapshot file and
+  load it back. The connections are stored in flat sections which are loaded
+  with one bulk copy each, see Connections::saveSnapshot and Snapshot.hpp.
+  Much faster than the Serializable formats for large models, but not portable
+  between machines with a different byte order.
+
+  @param path File to write or read.
+   */
+  void saveSnapshot(const std::string &path) const;
+  void loadSnapshot(const std::string &path);
+
   /**
   save_ar()/load_ar() Serialize the current state of the spatial pooler to the
   specified file and deserialize it.
@@ -276,7 +316,15 @@ public:
   CerealAdapter;  // see Serializable.hpp
   // FOR Cereal Serialization
   template<class Archive>
-  void save_ar(Archive& ar) const {
+  void save_ar(Archive& ar) const { saveState_(ar, true); }
+  template<class Archive>
+  void load_ar(Archive& ar) { loadState_(ar, true); }
+
+private:
+  // The members in archive order. The connections are left out of the
+  // archive of a snapshot, which stores them in sections of their own.
+  template<class Archive>
+  void saveState_(Archive& ar, const bool withConnections) const {
     ar(CEREAL_NVP(inputDimensions_),
        CEREAL_NVP(columnDimensions_));
     ar(CEREAL_NVP(numInputs_),
@@ -307,7 +355,7 @@ public:
     ar(CEREAL_NVP(overlapDutyCycles_));
     ar(CEREAL_NVP(activeDutyCycles_));
     ar(CEREAL_NVP(minOverlapDutyCycles_));
-    ar(CEREAL_NVP(connections_));
+    if(withConnections) ar(CEREAL_NVP(connections_));
     ar(CEREAL_NVP(rng_));
     ar(CEREAL_NVP(minActiveDutyCycles_));
     ar(CEREAL_NVP(boostedOverlaps_)); //boostedOverlaps_ are re-created in each compute() 
@@ -316,7 +364,7 @@ public:
   }
   // FOR Cereal Deserialization
   template<class Archive>
-  void load_ar(Archive& ar) {
+  void loadState_(Archive& ar, const bool withConnections) {
     ar(CEREAL_NVP(inputDimensions_),
        CEREAL_NVP(columnDimensions_));
     ar(CEREAL_NVP(numInputs_),
@@ -347,15 +395,17 @@ public:
     ar(CEREAL_NVP(overlapDutyCycles_));
     ar(CEREAL_NVP(activeDutyCycles_));
     ar(CEREAL_NVP(minOverlapDutyCycles_));
-    ar(CEREAL_NVP(connections_));
+    if(withConnections) ar(CEREAL_NVP(connections_));
     ar(CEREAL_NVP(rng_));
     ar(CEREAL_NVP(minActiveDutyCycles_));
     ar(CEREAL_NVP(boostedOverlaps_));
 
     //re-initialize map
-    neighborMap_ = Neighborhood::updateAllNeighbors(inhibitionRadius_, columnDimensions_, wrapAround_, /*skip_center=*/true);
+    neighborMap_ = NeighborLists(inhibitionRadius_, columnDimensions_, wrapAround_, /*skipCenter=*/true);
   }
 
+public:
+
   /**
   Returns the dimensions of the columns in the region.
 
@@ -958,6 +1008,15 @@ public:
   */
   std::vector<CellIdx> inhibitColumnsLocal_(const vector<Real> &overlaps, const Real density) const;
 
+  /**
+     Local inhibition for 1D and 2D column topologies. Returns the same
+     columns as inhibitColumnsLocal_(), but ranks each column within its
+     neighborhood with box counts over a Fenwick tree instead of visiting
+     each neighbor, O(columns * log^2(columns)) instead of
+     O(columns * neighbors).
+  */
+  std::vector<CellIdx> inhibitColumnsLocalBox_(const vector<Real> &overlaps, const Real density) const;
+
   /**
       The primary method in charge of learning.
 
@@ -1223,7 +1282,7 @@ public:
   const Connections& connections = connections_; //for inspection of details in connections. Const, so users cannot break the SP internals.
   const Connections& getConnections() const { return connections_; } // as above, but for use in pybind11
 private:
-  std::unordered_map<UInt, std::vector<UInt>> neighborMap_; // col -> vector neighbors
+  NeighborLists neighborMap_; // col -> neighbors, computed on demand
 };
 
 std::ostream & operator<<(std::ostream & out, const SpatialPooler &sp);
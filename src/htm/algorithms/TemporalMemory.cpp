@@ -34,12 +34,15 @@
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 #include <set>
+#include <sstream>
 
 #include <htm/algorithms/TemporalMemory.hpp>
 #include <htm/algorithms/Anomaly.hpp>
+#include <htm/types/Snapshot.hpp>
 
 using namespace std;
 using namespace htm;
@@ -138,7 +141,7 @@ void TemporalMemory::initialize(
   reset();
 }
 
-CellIdx TemporalMemory::getLeastUsedCell_(const CellIdx column) {
+CellIdx TemporalMemory::getLeastUsedCell_(const CellIdx column, Random &rng) const {
   if(cellsPerColumn_ == 1) return column;
 
   vector<CellIdx> cells = cellsForColumn(column);
@@ -146,7 +149,7 @@ CellIdx TemporalMemory::getLeastUsedCell_(const CellIdx column) {
   //TODO: decide if we need to choose randomly from the "least used" cells, or if 1st is fine. 
   //In that case the line below is not needed, and this method can become const, deterministic results in tests need to be updated
   //un/comment line below: 
-  rng_.shuffle(cells.begin(), cells.end()); //as min_element selects 1st minimal element, and we want to randomly choose 1 from the minimals.
+  rng.shuffle(cells.begin(), cells.end()); //as min_element selects 1st minimal element, and we want to randomly choose 1 from the minimals.
 
   const auto compareByNumSegments = [&](const CellIdx a, const CellIdx b) {
     if(connections.numSegments(a) == connections.numSegments(b)) 
@@ -220,7 +223,7 @@ void TemporalMemory::burstColumn_(
       winnerCell = *prevWinnerPtr;
     }
     else {
-      winnerCell = getLeastUsedCell_(column);
+      winnerCell = getLeastUsedCell_(column, rng_);
     }
   }
   winnerCells_.push_back(winnerCell);
@@ -289,6 +292,9 @@ void TemporalMemory::activateCells(const SDR &activeColumns, const bool learn) {
     return connections.cellForSegment(segment) / cellsPerColumn_;
   };
 
+  // In parallel mode, only collect the columns here.
+  vector<ColumnSegments_> columns;
+
   // Iterate over these three lists at the same time.
   auto activeColumnsBegin           = sparse.cbegin();
   auto columnActiveSegmentsBegin    = activeSegments_.cbegin();
@@ -325,7 +331,11 @@ void TemporalMemory::activateCells(const SDR &activeColumns, const bool learn) {
       ++columnMatchingSegmentsEnd;
     }
 
-    if (activeColumnsBegin != activeColumnsEnd) {
+    if (threadPool_) {
+      columns.push_back({column, activeColumnsBegin != activeColumnsEnd,
+                         columnActiveSegmentsBegin,   columnActiveSegmentsEnd,
+                         columnMatchingSegmentsBegin, columnMatchingSegmentsEnd});
+    } else if (activeColumnsBegin != activeColumnsEnd) {
       // This column is active.
       if (columnActiveSegmentsBegin != columnActiveSegmentsEnd) {
         // This column was also predicted.
@@ -349,10 +359,176 @@ void TemporalMemory::activateCells(const SDR &activeColumns, const bool learn) {
     columnActiveSegmentsBegin   = columnActiveSegmentsEnd;
     columnMatchingSegmentsBegin = columnMatchingSegmentsEnd;
   }
+  if (threadPool_) {
+    activateColumnsParallel_(columns, prevActiveCells, prevWinnerCells, learn);
+  }
   segmentsValid_ = false;
 }
 
 
+/**
+ * Seed of the random stream of a column in one step of the parallel
+ * activateCells(). Mixes the two with the SplitMix64 finalizer, Random uses
+ * only the lower 32 bits of its seed. Never 0, which would seed from time.
+ */
+static UInt64 columnSeed_(const UInt32 stepSeed, const UInt column) {
+  UInt64 z = ((static_cast<UInt64>(stepSeed) << 32u) | column) + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+  z = (z ^ (z >> 31u)) & 0xFFFFFFFFull;
+  return z == 0u ? 1u : z;
+}
+
+
+void TemporalMemory::activateColumnsParallel_(const vector<ColumnSegments_> &columns,
+                                              const SDR &prevActiveCells,
+                                              const vector<CellIdx> &prevWinnerCells,
+                                              const bool learn) {
+  // What the first phase decided for each column.
+  struct ColumnLearning {
+    CellIdx winnerCell = 0;
+    bool matched = false; //bursting column learns on its best matching segment
+    Segment bestMatchingSegment = 0;
+    vector<Connections::SegmentAdaptation> adaptations;
+    std::unique_ptr<Random> rng; //created when first needed
+  };
+  vector<ColumnLearning> results(columns.size());
+
+  // Draw from rng_ exactly once per step, so that its state only depends on
+  // the number of steps.
+  const UInt32 stepSeed = rng_.getUInt32();
+  const auto rngFor = [&](const size_t i) -> Random& {
+    if (not results[i].rng) {
+      results[i].rng.reset(new Random(columnSeed_(stepSeed, columns[i].column)));
+    }
+    return *results[i].rng;
+  };
+
+  // Phase 1, in parallel: select the winner cells and adapt the permanences.
+  // Only data owned by the column's own segments is written.
+  prevActiveCells.getDense(); //convert now, SDR is not thread safe
+  const size_t numTasks = std::min(columns.size(), 4u * static_cast<size_t>(threadPool_->numThreads()));
+  connections_.reserveAdaptTasks(numTasks);
+  threadPool_->parallelFor(numTasks, [&](const size_t task) {
+    const auto range = ThreadPool::split(columns.size(), numTasks, task);
+    for (size_t i = range.first; i < range.second; i++) {
+      const auto &col = columns[i];
+      auto &result    = results[i];
+
+      if (col.active and col.activeSegmentsBegin != col.activeSegmentsEnd) {
+        // Predicted active column, learn on all active segments.
+        if (learn) {
+          for (auto segment = col.activeSegmentsBegin; segment != col.activeSegmentsEnd; ++segment) {
+            result.adaptations.push_back(connections_.beginAdaptSegment(*segment, prevActiveCells,
+                permanenceIncrement_, permanenceDecrement_, true, minThreshold_, task));
+          }
+        }
+      }
+      else if (col.active) {
+        // Bursting column, same choice of the winner cell as burstColumn_().
+        const auto bestMatchingSegment =
+            std::max_element(col.matchingSegmentsBegin, col.matchingSegmentsEnd,
+                             [&](Segment a, Segment b) {
+                               return (numActivePotentialSynapsesForSegment_[a] <
+                                       numActivePotentialSynapsesForSegment_[b]);
+                             });
+        if (bestMatchingSegment != col.matchingSegmentsEnd) {
+          result.matched             = true;
+          result.bestMatchingSegment = *bestMatchingSegment;
+          result.winnerCell          = connections.cellForSegment(*bestMatchingSegment);
+          if (learn) {
+            result.adaptations.push_back(connections_.beginAdaptSegment(*bestMatchingSegment, prevActiveCells,
+                permanenceIncrement_, permanenceDecrement_, true, minThreshold_, task));
+          }
+        }
+        else {
+          const auto prevWinnerPtr = std::lower_bound(prevWinnerCells.begin(), prevWinnerCells.end(), col.column,
+              [&](const CellIdx cell, const UInt c) { return columnForCell(cell) < c; });
+          if (prevWinnerPtr != prevWinnerCells.end() && columnForCell(*prevWinnerPtr) == col.column) {
+            result.winnerCell = *prevWinnerPtr;
+          }
+          else {
+            result.winnerCell = getLeastUsedCell_(col.column, rngFor(i));
+          }
+        }
+      }
+      else if (learn and predictedSegmentDecrement_ > 0.0) {
+        // Predicted inactive column, punish its matching segments.
+        for (auto segment = col.matchingSegmentsBegin; segment != col.matchingSegmentsEnd; ++segment) {
+          result.adaptations.push_back(connections_.beginAdaptSegment(*segment, prevActiveCells,
+              -predictedSegmentDecrement_, 0.0, true, minThreshold_, task));
+        }
+      }
+    }
+  });
+
+  // Phase 2, serially in column order: the output cells and the structural
+  // changes, in the same order as the serial mode would make them.
+  for (size_t i = 0; i < columns.size(); i++) {
+    const auto &col = columns[i];
+    auto &result    = results[i];
+
+    if (col.active and col.activeSegmentsBegin != col.activeSegmentsEnd) {
+      size_t k = 0;
+      auto activeSegment = col.activeSegmentsBegin;
+      do {
+        const CellIdx cell = connections.cellForSegment(*activeSegment);
+        activeCells_.push_back(cell);
+        winnerCells_.push_back(cell);
+        // This cell might have multiple active segments.
+        do {
+          if (learn) {
+            connections_.endAdaptSegment(result.adaptations[k++]);
+            const Int32 nGrowDesired =
+                static_cast<Int32>(maxNewSynapseCount_) -
+                numActivePotentialSynapsesForSegment_[*activeSegment];
+            if (nGrowDesired > 0) {
+              connections_.growSynapses(*activeSegment, prevWinnerCells, initialPermanence_, rngFor(i), nGrowDesired, maxSynapsesPerSegment_);
+            }
+          }
+        } while (++activeSegment != col.activeSegmentsEnd &&
+                 connections.cellForSegment(*activeSegment) == cell);
+      } while (activeSegment != col.activeSegmentsEnd);
+    }
+    else if (col.active) {
+      const auto newCells = cellsForColumn(col.column);
+      activeCells_.insert(activeCells_.end(), newCells.begin(), newCells.end());
+      winnerCells_.push_back(result.winnerCell);
+
+      if (learn) {
+        if (result.matched) {
+          connections_.endAdaptSegment(result.adaptations.front());
+          const Int32 nGrowDesired = maxNewSynapseCount_ - numActivePotentialSynapsesForSegment_[result.bestMatchingSegment];
+          if (nGrowDesired > 0) {
+            connections_.growSynapses(result.bestMatchingSegment, prevWinnerCells, initialPermanence_, rngFor(i), nGrowDesired, maxSynapsesPerSegment_);
+          }
+        } else {
+          // Don't grow a segment that will never match.
+          const UInt32 nGrowExact =
+              std::min(static_cast<UInt32>(maxNewSynapseCount_), static_cast<UInt32>(prevWinnerCells.size()));
+          if (nGrowExact > 0) {
+            const Segment segment = connections_.createSegment(result.winnerCell, maxSegmentsPerCell_);
+            connections_.growSynapses(segment, prevWinnerCells, initialPermanence_, rngFor(i), nGrowExact, maxSynapsesPerSegment_);
+            NTA_ASSERT(connections.numSynapses(segment) == nGrowExact);
+          }
+        }
+      }
+    }
+    else {
+      for (const auto &adaptation : result.adaptations) {
+        connections_.endAdaptSegment(adaptation);
+      }
+    }
+  }
+}
+
+
+void TemporalMemory::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+  threadPool_ = pool;
+  connections_.setThreadPool(pool);
+}
+
+
 void TemporalMemory::activateDendrites(const bool learn,
                                        const SDR &externalPredictiveInputsActive,
                                        const SDR &externalPredictiveInputsWinners)
@@ -387,32 +563,43 @@ void TemporalMemory::activateDendrites(const bool learn,
       winnerCells_.push_back( static_cast<CellIdx>(winner + numberOfCells()) );
   }
 
-  const size_t length = connections.segmentFlatListLength();
-
-  numActivePotentialSynapsesForSegment_.assign(length, 0);
-  numActiveConnectedSynapsesForSegment_ = connections_.computeActivity(
-                              numActivePotentialSynapsesForSegment_,
-                              activeCells_,
-			      learn);
+  connections_.computeActivitySparse(numActiveConnectedSynapsesForSegment_,
+                                     numActivePotentialSynapsesForSegment_,
+                                     touchedSegments_,
+                                     activeCells_,
+                                     learn);
 
-  // Active segments, connected synapses.
   activeSegments_.clear();
-  for (size_t segment = 0; segment < numActiveConnectedSynapsesForSegment_.size(); segment++) {
-    if (numActiveConnectedSynapsesForSegment_[segment] >= activationThreshold_) { //TODO move to SegmentData.numConnected?
-      activeSegments_.push_back(static_cast<UInt>(segment));
+  matchingSegments_.clear();
+  if (minThreshold_ > 0 and minThreshold_ <= activationThreshold_) {
+    // Only touched segments can match, and every active segment also matches
+    // (a connected synapse is a potential synapse too).
+    for (const auto segment : touchedSegments_) {
+      if (numActivePotentialSynapsesForSegment_[segment] >= minThreshold_) {
+        matchingSegments_.push_back(segment);
+      }
+    }
+    connections.sortSegments(matchingSegments_); //SDR requires sorted when constructed from activeSegments_
+    for (const auto segment : matchingSegments_) {
+      if (numActiveConnectedSynapsesForSegment_[segment] >= activationThreshold_) {
+        activeSegments_.push_back(segment);
+      }
     }
   }
-  const auto compareSegments = [&](const Segment a, const Segment b) { return connections.compareSegments(a, b); };
-  std::sort( activeSegments_.begin(), activeSegments_.end(), compareSegments); //SDR requires sorted when constructed from activeSegments_
-
-  // Matching segments, potential synapses.
-  matchingSegments_.clear();
-  for (size_t segment = 0; segment < numActivePotentialSynapsesForSegment_.size(); segment++) {
-    if (numActivePotentialSynapsesForSegment_[segment] >= minThreshold_) {
-      matchingSegments_.push_back(static_cast<UInt>(segment));
+  else {
+    // Segments without any active synapse can pass the thresholds, scan all segments.
+    const size_t length = connections.segmentFlatListLength();
+    for (size_t segment = 0; segment < length; segment++) {
+      if (numActiveConnectedSynapsesForSegment_[segment] >= activationThreshold_) {
+        activeSegments_.push_back(static_cast<Segment>(segment));
+      }
+      if (numActivePotentialSynapsesForSegment_[segment] >= minThreshold_) {
+        matchingSegments_.push_back(static_cast<Segment>(segment));
+      }
     }
+    connections.sortSegments(activeSegments_);
+    connections.sortSegments(matchingSegments_);
   }
-  std::sort( matchingSegments_.begin(), matchingSegments_.end(), compareSegments);
 
   segmentsValid_ = true;
 }
@@ -670,6 +857,34 @@ getComparableSegmentSet(const Connections &connections,
   return segmentSet;
 }
 
+void TemporalMemory::saveSnapshot(const std::string &path) const {
+  // The members other than the connections are small, they are stored as one
+  // binary archive.
+  std::stringstream state;
+  {
+    cereal::BinaryOutputArchive ar(state);
+    saveState_(ar, false);
+  }
+  const std::string bytes = state.str();
+  SnapshotWriter snapshot("TemporalMemory");
+  snapshot.add("state", vector<char>(bytes.begin(), bytes.end()));
+  connections_.saveSnapshot(snapshot, "connections.");
+  snapshot.saveFile(path);
+}
+
+
+void TemporalMemory::loadSnapshot(const std::string &path) {
+  SnapshotReader snapshot(path);
+  NTA_CHECK(snapshot.kind() == "TemporalMemory")
+      << "'" << path << "' is a snapshot of " << snapshot.kind() << ", not of TemporalMemory.";
+  connections_.loadSnapshot(snapshot, "connections.");
+  const auto state = snapshot.get<char>("state");
+  std::istringstream in(std::string(state.begin(), state.end()));
+  cereal::BinaryInputArchive ar(in);
+  loadState_(ar, false);
+}
+
+
 bool TemporalMemory::operator==(const TemporalMemory &other) const {
   if (numColumns_ != other.numColumns_ ||
       columnDimensions_ != other.columnDimensions_ ||
@@ -27,6 +27,7 @@
 #include <htm/types/Sdr.hpp>
 #include <htm/types/Serializable.hpp>
 #include <htm/utils/Random.hpp>
+#include <htm/utils/ThreadPool.hpp>
 #include <htm/algorithms/AnomalyLikelihood.hpp>
 
 #include <vector>
@@ -200,10 +201,29 @@ public:
    *
    * @param learn
    * If true, reinforce / punish / grow synapses.
+   *
+   * With a thread pool (see setThreadPool()) the columns are processed in
+   * parallel: the permanences are adapted concurrently, then the structural
+   * changes (connected synapse bookkeeping, pruning, createSegment,
+   * growSynapses) are applied serially in column order. Each column draws
+   * from its own random stream, seeded from the TM's seed and the column
+   * index, so the results do not depend on the number of threads. They are
+   * not the same as the serial results though.
    */
   void activateCells(const SDR &activeColumns, 
                      const bool learn = true);
 
+  /**
+   * Process the columns in activateCells() and compute the segment activity
+   * in activateDendrites() on this pool of threads. This switches
+   * activateCells() to its parallel mode, see there. The pool is not
+   * serialized.
+   *
+   * @param pool ThreadPool to use, or nullptr (default) to run serially.
+   */
+  void setThreadPool(std::shared_ptr<ThreadPool> pool);
+  std::shared_ptr<ThreadPool> getThreadPool() const { return threadPool_; }
+
   /**
    * Calculate dendrite segment activity, using the current active cells.  Call
    * this method before calling getPredictiveCells, getActiveSegments, or
@@ -443,6 +463,18 @@ public:
    */
   SynapseIdx getMaxSynapsesPerSegment() const;
 
+  /**
+   * Save the temporal memory to a snapshot file and load it back. The
+   * connections are stored in flat sections which are loaded with one bulk
+   * copy each, see Connections::saveSnapshot and Snapshot.hpp. Much faster
+   * than the Serializable formats for large models, but not portable between
+   * machines with a different byte order.
+   *
+   * @param path File to write or read.
+   */
+  void saveSnapshot(const std::string &path) const;
+  void loadSnapshot(const std::string &path);
+
   /**
    * Save (serialize) / Load (deserialize) the current state of the spatial pooler
    * to the specified stream.
@@ -471,7 +503,15 @@ public:
 
   CerealAdapter;
   template<class Archive>
-  void save_ar(Archive & ar) const {
+  void save_ar(Archive & ar) const { saveState_(ar, true); }
+  template<class Archive>
+  void load_ar(Archive & ar) { loadState_(ar, true); }
+
+private:
+  // The members in archive order. The connections are left out of the
+  // archive of a snapshot, which stores them in sections of their own.
+  template<class Archive>
+  void saveState_(Archive & ar, const bool withConnections) const {
     ar(CEREAL_NVP(numColumns_),
        CEREAL_NVP(cellsPerColumn_),
        CEREAL_NVP(activationThreshold_),
@@ -493,8 +533,8 @@ public:
        CEREAL_NVP(segmentsValid_),
        CEREAL_NVP(tmAnomaly_.anomaly_),
        CEREAL_NVP(tmAnomaly_.mode_),
-       CEREAL_NVP(tmAnomaly_.anomalyLikelihood_),
-       CEREAL_NVP(connections_));
+       CEREAL_NVP(tmAnomaly_.anomalyLikelihood_));
+    if(withConnections) ar(CEREAL_NVP(connections_));
     
     size_t activeSize = activeSegments_.size();
     ar(CEREAL_NVP(activeSize));
@@ -534,7 +574,7 @@ public:
 
   }
   template<class Archive>
-  void load_ar(Archive & ar) {
+  void loadState_(Archive & ar, const bool withConnections) {
     ar(CEREAL_NVP(numColumns_),
        CEREAL_NVP(cellsPerColumn_),
        CEREAL_NVP(activationThreshold_),
@@ -556,13 +596,17 @@ public:
        CEREAL_NVP(segmentsValid_),
        CEREAL_NVP(tmAnomaly_.anomaly_),
        CEREAL_NVP(tmAnomaly_.mode_),
-       CEREAL_NVP(tmAnomaly_.anomalyLikelihood_),
-       CEREAL_NVP(connections_));
+       CEREAL_NVP(tmAnomaly_.anomalyLikelihood_));
+    if(withConnections) ar(CEREAL_NVP(connections_));
     
+    numActiveConnectedSynapsesForSegment_.assign(connections.segmentFlatListLength(), 0);
+    numActivePotentialSynapsesForSegment_.assign(connections.segmentFlatListLength(), 0);
+    activeSegments_.clear();
+    matchingSegments_.clear();
+
     size_t activeSize;
     ar(CEREAL_NVP(activeSize));
     if (activeSize > 0) {
-      numActiveConnectedSynapsesForSegment_.assign(connections.segmentFlatListLength(), 0);
       cereal::size_type numActiveSegments;
       ar(cereal::make_size_tag(numActiveSegments));
       activeSegments_.resize(static_cast<size_t>(numActiveSegments));
@@ -577,7 +621,6 @@ public:
     size_t matchSize;
     ar(CEREAL_NVP(matchSize));
     if (matchSize > 0) {
-      numActivePotentialSynapsesForSegment_.assign(connections.segmentFlatListLength(), 0);
       cereal::size_type numMatchingSegments;
       ar(cereal::make_size_tag(numMatchingSegments));
       matchingSegments_.resize(static_cast<size_t>(numMatchingSegments));
@@ -589,8 +632,11 @@ public:
         numActivePotentialSynapsesForSegment_[segment] = c.syn;
       }
     }
+    touchedSegments_ = matchingSegments_;
+    touchedSegments_.insert(touchedSegments_.end(), activeSegments_.begin(), activeSegments_.end());
   }
 
+public:
 
   virtual bool operator==(const TemporalMemory &other) const;
   inline bool operator!=(const TemporalMemory &other) const { return not this->operator==(other); }
@@ -660,7 +706,27 @@ private:
 		     const SynapseIdx nDesiredNewSynapses,
 		     const vector<CellIdx> &prevWinnerCells);
 
-  CellIdx getLeastUsedCell_(const CellIdx column);
+  CellIdx getLeastUsedCell_(const CellIdx column, Random &rng) const;
+
+  /**
+   * The segments of a column which activateCells() has to process.
+   */
+  struct ColumnSegments_ {
+    UInt column;
+    bool active;
+    vector<Segment>::const_iterator activeSegmentsBegin;
+    vector<Segment>::const_iterator activeSegmentsEnd;
+    vector<Segment>::const_iterator matchingSegmentsBegin;
+    vector<Segment>::const_iterator matchingSegmentsEnd;
+  };
+
+  /**
+   * The parallel mode of activateCells(), for the columns collected by it.
+   */
+  void activateColumnsParallel_(const vector<ColumnSegments_> &columns,
+                                const SDR &prevActiveCells,
+                                const vector<CellIdx> &prevWinnerCells,
+                                const bool learn);
 
   void calculateAnomalyScore_(const SDR &activeColumns);
 
@@ -690,8 +756,10 @@ private:
   vector<Segment> matchingSegments_;
   vector<SynapseIdx> numActiveConnectedSynapsesForSegment_;
   vector<SynapseIdx> numActivePotentialSynapsesForSegment_;
+  vector<Segment> touchedSegments_; //segments with non zero counts in the two vectors above
 
   Random rng_;
+  std::shared_ptr<ThreadPool> threadPool_;
 
   /**
    * holds logic and data for TM's anomaly
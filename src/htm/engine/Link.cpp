@@ -18,6 +18,7 @@
 /** @file
  * Implementation of the Link class
  */
+#include <algorithm> // lower_bound, rotate
 #include <cstring> // memcpy,memset
 #include <htm/engine/Input.hpp>
 #include <htm/engine/Link.hpp>
@@ -103,17 +104,20 @@ void Link::initialize(size_t destinationOffset, bool is_FanIn) {
   // Initialize the propagation delay buffer
   // But skip it if it already has something in it from deserialize().
   // ---
-  if (propagationDelay_ > 0 && propagationDelayBuffer_.empty()) {
+  if (propagationDelay_ > 0 && delayCount_ == 0) {
     // Initialize delay data elements.  This must be done during initialize()
     // because the buffer size is not known prior to then.
     // front of queue will be the next value to be copied to the dest Input buffer.
     // back of queue will be the same as the current contents of source Output.
     Array &output_buffer = src_->getData();
+    propagationDelayBuffer_.clear();
     for (size_t i = 0; i < (propagationDelay_); i++) {
       Array delayedbuffer = output_buffer.copy();
       delayedbuffer.zeroBuffer();
       propagationDelayBuffer_.push_back(delayedbuffer);
     }
+    delayHead_ = 0;
+    delayCount_ = propagationDelay_;
   }
 
   initialized_ = true;
@@ -219,10 +223,92 @@ Input* Link::getDest() const {
 
 void Link::compute() {
   NTA_CHECK(initialized_);
+  const bool profiling = profilingEnabled_;
+  LatencyHistogram::clock::time_point begin;
+  if (profiling)
+    begin = LatencyHistogram::clock::now();
+
+  if (queued_) {
+    // Keep a copy of the source until the destination pulls it. The transfer
+    // is timed by pull(), which delivers it.
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    pushDelayed_(src_->getData());
+    return;
+  } else if (propagationDelay_) {
+    // Copy data from source to destination. For delayed links, will copy from
+    // head of circular queue; otherwise directly from source.
+    shiftBufferedData();
+  } else {
+    copyToDest_(src_->getData());
+  }
+
+  if (profiling)
+    transferHistogram_.recordSince(begin);
+}
+
+void Link::pull() {
+  NTA_CHECK(initialized_);
+  NTA_CHECK(queued_) << "Link::pull() " << getMoniker() << " is not queued.";
+  const bool profiling = profilingEnabled_;
+  LatencyHistogram::clock::time_point begin;
+  if (profiling)
+    begin = LatencyHistogram::clock::now();
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  NTA_CHECK(delayCount_ > 0)
+      << "Link::pull() " << getMoniker() << ": the source has not run yet.";
+  Array &head = propagationDelayBuffer_[delayHead_];
+  copyToDest_(head);
+  if (dest_->getData().isInstance(head)) {
+    // The destination shares the buffer now, the slot must not reuse it.
+    head = Array(head.getType());
+  }
+  popDelayed_();
+
+  if (profiling)
+    transferHistogram_.recordSince(begin);
+}
+
+void Link::resetProfiling() {
+  transferHistogram_.reset();
+  bytesMoved_ = 0;
+  allocations_ = 0;
+}
+
+void Link::setQueued(bool queued) {
+  NTA_CHECK(initialized_);
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  if (!queued) {
+    // drop the newest values, they are never pulled.
+    if (delayCount_ > propagationDelay_)
+      delayCount_ = propagationDelay_;
+  }
+  NTA_CHECK(delayCount_ == propagationDelay_);
+  queued_ = queued;
+}
+
+// Replace the bits [offset, offset + src.size) of dest with the value of src,
+// working on the sparse indices of both. The other bits of dest, which come
+// from other links of a fan-in, are kept.
+static void copySparseInto(const SDR &src, SDR &dest, size_t offset) {
+  const SDR_sparse_t &from = src.getSparse();
+  const SDR_sparse_t &to   = dest.getSparse();
+  const UInt begin = static_cast<UInt>(offset);
+  const UInt end   = static_cast<UInt>(offset + src.size);
+  const auto first = std::lower_bound(to.begin(), to.end(), begin);
+  const auto last  = std::lower_bound(first, to.end(), end);
+
+  // Merge into a scratch vector, which is then swapped into dest. The two
+  // vectors trade places on every call so they do not allocate once grown.
+  static thread_local SDR_sparse_t merged;
+  merged.clear();
+  merged.insert(merged.end(), to.begin(), first);
+  for (const UInt idx : from)
+    merged.push_back(idx + begin);
+  merged.insert(merged.end(), last, to.end());
+  dest.setSparse(merged);
+}
 
-  // Copy data from source to destination. For delayed links, will copy from
-  // head of circular queue; otherwise directly from source.
-  const Array &src = propagationDelay_ ? shiftBufferedData() : src_->getData();
+void Link::copyToDest_(const Array &src) {
   Array &dest = dest_->getData();
 
   NTA_DEBUG << "compute Link: copying " << getMoniker() 
@@ -237,30 +323,85 @@ void Link::compute() {
 
   if (src.getType() == dest.getType() && (!is_FanIn_ || is_Overwrite_) && propagationDelay_==0) {
     dest = src;   // Performs a shallow copy. Data not copied but passed in shared_ptr.
+  } else if (src.getType() == NTA_BasicType_SDR && dest.getType() == NTA_BasicType_SDR) {
+    // Both sides are sparse, copy the active bits only.
+    copySparseInto(src.getSDR(), dest.getSDR(), destOffset_);
+    if (profilingEnabled_)
+      bytesMoved_ += src.getSDR().getSparse().size() * sizeof(ElemSparse);
   } else {
     // we must perform a deep copy with possible type conversion.
     // It is copied into the destination Input
     // buffer at the specified offset so an Input with multiple incoming links
     // has the Output buffers appended into a single large Input buffer.
     src.convertInto(dest, destOffset_, dest.getCount());
+    if (dest.getType() == NTA_BasicType_SDR) {
+      // convertInto() wrote into the dense buffer of the SDR, tell the SDR.
+      // Converted values other than 0 and 1 are clamped to 1 in place.
+      SDR &sdr = dest.getSDR();
+      for (auto &bit : sdr.getDense())
+        bit = (bit != 0u);
+      sdr.setDenseInplace();
+    }
+    if (profilingEnabled_)
+      bytesMoved_ += src.getCount() * BasicType::getSize(dest.getType());
   }
 }
 
-const Array Link::shiftBufferedData() {
-    NTA_CHECK(propagationDelayBuffer_.size() == (propagationDelay_));
-    Array to = propagationDelayBuffer_.front();
-    Array& from = src_->getData();
+void Link::shiftBufferedData() {
+  NTA_CHECK(delayCount_ == propagationDelay_);
+
+  // The head of the queue is the value to copy to destination.
+  copyToDest_(propagationDelayBuffer_[delayHead_]);
+
+  // Pop the head of the queue and push a copy of the source Output buffer on
+  // the back. With a full ring this overwrites the slot which was just popped.
+  popDelayed_();
+  pushDelayed_(src_->getData());
+}
 
-    // push a copy of the source Output buffer on the back of the queue.
-    // This must be a deep copy.
-    Array a = from.copy();
-    propagationDelayBuffer_.push_back(a);
+// Copy the value of from into slot, reusing the storage of slot if it has the
+// same shape. For an SDR only the sparse indices are copied.
+// Returns false if the slot had to be allocated.
+static bool copyIntoSlot(const Array &from, Array &slot) {
+  if (slot.has_buffer() && slot.getType() == from.getType() && slot.getCount() == from.getCount()) {
+    if (from.getType() == NTA_BasicType_SDR) {
+      if (slot.getSDR().dimensions == from.getSDR().dimensions) {
+        const SDR_sparse_t &sparse = from.getSDR().getSparse();
+        slot.getSDR().setSparse(sparse);  // copies, does not swap.
+        return true;
+      }
+    } else if (from.getType() != NTA_BasicType_Str) {
+      std::memcpy(slot.getBuffer(), from.getBuffer(), from.getCount() * BasicType::getSize(from.getType()));
+      return true;
+    }
+  }
+  slot = from.copy();
+  return false;
+}
 
-    // Pop the head of the queue
-    // The top of the queue now becomes the value to copy to destination.
-    propagationDelayBuffer_.pop_front();
+void Link::pushDelayed_(const Array &value) {
+  if (delayCount_ == propagationDelayBuffer_.size()) {
+    // Full, add a slot at the back of the ring. Only happens while queued.
+    std::rotate(propagationDelayBuffer_.begin(),
+                propagationDelayBuffer_.begin() + delayHead_,
+                propagationDelayBuffer_.end());
+    delayHead_ = 0;
+    propagationDelayBuffer_.emplace_back(value.getType());
+  }
+  const size_t tail = (delayHead_ + delayCount_) % propagationDelayBuffer_.size();
+  const bool reused = copyIntoSlot(value, propagationDelayBuffer_[tail]);
+  delayCount_++;
+
+  // Only the allocations are counted here, the bytes are counted once when
+  // copyToDest_() delivers the value.
+  if (profilingEnabled_ && !reused)
+    allocations_++;
+}
 
-    return to;
+void Link::popDelayed_() {
+  NTA_ASSERT(delayCount_ > 0);
+  delayHead_ = (delayHead_ + 1) % propagationDelayBuffer_.size();
+  delayCount_--;
 }
 
 std::deque<Array> Link::preSerialize() const {
@@ -283,12 +424,10 @@ std::deque<Array> Link::preSerialize() const {
     Array a = dest_->getData().subset(destOffset_, srcCount);
     delay.push_back(a); // our part of the current Dest Input buffer.
 
-    for (auto itr = propagationDelayBuffer_.begin();
-          itr != propagationDelayBuffer_.end(); itr++) {
-      if (itr + 1 == propagationDelayBuffer_.end())
-        break; // skip the last buffer. Its the current output.
-      delay.push_back(*itr);
-    } // end for
+    // skip the last buffer. Its the current output.
+    for (size_t i = 0; i + 1 < delayCount_; i++) {
+      delay.push_back(propagationDelayBuffer_[(delayHead_ + i) % propagationDelayBuffer_.size()]);
+    }
   }
   return delay;
 }
@@ -325,8 +464,8 @@ std::ostream &operator<<(std::ostream &f, const Link &link) {
   f << "  propagationDelay: " << link.getPropagationDelay()<< ",\n";
   if (link.getPropagationDelay() > 0) {
   	f <<   "   [\n";
-	  for (auto buf : link.propagationDelayBuffer_) {
-		  f << "    " << buf << "\n";
+	  for (size_t i = 0; i < link.delayCount_; i++) {
+		  f << "    " << link.propagationDelayBuffer_[(link.delayHead_ + i) % link.propagationDelayBuffer_.size()] << "\n";
 	  }
 	  f <<   "   ]\n";
   }
@@ -23,12 +23,16 @@
 #define NTA_LINK_HPP
 
 #include <string>
+#include <atomic>
 #include <deque>
+#include <mutex>
+#include <vector>
 
 #include <htm/ntypes/Array.hpp>
 #include <htm/ntypes/Dimensions.hpp>
 #include <htm/types/Types.hpp>
 #include <htm/types/Serializable.hpp>
+#include <htm/utils/LatencyHistogram.hpp>
 
 namespace htm {
 
@@ -428,12 +432,56 @@ public:
 
 
   /*
-   * for delayed links, remove head element of
-   * the propagation delay buffer and push back the current value from source.
-   * Return the value that was just poped from the head of the queue.
+   * for delayed links, copy the head element of the propagation delay buffer
+   * to the destination, then replace it with the current value from source.
+   * The buffer is a ring of preallocated Arrays so this does not allocate;
+   * for SDRs only the sparse indices are copied.
    *
    */
-  const Array shiftBufferedData();
+  void shiftBufferedData();
+
+  /**
+   * Queue the transfers of this link, for pipelined execution.
+   *
+   * While queued, compute() appends a copy of the source data to the back of
+   * the propagation delay buffer and leaves the destination alone, and pull()
+   * moves the value at the front of the buffer into the destination. The
+   * destination sees the same sequence of values as with compute(), provided
+   * the source region runs before the destination region in each iteration,
+   * but the source may run ahead of the destination by several iterations.
+   * compute() and pull() may be called from different threads.
+   *
+   * Turning queueing off drops the values which were not pulled, so that
+   * the buffer holds propagationDelay values again.
+   */
+  void setQueued(bool queued);
+  bool isQueued() const { return queued_; }
+
+  /**
+   * Copy the oldest queued value to the destination. See setQueued().
+   */
+  void pull();
+
+  /**
+   * @name Profiling
+   *
+   * While profiling is enabled the link records the duration of each
+   * transfer to the destination, the number of bytes it delivers, and the
+   * number of buffers it allocates. A transfer is a compute(), or a pull()
+   * for a queued link. See Network::getProfile() for a report.
+   *
+   * @{
+   */
+  void enableProfiling() { profilingEnabled_ = true; }
+  void disableProfiling() { profilingEnabled_ = false; }
+  void resetProfiling();
+
+  const LatencyHistogram &getTransferHistogram() const { return transferHistogram_; }
+  /** Bytes copied into the destination, not counting the buffers shared with it. */
+  UInt64 getBytesMoved() const { return bytesMoved_.load(std::memory_order_relaxed); }
+  /** Buffers allocated for the propagation delay. */
+  UInt64 getAllocations() const { return allocations_.load(std::memory_order_relaxed); }
+  /** @} */
 
   /**
    * Convert the Link to a human-readable string.
@@ -489,8 +537,12 @@ public:
        cereal::make_nvp("destOffset", destOffset_),
        cereal::make_nvp("is_FanIn", is_FanIn_),
        cereal::make_nvp("is_Overwrite", is_Overwrite_),
-       cereal::make_nvp("propagationDelay", propagationDelay_),
-       cereal::make_nvp("propagationDelayBuffer", propagationDelayBuffer_));
+       cereal::make_nvp("propagationDelay", propagationDelay_));
+    std::deque<Array> delay;
+    ar(cereal::make_nvp("propagationDelayBuffer", delay));
+    propagationDelayBuffer_.assign(delay.begin(), delay.end());
+    delayHead_ = 0;
+    delayCount_ = delay.size();
     initialized_ = false;
   }
 
@@ -506,6 +558,14 @@ private:
 
   std::deque<Array> preSerialize() const;
 
+  // copy a value from the source, or from the delay buffer, into the destination
+  void copyToDest_(const Array &src);
+
+  // append a copy of value to the delay buffer, growing it if it is full
+  void pushDelayed_(const Array &value);
+  // drop the oldest value of the delay buffer, keeping its storage
+  void popDelayed_();
+
 
   std::string srcRegionName_;
   std::string destRegionName_;
@@ -527,11 +587,25 @@ private:
   bool is_FanIn_;
   bool is_Overwrite_;
 
-  // Queue buffer for delayed source data buffering
-  std::deque<Array> propagationDelayBuffer_;
+  // Queue buffer for delayed source data buffering. This is a ring, the
+  // oldest value is at delayHead_ and it holds delayCount_ values.
+  std::vector<Array> propagationDelayBuffer_;
+  size_t delayHead_ = 0;
+  size_t delayCount_ = 0;
   // Number of delay slots
   size_t propagationDelay_;
 
+  // see setQueued(). The mutex guards the buffer while queued.
+  bool queued_ = false;
+  std::mutex queueMutex_;
+
+  // see enableProfiling(). Toggled from other threads (eg. the REST API)
+  // while the links run.
+  std::atomic<bool> profilingEnabled_{false};
+  LatencyHistogram transferHistogram_;
+  std::atomic<UInt64> bytesMoved_{0};
+  std::atomic<UInt64> allocations_{0};
+
   // link must be initialized before it can compute()
   bool initialized_;
 };
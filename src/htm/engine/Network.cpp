@@ -19,8 +19,14 @@
 Implementation of the Network class
 */
 
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <queue>
 #include <sstream>
 #include <stdexcept>
 
@@ -69,6 +75,7 @@ void Network::commonInit() {
   iteration_ = 0;
   minEnabledPhase_ = 0;
   maxEnabledPhase_ = 0;
+  pipelineDepth_ = 1;
 }
 
 Network::~Network() {
@@ -614,30 +621,29 @@ void Network::run(int n, std::vector<UInt32> phases) {
       << "maxphase: " << maxEnabledPhase_ << " size: " << phaseInfo_.size();
 
 
+  const bool parallel = threadPool_ != nullptr && threadPool_->numThreads() > 1u;
+  std::vector<std::shared_ptr<Region>> schedule;
+
+  if (parallel && pipelineDepth_ > 1u && n > 1 && callbacks_.getCount() == 0u) {
+    // Nothing observes the network in between iterations, so they may overlap.
+    schedule_(phases, schedule);
+    runPipelined_(schedule, static_cast<UInt64>(n));
+    return;
+  }
+
   for (int iter = 0; iter < n; iter++) {
     iteration_++;
 
-    // In phase order and order of region definition within a phase, execute each region.
-    // After executing a region, move the output buffer to the input buffer for each link.
-    if (!phases.empty()) {
-      // execute the specified phases only.
-      for (UInt32 phase : phases) {
-        NTA_CHECK(phase < phaseInfo_.size()) << "Phase ID " << phase << " specified in run() is out of range.";
-        for (auto r : phaseInfo_[phase]) {
-          //r->prepareInputs();       // For each link pull sources for each input
-          r->compute();
-          r->pushOutputsOverLinks();  // copy outputs to inputs for each link.
-        }
-      }
+    // The schedule is collected for every iteration because a callback may change the phases.
+    schedule_(phases, schedule);
+
+    if (parallel && schedule.size() > 1u) {
+      runParallel_(schedule);
     } else {
-      // compute all enabled regions in phase order, within a phase
-      // execute regions in the order they were placed into the phase.
-      for (UInt32 current_phase = minEnabledPhase_; current_phase <= maxEnabledPhase_; current_phase++) {
-        for (auto r : phaseInfo_[current_phase]) {
-          //r->prepareInputs();       // For each link pull sources for each input
-          r->compute();
-          r->pushOutputsOverLinks();  // copy outputs to inputs for each link.
-        }
+      for (auto &r : schedule) {
+        //r->prepareInputs();       // For each link pull sources for each input
+        r->compute();
+        r->pushOutputsOverLinks();  // copy outputs to inputs for each link.
       }
     }
 
@@ -669,6 +675,258 @@ void Network::run(int n, std::vector<UInt32> phases) {
 
 
 
+void Network::schedule_(const std::vector<UInt32> &phases,
+                        std::vector<std::shared_ptr<Region>> &schedule) const {
+  // In phase order and order of region definition within a phase, execute each region.
+  // After executing a region, move the output buffer to the input buffer for each link.
+  schedule.clear();
+  if (!phases.empty()) {
+    // execute the specified phases only.
+    for (UInt32 phase : phases) {
+      NTA_CHECK(phase < phaseInfo_.size()) << "Phase ID " << phase << " specified in run() is out of range.";
+      schedule.insert(schedule.end(), phaseInfo_[phase].begin(), phaseInfo_[phase].end());
+    }
+  } else {
+    // compute all enabled regions in phase order, within a phase
+    // execute regions in the order they were placed into the phase.
+    for (UInt32 current_phase = minEnabledPhase_; current_phase <= maxEnabledPhase_; current_phase++) {
+      schedule.insert(schedule.end(), phaseInfo_[current_phase].begin(), phaseInfo_[current_phase].end());
+    }
+  }
+}
+
+
+// The regions whose state changes when the given region runs: the region itself,
+// and the regions which it pushes its outputs into, except over queued links.
+static std::set<const Region *> touchedRegions(const Region &region) {
+  std::set<const Region *> touches = { &region };
+  for (const auto &out : region.getOutputs()) {
+    for (const auto &link : out.second->getLinks()) {
+      if (!link->isQueued())
+        touches.insert(link->getDest()->getRegion());
+    }
+  }
+  return touches;
+}
+
+
+void Network::runParallel_(const std::vector<std::shared_ptr<Region>> &schedule) {
+  // Build the dependency graph. A region writes into the inputs of the regions
+  // it links to, so two regions conflict if they have one of these regions in
+  // common (counting themselves). Chaining the regions which touch the same
+  // region, in schedule order, orders every conflicting pair.
+  const size_t numNodes = schedule.size();
+  std::vector<std::vector<size_t>> successors(numNodes);
+  std::vector<UInt> numPredecessors(numNodes, 0u);
+  std::map<const Region *, size_t> lastTouched;
+  for (size_t node = 0u; node < numNodes; node++) {
+    for (const Region *r : touchedRegions(*schedule[node])) {
+      const auto prev = lastTouched.find(r);
+      if (prev != lastTouched.end()) {
+        auto &succ = successors[prev->second];
+        if (succ.empty() || succ.back() != node) {
+          succ.push_back(node);
+          numPredecessors[node]++;
+        }
+        prev->second = node;
+      } else {
+        lastTouched[r] = node;
+      }
+    }
+  }
+
+  // Run the graph. Each thread of the pool takes the first ready region in
+  // schedule order, so a busy pool (which runs all tasks in this thread)
+  // executes the regions in their serial order.
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+  for (size_t node = 0u; node < numNodes; node++) {
+    if (numPredecessors[node] == 0u) ready.push(node);
+  }
+  size_t remaining = numNodes;
+  bool failed = false;
+
+  threadPool_->parallelFor(threadPool_->numThreads(), [&](size_t) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [&]() { return !ready.empty() || remaining == 0u || failed; });
+      if (remaining == 0u || failed) return;
+      const size_t node = ready.top();
+      ready.pop();
+      lock.unlock();
+
+      try {
+        schedule[node]->compute();
+        schedule[node]->pushOutputsOverLinks();  // copy outputs to inputs for each link.
+      } catch (...) {
+        lock.lock();
+        failed = true;
+        wake.notify_all();
+        throw;
+      }
+
+      lock.lock();
+      remaining--;
+      for (const size_t succ : successors[node]) {
+        if (--numPredecessors[succ] == 0u) ready.push(succ);
+      }
+      wake.notify_all();
+    }
+  });
+}
+
+
+void Network::runPipelined_(const std::vector<std::shared_ptr<Region>> &schedule, UInt64 n) {
+  const size_t numRegions = schedule.size();
+  if (numRegions == 0u) {
+    iteration_ += n;
+    return;
+  }
+
+  // Queue the links which go forward in the schedule, between regions which
+  // run once per iteration. The destination pulls their data just before it
+  // runs, so the source does not have to wait for it.
+  std::map<const Region *, size_t> position;
+  std::set<const Region *> repeated;
+  for (size_t p = 0u; p < numRegions; p++) {
+    if (!position.emplace(schedule[p].get(), p).second)
+      repeated.insert(schedule[p].get());
+  }
+  std::set<std::pair<size_t, size_t>> sameIteration, nextIteration; // edges p -> q
+  std::vector<std::vector<Link *>> pulls(numRegions);
+  std::vector<std::shared_ptr<Link>> queued;
+  for (size_t p = 0u; p < numRegions; p++) {
+    if (repeated.count(schedule[p].get())) continue;
+    for (const auto &out : schedule[p]->getOutputs()) {
+      for (const auto &link : out.second->getLinks()) {
+        const auto dest = position.find(link->getDest()->getRegion());
+        if (dest == position.end() || dest->second <= p || repeated.count(dest->first)) continue;
+        link->setQueued(true);
+        queued.push_back(link);
+        pulls[dest->second].push_back(link.get());
+        sameIteration.emplace(p, dest->second);
+      }
+    }
+  }
+
+  // The other dependencies are found as in runParallel_(), over two
+  // consecutive iterations. They are the same between any two iterations.
+  std::vector<std::set<const Region *>> touches(numRegions);
+  for (size_t p = 0u; p < numRegions; p++) {
+    touches[p] = touchedRegions(*schedule[p]);
+  }
+  std::map<const Region *, size_t> lastTouched;
+  for (size_t node = 0u; node < 2u * numRegions; node++) {
+    for (const Region *r : touches[node % numRegions]) {
+      const auto prev = lastTouched.find(r);
+      if (prev != lastTouched.end() && prev->second < numRegions) {
+        if (node < numRegions) sameIteration.emplace(prev->second, node);
+        else                   nextIteration.emplace(prev->second, node - numRegions);
+      }
+      lastTouched[r] = node;
+    }
+  }
+  std::vector<std::vector<size_t>> successors(numRegions), successorsNext(numRegions);
+  std::vector<UInt> numPredecessors(numRegions, 0u), numPredecessorsNext(numRegions, 0u);
+  for (const auto &edge : sameIteration) {
+    successors[edge.first].push_back(edge.second);
+    numPredecessors[edge.second]++;
+  }
+  for (const auto &edge : nextIteration) {
+    successorsNext[edge.first].push_back(edge.second);
+    numPredecessorsNext[edge.second]++;
+  }
+
+  // Run the graph. A node is a region in an iteration, numbered
+  // iteration * numRegions + position. Regions of iterations beyond the
+  // pipeline depth wait even if their inputs are ready, which bounds the
+  // length of the link queues.
+  struct IterationState {
+    std::vector<UInt> pending;  // number of unfinished predecessors of each region
+    size_t remaining;           // number of unfinished regions
+  };
+  std::map<UInt64, IterationState> open;
+  auto state = [&](UInt64 k) -> IterationState & {
+    auto it = open.find(k);
+    if (it == open.end()) {
+      IterationState st{numPredecessors, numRegions};
+      if (k > 0u) {
+        for (size_t q = 0u; q < numRegions; q++) st.pending[q] += numPredecessorsNext[q];
+      }
+      it = open.emplace(k, std::move(st)).first;
+    }
+    return it->second;
+  };
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::priority_queue<UInt64, std::vector<UInt64>, std::greater<UInt64>> ready;
+  for (size_t p = 0u; p < numRegions; p++) {
+    if (state(0u).pending[p] == 0u) ready.push(p);
+  }
+  UInt64 done = 0u;
+  bool failed = false;
+  const auto inWindow = [&]() {
+    return !ready.empty() && ready.top() / numRegions < done + pipelineDepth_;
+  };
+
+  const auto unqueue = [&]() {
+    for (auto &link : queued) link->setQueued(false);
+  };
+  try {
+    threadPool_->parallelFor(threadPool_->numThreads(), [&](size_t) {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        wake.wait(lock, [&]() { return done == n || failed || inWindow(); });
+        if (done == n || failed) return;
+        const UInt64 node = ready.top();
+        ready.pop();
+        lock.unlock();
+
+        const UInt64 k = node / numRegions;
+        const size_t p = node % numRegions;
+        try {
+          for (Link *link : pulls[p]) link->pull();
+          schedule[p]->compute();
+          schedule[p]->pushOutputsOverLinks();  // copy outputs to inputs for each link.
+        } catch (...) {
+          lock.lock();
+          failed = true;
+          wake.notify_all();
+          throw;
+        }
+
+        lock.lock();
+        IterationState &current = state(k);
+        for (const size_t q : successors[p]) {
+          if (--current.pending[q] == 0u) ready.push(k * numRegions + q);
+        }
+        if (k + 1u < n) {
+          IterationState &next = state(k + 1u);
+          for (const size_t q : successorsNext[p]) {
+            if (--next.pending[q] == 0u) ready.push((k + 1u) * numRegions + q);
+          }
+        }
+        state(k).remaining--;
+        // Every region depends on itself in the previous iteration, so the
+        // iterations finish in order.
+        while (!open.empty() && open.begin()->first == done && open.begin()->second.remaining == 0u) {
+          open.erase(open.begin());
+          done++;
+          iteration_++;
+        }
+        wake.notify_all();
+      }
+    });
+  } catch (...) {
+    unqueue();
+    throw;
+  }
+  unqueue();
+}
+
+
 const Collection<std::shared_ptr<Region>> Network::getRegions() const { 
   Collection<std::shared_ptr<Region>> regions;
   for(auto r: regions_) {
@@ -762,6 +1020,8 @@ void Network::post_load(std::vector<std::shared_ptr<Link>>& links) {
                      alink->getDestInputName(),
                      alink->getPropagationDelay());
       l->propagationDelayBuffer_ = alink->propagationDelayBuffer_;
+      l->delayHead_ = alink->delayHead_;
+      l->delayCount_ = alink->delayCount_;
     }
     post_load();
 }
@@ -897,6 +1157,8 @@ void Network::enableProfiling() {
     std::shared_ptr<Region> r = p.second;
     r->enableProfiling();
   }
+  for (auto &link : getLinks())
+    link->enableProfiling();
 }
 
 void Network::disableProfiling() {
@@ -904,6 +1166,8 @@ void Network::disableProfiling() {
     std::shared_ptr<Region> r = p.second;
     r->disableProfiling();
   }
+  for (auto &link : getLinks())
+    link->disableProfiling();
 }
 
 void Network::resetProfiling() {
@@ -911,6 +1175,110 @@ void Network::resetProfiling() {
     std::shared_ptr<Region>  r = p.second;
     r->resetProfiling();
   }
+  for (auto &link : getLinks())
+    link->resetProfiling();
+}
+
+// A string in double quotes, for JSON and for Prometheus label values.
+static std::string quoted(const std::string &s) {
+  std::string q = "\"";
+  for (const char c : s) {
+    if (c == '"' || c == '\\') q += '\\';
+    if (c == '\n') q += "\\n";
+    else q += c;
+  }
+  return q + "\"";
+}
+
+static void jsonHistogram(std::ostream &f, const LatencyHistogram &h) {
+  f << "\"count\": " << h.getCount() << ", \"total\": " << h.getSum()
+    << ", \"p50\": " << h.getQuantile(0.5) << ", \"p99\": " << h.getQuantile(0.99)
+    << ", \"max\": " << h.getMax();
+}
+
+// Labels of the metrics of a link.
+static std::string linkLabels(const Link &link) {
+  return "src=" + quoted(link.getSrcRegionName() + "." + link.getSrcOutputName()) +
+         ",dest=" + quoted(link.getDestRegionName() + "." + link.getDestInputName());
+}
+
+// The samples of a Prometheus summary, name{labels,quantile="..."} plus
+// name_sum and name_count.
+static void promSummary(std::ostream &f, const std::string &name,
+                        const std::string &labels, const LatencyHistogram &h) {
+  f << name << "{" << labels << ",quantile=\"0.5\"} " << h.getQuantile(0.5) << "\n"
+    << name << "{" << labels << ",quantile=\"0.99\"} " << h.getQuantile(0.99) << "\n"
+    << name << "_sum{" << labels << "} " << h.getSum() << "\n"
+    << name << "_count{" << labels << "} " << h.getCount() << "\n";
+}
+
+std::string Network::getProfile(const std::string &format) const {
+  std::string fmt = format;
+  std::transform(fmt.begin(), fmt.end(), fmt.begin(), ::toupper);
+  const auto links = getLinks();
+
+  std::stringstream f;
+  f << std::setprecision(9);
+  if (fmt == "JSON") {
+    f << "{\"regions\": {";
+    const char *sep = "";
+    for (auto p : regions_) {
+      f << sep << "\n  " << quoted(p.first) << ": {";
+      jsonHistogram(f, p.second->getComputeHistogram());
+      f << "}";
+      sep = ",";
+    }
+    f << "},\n\"links\": [";
+    sep = "";
+    for (const auto &link : links) {
+      f << sep << "\n  {\"link\": " << quoted(link->getMoniker())
+        << ", \"src\": " << quoted(link->getSrcRegionName() + "." + link->getSrcOutputName())
+        << ", \"dest\": " << quoted(link->getDestRegionName() + "." + link->getDestInputName())
+        << ", ";
+      jsonHistogram(f, link->getTransferHistogram());
+      f << ", \"bytes\": " << link->getBytesMoved()
+        << ", \"allocations\": " << link->getAllocations() << "}";
+      sep = ",";
+    }
+    f << "]}\n";
+  } else if (fmt == "PROMETHEUS") {
+    f << "# HELP htm_region_compute_seconds Duration of the compute of a region.\n"
+      << "# TYPE htm_region_compute_seconds summary\n";
+    for (auto p : regions_) {
+      promSummary(f, "htm_region_compute_seconds", "region=" + quoted(p.first),
+                  p.second->getComputeHistogram());
+    }
+    f << "# HELP htm_region_compute_seconds_max Longest compute of a region.\n"
+      << "# TYPE htm_region_compute_seconds_max gauge\n";
+    for (auto p : regions_) {
+      f << "htm_region_compute_seconds_max{region=" << quoted(p.first) << "} "
+        << p.second->getComputeHistogram().getMax() << "\n";
+    }
+    f << "# HELP htm_link_transfer_seconds Duration of the transfers of a link.\n"
+      << "# TYPE htm_link_transfer_seconds summary\n";
+    for (const auto &link : links) {
+      promSummary(f, "htm_link_transfer_seconds", linkLabels(*link),
+                  link->getTransferHistogram());
+    }
+    f << "# HELP htm_link_transfer_seconds_max Longest transfer of a link.\n"
+      << "# TYPE htm_link_transfer_seconds_max gauge\n";
+    for (const auto &link : links) {
+      f << "htm_link_transfer_seconds_max{" << linkLabels(*link) << "} "
+        << link->getTransferHistogram().getMax() << "\n";
+    }
+    f << "# HELP htm_link_bytes_total Bytes copied by a link.\n"
+      << "# TYPE htm_link_bytes_total counter\n";
+    for (const auto &link : links)
+      f << "htm_link_bytes_total{" << linkLabels(*link) << "} " << link->getBytesMoved() << "\n";
+    f << "# HELP htm_link_allocations_total Buffers allocated by a link.\n"
+      << "# TYPE htm_link_allocations_total counter\n";
+    for (const auto &link : links)
+      f << "htm_link_allocations_total{" << linkLabels(*link) << "} " << link->getAllocations() << "\n";
+  } else {
+    NTA_THROW << "Network::getProfile(): unknown format '" << format
+              << "', expected JSON or PROMETHEUS.";
+  }
+  return f.str();
 }
 
   /*
@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -35,6 +36,7 @@
 #include <htm/types/Serializable.hpp>
 #include <htm/types/Types.hpp>
 #include <htm/utils/Log.hpp>
+#include <htm/utils/ThreadPool.hpp>
 
 namespace htm {
 
@@ -440,6 +442,50 @@ public:
   // execute specific phases in this order. Repeat n times.
   void run(int n, std::vector<UInt32> phases);  
 
+  /**
+   * Run independent regions of an iteration concurrently.
+   *
+   * With a thread pool, run() orders the regions of each iteration by their
+   * links rather than running them one by one. Two regions depend on each
+   * other if one links into the other (with or without a delay), or if both
+   * link into the same region; the one which comes first in the serial
+   * execution order (phase order, then order within the phase) runs first.
+   * Regions without such a dependency run at the same time. Every region
+   * therefore sees exactly the same inputs as in a serial run, and the
+   * callbacks are still invoked once all regions of an iteration are done.
+   *
+   * The region implementations must not share state other than through
+   * links. Python regions must not be run this way unless the bindings
+   * release the GIL for the duration of run().
+   *
+   * @param pool Pool to use, or nullptr (the default) to run serially.
+   *   A pool may be shared with the algorithms inside of the regions.
+   */
+  void setThreadPool(std::shared_ptr<ThreadPool> pool) { threadPool_ = pool; }
+  std::shared_ptr<ThreadPool> getThreadPool() const { return threadPool_; }
+
+  /**
+   * Overlap consecutive iterations of run(n).
+   *
+   * With a thread pool and a depth above 1, run(n) lets up to depth iterations
+   * be in flight at the same time, so that on a steady stream an encoder can
+   * work on iteration k+2 while the SP is on k+1 and the TM on k. Links which
+   * go forward in the execution order between regions which run once per
+   * iteration are queued for the duration of run() (see Link::setQueued()),
+   * every other link still orders its regions as described for
+   * setThreadPool(). The results are the same as in a serial run.
+   *
+   * Callbacks need the network to be in a consistent state after every
+   * iteration, so a network with callbacks is never pipelined. Iterations
+   * can only overlap within one call to run(n); data must come from the
+   * regions themselves (ie. a file or database), not be set in between calls.
+   *
+   * @param depth Maximum number of iterations in flight, 1 (the default)
+   *   disables pipelining.
+   */
+  void setPipelineDepth(UInt32 depth) { pipelineDepth_ = depth < 1u ? 1u : depth; }
+  UInt32 getPipelineDepth() const { return pipelineDepth_; }
+
   /**
    * The type of run callback function.
    *
@@ -473,19 +519,33 @@ public:
    */
 
   /**
-   * Start profiling for all regions of this network.
+   * Start profiling for all regions and links of this network.
    */
   void enableProfiling();
 
   /**
-   * Stop profiling for all regions of this network.
+   * Stop profiling for all regions and links of this network.
    */
   void disableProfiling();
 
   /**
-   * Reset profiling timers for all regions of this network.
+   * Reset profiling timers and counters for all regions and links of this network.
    */
   void resetProfiling();
+
+  /**
+   * Report the profile of all regions and links, see enableProfiling().
+   *
+   * For each region: the number of compute calls, their total duration and
+   * the 50th and 99th percentile and maximum of their duration. For each
+   * link: the same for its transfers, plus the bytes copied and the buffers
+   * allocated. Durations are in seconds.
+   *
+   * @param format "JSON", or "PROMETHEUS" for the Prometheus text exposition
+   *        format, with metrics named htm_region_* and htm_link_*.
+   * @returns the report.
+   */
+  std::string getProfile(const std::string &format = "JSON") const;
 	
   /**
    * Set one of the debug levels: LogLevel_None = 0, LogLevel_Minimal, LogLevel_Normal, LogLevel_Verbose
@@ -569,6 +629,15 @@ private:
   void resetEnabledPhases_();
   void phasesFromString(const std::string& phaseString);
 
+  // the regions executed by one iteration of run(), in order
+  void schedule_(const std::vector<UInt32> &phases, std::vector<std::shared_ptr<Region>> &schedule) const;
+
+  // execute one iteration of the given regions on threadPool_, see setThreadPool()
+  void runParallel_(const std::vector<std::shared_ptr<Region>> &schedule);
+
+  // execute n overlapping iterations on threadPool_, see setPipelineDepth()
+  void runPipelined_(const std::vector<std::shared_ptr<Region>> &schedule, UInt64 n);
+
   bool initialized_;
 	
 	/**
@@ -591,6 +660,10 @@ private:
 
   // number of elapsed iterations
   UInt64 iteration_;
+
+  // optional, runs independent regions concurrently
+  std::shared_ptr<ThreadPool> threadPool_;
+  UInt32 pipelineDepth_;
 };
 
 } // namespace htm
@@ -20,6 +20,7 @@
 /** @file
 Implementation of the RESTapi class
 */
+#include <algorithm>
 #include <htm/engine/RESTapi.hpp>
 #include <htm/engine/Network.hpp>
 #include <htm/engine/Spec.hpp>
@@ -312,3 +313,48 @@ std::string RESTapi::command_request(const std::string& id,
     return "{\"err\": " + Value::json_string("Unknown Exception.") + "}";
   }
 }
+
+std::string RESTapi::get_profile_request(const std::string &id, const std::string &format) {
+  try {
+    auto itr = resource_.find(id);
+    NTA_CHECK(itr != resource_.end()) << "Context for resource '" + id + "' not found.";
+    itr->second.t = time(0);
+
+    std::string fmt = (format.empty()) ? "JSON" : format;
+    std::transform(fmt.begin(), fmt.end(), fmt.begin(), ::toupper);
+    std::string response = itr->second.net->getProfile(fmt);
+    if (fmt == "JSON")
+      return "{\"result\": " + response + "}";
+    return response;
+  } catch (Exception &e) {
+    return "{\"err\": " + Value::json_string(e.getMessage()) + "}";
+  } catch (std::exception& e) {
+    return "{\"err\": " + Value::json_string(e.what()) + "}";
+  } catch (...) {
+    return "{\"err\": " + Value::json_string("Unknown Exception.") + "}";
+  }
+}
+
+std::string RESTapi::put_profile_request(const std::string &id, const std::string &action) {
+  try {
+    auto itr = resource_.find(id);
+    NTA_CHECK(itr != resource_.end()) << "Context for resource '" + id + "' not found.";
+    itr->second.t = time(0);
+
+    if (action == "enable")
+      itr->second.net->enableProfiling();
+    else if (action == "disable")
+      itr->second.net->disableProfiling();
+    else if (action == "reset")
+      itr->second.net->resetProfiling();
+    else
+      NTA_THROW << "Unexpected profile action '" << action << "', expected enable, disable or reset.";
+    return "{\"result\": \"OK\"}";
+  } catch (Exception &e) {
+    return "{\"err\": " + Value::json_string(e.getMessage()) + "}";
+  } catch (std::exception& e) {
+    return "{\"err\": " + Value::json_string(e.what()) + "}";
+  } catch (...) {
+    return "{\"err\": " + Value::json_string("Unknown Exception.") + "}";
+  }
+}
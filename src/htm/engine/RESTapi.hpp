@@ -333,6 +333,39 @@ public:
    */
   std::string command_request(const std::string &id, const std::string &region_name, const std::string& command);
 
+  /**
+   * @b Description:
+   * Handler for a GET "profile" request message.
+   * Reports the compute latency of each region and the transfer latency,
+   * bytes and allocations of each link. See Network::getProfile().
+   *
+   * @param id  Identifier for the resource context (a Network class instance).
+   *            Client should pass the id returned by the previous "configure"
+   *            request message.
+   *
+   * @param format  "JSON" (the default if empty) or "PROMETHEUS".
+   *
+   * @retval            If success returns the profile, JSON encoded, or the
+   *                    Prometheus text format as is.
+   *                    Otherwise returns JSON encoded error message.
+   */
+  std::string get_profile_request(const std::string &id, const std::string &format);
+
+  /**
+   * @b Description:
+   * Handler for a PUT "profile" request message.
+   *
+   * @param id  Identifier for the resource context (a Network class instance).
+   *            Client should pass the id returned by the previous "configure"
+   *            request message.
+   *
+   * @param action  "enable", "disable" or "reset" profiling of all regions and links.
+   *
+   * @retval            If success returns "OK".
+   *                    Otherwise returns JSON encoded error message.
+   */
+  std::string put_profile_request(const std::string &id, const std::string &action);
+
 
 
 private:
@@ -175,12 +175,13 @@ std::string Region::executeCommand(const std::vector<std::string> &args) {
     NTA_THROW << "Invalid empty command specified";
   }
 
-  if (profilingEnabled_)
+  const bool profiling = profilingEnabled_;
+  if (profiling)
     executeTimer_.start();
 
   retVal = impl_->executeCommand(args, (UInt64)(-1));
 
-  if (profilingEnabled_)
+  if (profiling)
     executeTimer_.stop();
 
   return retVal;
@@ -191,13 +192,19 @@ void Region::compute() {
     NTA_THROW << "Region " << getName()
               << " unable to compute because not initialized";
 
-  if (profilingEnabled_)
+  const bool profiling = profilingEnabled_;
+  LatencyHistogram::clock::time_point begin;
+  if (profiling) {
     computeTimer_.start();
+    begin = LatencyHistogram::clock::now();
+  }
 
   impl_->compute();
 
-  if (profilingEnabled_)
+  if (profiling) {
+    computeHistogram_.recordSince(begin);
     computeTimer_.stop();
+  }
 
   return;
 }
@@ -313,6 +320,7 @@ void Region::disableProfiling() { profilingEnabled_ = false; }
 void Region::resetProfiling() {
   computeTimer_.reset();
   executeTimer_.reset();
+  computeHistogram_.reset();
 }
 
 const Timer &Region::getComputeTimer() const { return computeTimer_; }
@@ -25,6 +25,7 @@
 #ifndef NTA_REGION_HPP
 #define NTA_REGION_HPP
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
@@ -35,6 +36,7 @@
 #include <htm/engine/Spec.hpp>
 #include <htm/ntypes/Dimensions.hpp>
 #include <htm/os/Timer.hpp>
+#include <htm/utils/LatencyHistogram.hpp>
 #include <htm/types/Serializable.hpp>
 #include <htm/types/Types.hpp>
 #include <htm/ntypes/Value.hpp>
@@ -407,6 +409,12 @@ public:
    */
   const Timer &getExecuteTimer() const;
 
+  /**
+   * Get the histogram of the durations of the compute operation, for its
+   * quantiles. See Network::getProfile() for a report of all regions.
+   */
+  const LatencyHistogram &getComputeHistogram() const { return computeHistogram_; }
+
   bool operator==(const Region &other) const;
   inline bool operator!=(const Region &other) const {
     return !operator==(other);
@@ -574,10 +582,12 @@ private:
   // This cannot be a shared_ptr.
   Network *network_;
 
-  // Profiling related methods and variables.
-  bool profilingEnabled_;
+  // Profiling related methods and variables. Toggled from other threads
+  // (eg. the REST API) while the regions run.
+  std::atomic<bool> profilingEnabled_;
   Timer computeTimer_;
   Timer executeTimer_;
+  LatencyHistogram computeHistogram_;
 };
 
 } // namespace htm
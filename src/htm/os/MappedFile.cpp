@@ -0,0 +1,104 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+/** @file
+ * Implementation of MappedFile
+ */
+
+#include <htm/os/MappedFile.hpp>
+#include <htm/utils/Log.hpp>
+
+#if defined(NTA_OS_WINDOWS)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #include <cerrno>
+  #include <cstring> // strerror
+#endif
+
+namespace htm {
+
+#if defined(NTA_OS_WINDOWS)
+
+MappedFile::MappedFile(const std::string &path, bool sequential) : path_(path) {
+  const DWORD flags = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, flags, nullptr);
+  NTA_CHECK(file != INVALID_HANDLE_VALUE) << "MappedFile: unable to open file '" << path << "'.";
+  file_ = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    NTA_THROW << "MappedFile: unable to get the size of '" << path << "'.";
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0)
+    return; // An empty file can not be mapped, there is nothing to read.
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (view == nullptr) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    NTA_THROW << "MappedFile: unable to map file '" << path << "'.";
+  }
+  mapping_ = mapping;
+  data_ = static_cast<const char *>(view);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) UnmapViewOfFile(data_);
+  if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+  if (file_) CloseHandle(static_cast<HANDLE>(file_));
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path, bool sequential) : path_(path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  NTA_CHECK(fd >= 0) << "MappedFile: unable to open file '" << path << "': " << strerror(errno);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    NTA_THROW << "MappedFile: unable to get the size of '" << path << "': " << strerror(errno);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    void *view = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+      close(fd);
+      NTA_THROW << "MappedFile: unable to map file '" << path << "': " << strerror(errno);
+    }
+    if (sequential)
+      madvise(view, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(view);
+  }
+  close(fd); // the mapping keeps the file open.
+}
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(const_cast<char *>(data_), size_);
+}
+
+#endif
+
+} // namespace htm
@@ -0,0 +1,74 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+/** @file
+ * Read only memory mapped file
+ */
+
+#ifndef NTA_MAPPED_FILE_HPP
+#define NTA_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace htm {
+
+/**
+ * @Responsibility
+ * Map a whole file into memory, read only.
+ *
+ * @Description
+ * The pages of the file are read by the OS when they are first accessed and
+ * may be dropped again under memory pressure, so the resident memory is
+ * bounded regardless of the size of the file, and opening a file is fast.
+ * The mapping is released when the object is destroyed.
+ *
+ * Example Usage:
+ *    MappedFile f("data.bin");
+ *    const char *bytes = f.data();  // f.size() bytes
+ */
+class MappedFile {
+public:
+  /**
+   * @param path  The file to map.
+   * @param sequential  Hint to the OS that the file will be read in order,
+   *                    so that it reads ahead and drops the pages behind.
+   * @throws if the file can not be opened or mapped.
+   */
+  explicit MappedFile(const std::string &path, bool sequential = true);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string &path() const { return path_; }
+
+private:
+  std::string path_;
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+#if defined(NTA_OS_WINDOWS)
+  void *file_ = nullptr;    // HANDLE
+  void *mapping_ = nullptr; // HANDLE
+#endif
+};
+
+} // namespace htm
+
+#endif // NTA_MAPPED_FILE_HPP
@@ -19,6 +19,7 @@
  * Implementation for DatabaseRegion class
  */
 
+#include <algorithm>
 #include <iostream>
 #include <list>
 #include <sstream>
@@ -37,14 +38,24 @@
 namespace htm {
 
 static const UInt MAX_NUMBER_OF_INPUTS = 10;// maximal number of inputs/scalar streams in the database
+static const UInt MAX_NUMBER_OF_SDR_INPUTS = 4;// maximal number of SDR streams in the database
 static UInt auxRowCnt; // Auxiliary variable for getting row count from callback
 
 static int SQLcallback(void *data, int argc, char **argv, char **azColName);
 
+static void checkJournalMode(const std::string &mode) {
+  static const std::vector<std::string> modes = {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"};
+  NTA_CHECK(std::find(modes.begin(), modes.end(), mode) != modes.end())
+      << "DatabaseRegion -- unknown journalMode '" << mode << "'";
+}
+
 
 DatabaseRegion::DatabaseRegion(const ValueMap &params, Region* region)
     : RegionImpl(region), filename_(""),
 	  dbHandle(nullptr),xTransactionActive(false) {
+  commitInterval_ = params.getScalarT<UInt32>("commitInterval", 0);
+  journalMode_ = params.getString("journalMode", "WAL");
+  checkJournalMode(journalMode_);
   if (params.contains("outputFile")) {
     std::string s = params.getString("outputFile", "");
     openFile(s);
@@ -71,72 +82,114 @@ void DatabaseRegion::initialize() {
 
   NTA_ASSERT(inputs.size()!=0) << "DatabaseRegion::initialize - no inputs configured\n";
 
-  iTableCount = 0;
-	for (const auto & inp : inputs) {
+  NTA_CHECK(dbHandle != nullptr) << "DatabaseRegion::initialize - no outputFile is open\n";
+
+  openStreams();
+}
+
+// Creates the tables of the linked inputs, if the file does not have them yet,
+// and prepares their inserts. Also called by compute() after the file was
+// (re)opened, since a restored network does not call initialize().
+void DatabaseRegion::openStreams() {
+  finalizeStatements();
+  streams_.clear();
+	for (const auto & inp : region_->getInputs()) {
 		const auto inObj = inp.second;
 		if (inObj->hasIncomingLinks() && inObj->getData().getCount() != 0) { //create tables only for those, whose was configured
-			createTable("dataStream_" + inp.first);
-			iTableCount++;
+			const bool sdr = inp.first.compare(0, 5, "sdrIn") == 0;
+			createTable((sdr ? "sdrStream_" : "dataStream_") + inp.first, inp.first, sdr,
+			            inObj->getData().getCount());
 		}
 	}
-
 }
 
-void DatabaseRegion::createTable(const std::string &sTableName){
+void DatabaseRegion::createTable(const std::string &sTableName, const std::string &sInputName,
+                                 bool sdr, size_t count){
+	Stream stream;
+	stream.table = sTableName;
+	stream.input = sInputName;
+	stream.sdr = sdr;
+	stream.blob = sdr || count > 1;
+	stream.insert = nullptr;
 
 	/* Create SQL statement */
-	std::string  sql = "CREATE TABLE "+sTableName+" (iteration INTEGER PRIMARY KEY, value REAL);";
+	std::string  sql = "CREATE TABLE IF NOT EXISTS "+sTableName+" (iteration INTEGER PRIMARY KEY, value "
+	                   + (stream.blob ? "BLOB" : "REAL") + ");";
 
 	char *zErrMsg;
 	/* Execute SQL statement */
 	int returnCode = sqlite3_exec(dbHandle, sql.c_str(), nullptr, 0, &zErrMsg);
 
 	if( returnCode != SQLITE_OK ){
-		NTA_THROW << "Error creating SQL table, message:"
-				  << zErrMsg;
+		std::string message = zErrMsg;
 		sqlite3_free(zErrMsg);
+		NTA_THROW << "Error creating SQL table, message:"
+				  << message;
 	}
-}
-
-void DatabaseRegion::insertData(const std::string &sTableName, const std::shared_ptr<Input> inputData){
 
-	NTA_ASSERT(inputData->getData().getCount()==1);
-
-	if(!xTransactionActive){
-		//starts transaction, for speedup. Transaction ends by closing the file
-		ExecuteSQLcommand("BEGIN TRANSACTION");
-		xTransactionActive = true;
+	// The insert is parsed once here and only bound and stepped on each compute.
+	sql = "INSERT INTO "+sTableName+"(value) VALUES (?);";
+	returnCode = sqlite3_prepare_v2(dbHandle, sql.c_str(), -1, &stream.insert, nullptr);
+	if( returnCode != SQLITE_OK ){
+		NTA_THROW << "Error preparing insert into SQL table " << sTableName << ", message:"
+				  << sqlite3_errmsg(dbHandle);
 	}
+	streams_.push_back(stream);
+}
 
-	Real32* value = (Real32 *)inputData->getData().getBuffer();
-	/* Create SQL statement */
-	std::string  sql = "INSERT INTO "+sTableName+"(value) VALUES ("+std::to_string(*value) + ");";
-
-	char *zErrMsg;
+void DatabaseRegion::finalizeStatements() {
+	for (auto &stream : streams_) {
+		sqlite3_finalize(stream.insert);
+		stream.insert = nullptr;
+	}
+}
 
-	int returnCode = sqlite3_exec(dbHandle, sql.c_str(), nullptr, 0, &zErrMsg);
+void DatabaseRegion::insertData(Stream &stream){
+	const Array &data = region_->getInput(stream.input)->getData();
+	int returnCode;
+	if (stream.sdr) {
+		const SDR_sparse_t &sparse = data.getSDR().getSparse();
+		returnCode = sparse.empty()
+		    ? sqlite3_bind_zeroblob(stream.insert, 1, 0)
+		    : sqlite3_bind_blob(stream.insert, 1, sparse.data(),
+		                        static_cast<int>(sparse.size() * sizeof(ElemSparse)), SQLITE_STATIC);
+	} else if (stream.blob) {
+		returnCode = sqlite3_bind_blob(stream.insert, 1, data.getBuffer(),
+		                               static_cast<int>(data.getCount() * sizeof(Real32)), SQLITE_STATIC);
+	} else {
+		NTA_ASSERT(data.getCount()==1);
+		returnCode = sqlite3_bind_double(stream.insert, 1, *((const Real32 *)data.getBuffer()));
+	}
+	if( returnCode == SQLITE_OK )
+		returnCode = sqlite3_step(stream.insert);
+	sqlite3_reset(stream.insert);
 
-	if( returnCode != SQLITE_OK ){
-		NTA_THROW << "Error inserting data to SQL table, message:"
-				  << zErrMsg;
-		sqlite3_free(zErrMsg);
+	if( returnCode != SQLITE_DONE ){
+		NTA_THROW << "Error inserting data to SQL table " << stream.table << ", message:"
+				  << sqlite3_errmsg(dbHandle);
 	}
 }
 
 void DatabaseRegion::compute() {
 
+	NTA_CHECK(dbHandle != nullptr) << "DatabaseRegion::compute - no outputFile is open\n";
+	if (streams_.empty())
+		openStreams();
+	NTA_CHECK(!streams_.empty()) << "DatabaseRegion::compute - no inputs configured\n";
 
-	const std::map<std::string, std::shared_ptr<Input>> inputs = region_->getInputs();
-
+	if(!xTransactionActive){
+		//starts transaction, for speedup. Transaction ends every commitInterval computes or by closing the file
+		ExecuteSQLcommand("BEGIN TRANSACTION");
+		xTransactionActive = true;
+	}
 
-	NTA_ASSERT(inputs.size()!=0) << "DatabaseRegion::initialize - no inputs configured\n";
+	for (auto &stream : streams_)
+		insertData(stream);
 
-	for (const auto & inp : inputs)
-	{
-		const auto inObj = inp.second;
-		if (inObj->hasIncomingLinks() && inObj->getData().getCount() != 0) { //create tables only for those, whose was configured
-			insertData("dataStream_" + inp.first, inObj);
-		}
+	computeCount_++;
+	if (commitInterval_ > 0 && computeCount_ % commitInterval_ == 0) {
+		ExecuteSQLcommand("END TRANSACTION");
+		xTransactionActive = false;
 	}
 }
 
@@ -146,11 +199,12 @@ void DatabaseRegion::ExecuteSQLcommand(std::string sqlCommand){
 	int returnCode = sqlite3_exec(dbHandle, sqlCommand.c_str(), nullptr, 0, &zErrMsg);
 
 	if( returnCode != SQLITE_OK ){
-		NTA_THROW << "Error executing"
+		std::string message = zErrMsg;
+		sqlite3_free(zErrMsg);
+		NTA_THROW << "Error executing "
 				<< sqlCommand
 				<< ", message:"
-				<< zErrMsg;
-		sqlite3_free(zErrMsg);
+				<< message;
 	}
 }
 
@@ -162,6 +216,8 @@ void DatabaseRegion::closeFile() {
   		xTransactionActive=false;
   	}
 
+		finalizeStatements();
+		streams_.clear();
 		sqlite3_close(dbHandle);
 		dbHandle = nullptr;
     filename_ = "";
@@ -188,6 +244,17 @@ void DatabaseRegion::openFile(const std::string &filename) {
 	} else {
 		ifile.close();
 	}
+  // and the WAL journal files it may have left behind, otherwise sqlite
+  // would replay an old journal into the new database.
+  for (const std::string &journal : {filename + "-wal", filename + "-shm"}) {
+    std::ifstream jfile(journal.c_str());
+    if (jfile) {
+      jfile.close();
+      if (remove(journal.c_str()) != 0)
+        NTA_THROW << "DatabaseRegion::openFile -- Error deleting existing journal file! Filename:"
+                  << journal;
+    }
+  }
 
   // create new file
 
@@ -207,6 +274,10 @@ void DatabaseRegion::openFile(const std::string &filename) {
 
   //number of disk pages that will be hold in memory, adjust this to set up size of the cache
   ExecuteSQLcommand("PRAGMA cache_size=10000");
+  // With a write ahead log a commit appends to the log rather than rewriting pages.
+  ExecuteSQLcommand("PRAGMA journal_mode=" + journalMode_);
+  if (journalMode_ == "WAL")
+    ExecuteSQLcommand("PRAGMA synchronous=NORMAL");
 
 }
 
@@ -226,8 +297,8 @@ UInt DatabaseRegion::getRowCount(){
 
 	UInt sumRowCount = 0;
 
-	for (UInt i = 0; i< iTableCount; i ++){
-		std::string sTableName = "dataStream_dataIn"+std::to_string(i);
+	for (const auto &stream : streams_){
+		const std::string &sTableName = stream.table;
 
 		std::string sql = "SELECT COUNT(*) FROM "+sTableName+";";
 
@@ -236,10 +307,10 @@ UInt DatabaseRegion::getRowCount(){
 
 
 		if( returnCode != SQLITE_OK ){
-			NTA_THROW << "Error counting rows in SQL table, message:"
-						<< zErrMsg;
+			std::string message = zErrMsg;
 			sqlite3_free(zErrMsg);
-			return 0;
+			NTA_THROW << "Error counting rows in SQL table, message:"
+						<< message;
 		}else{
 			sumRowCount+=auxRowCnt;
 		}
@@ -256,6 +327,11 @@ void DatabaseRegion::setParameterString(const std::string &paramName,
     if (dbHandle!=nullptr)
       closeFile();
     openFile(s);
+  } else if (paramName == "journalMode") {
+    checkJournalMode(s);
+    journalMode_ = s;
+    if (dbHandle != nullptr)
+      ExecuteSQLcommand("PRAGMA journal_mode=" + journalMode_);
   } else {
     NTA_THROW << "DatabaseRegion -- Unknown string parameter " << paramName;
   }
@@ -265,6 +341,26 @@ std::string DatabaseRegion::getParameterString(const std::string &paramName,
                                                    Int64 index) const {
   if (paramName == "outputFile") {
     return filename_;
+  } else if (paramName == "journalMode") {
+    return journalMode_;
+  } else {
+    NTA_THROW << "DatabaseRegion -- unknown parameter " << paramName;
+  }
+}
+
+void DatabaseRegion::setParameterUInt32(const std::string &paramName,
+                                        Int64 index, UInt32 value) {
+  if (paramName == "commitInterval") {
+    commitInterval_ = value;
+  } else {
+    NTA_THROW << "DatabaseRegion -- Unknown UInt32 parameter " << paramName;
+  }
+}
+
+UInt32 DatabaseRegion::getParameterUInt32(const std::string &paramName,
+                                          Int64 index) const {
+  if (paramName == "commitInterval") {
+    return commitInterval_;
   } else {
     NTA_THROW << "DatabaseRegion -- unknown parameter " << paramName;
   }
@@ -313,6 +409,16 @@ Spec *DatabaseRegion::createSpec() {
 													true   // isDefaultInput
 													));
   }
+  for (UInt i = 0; i< MAX_NUMBER_OF_SDR_INPUTS; i ++){
+		ns->inputs.add("sdrIn"+std::to_string(i),
+								InputSpec("SDR to be written to the database as the indices of its active bits",
+													NTA_BasicType_SDR,
+													0,     // count
+													false, // required?
+													true, // isRegionLevel
+													false  // isDefaultInput
+													));
+  }
 
   ns->parameters.add("outputFile",
               ParameterSpec("Writes data stream to this database file on each "
@@ -327,6 +433,25 @@ Spec *DatabaseRegion::createSpec() {
                             "", // defaultValue
                             ParameterSpec::ReadWriteAccess));
 
+  ns->parameters.add("commitInterval",
+              ParameterSpec("Number of computes per transaction. If 0 the "
+                            "transaction is only committed by the "
+                            "commitTransaction command or closing the file.",
+                            NTA_BasicType_UInt32,
+                            1,   // elementCount
+                            "",  // constraints
+                            "0", // defaultValue
+                            ParameterSpec::ReadWriteAccess));
+
+  ns->parameters.add("journalMode",
+              ParameterSpec("SQLite journal_mode of the database, set when it is "
+                            "opened. WAL is the fastest for a single writer.",
+                            NTA_BasicType_Str,
+                            1,     // elementCount
+                            "",    // constraints
+                            "WAL", // defaultValue
+                            ParameterSpec::ReadWriteAccess));
+
   ns->commands.add("closeFile",
                    CommandSpec("Close the current database file, if open."));
   ns->commands.add("getRowCount",
@@ -350,6 +475,8 @@ bool DatabaseRegion::operator==(const RegionImpl &o) const {
   if (o.getType() != "DatabaseRegion") return false;
   DatabaseRegion& other = (DatabaseRegion&)o;
   if (filename_ != other.filename_) return false;
+  if (commitInterval_ != other.commitInterval_) return false;
+  if (journalMode_ != other.journalMode_) return false;
 
   return true;
 }
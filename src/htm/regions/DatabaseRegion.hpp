@@ -32,6 +32,8 @@
 #include <htm/types/Serializable.hpp>
 #include <htm/ntypes/Value.hpp>
 
+#include <vector>
+
 #include <sqlite3.h>
 
 namespace htm {
@@ -50,6 +52,16 @@ namespace htm {
  *  'datastream_'. Each table has two columns, iteration number and
  *  value. Iteration is incremented automatically by SQLite, since
  *  it is INTEGER PRIMARY KEY.
+ *  An input with more than one element is stored whole, as a BLOB of
+ *  its Real32 values.
+ *
+ *  SDRs can be connected to the inputs sdrIn0 ... sdrIn3. Each is stored
+ *  in a table with prefix 'sdrStream_', the value being a BLOB of the
+ *  UInt32 indices of its active bits.
+ *
+ *  The rows are inserted with prepared statements inside a transaction,
+ *  which is committed every 'commitInterval' computes, or by the
+ *  commitTransaction command, or when the file is closed.
  *
  */
 class DatabaseRegion : public RegionImpl, Serializable {
@@ -59,6 +71,8 @@ public:
   void setParameterString(const std::string &name, Int64 index,
                           const std::string &s) override;
   std::string getParameterString(const std::string &name, Int64 index) const override;
+  void setParameterUInt32(const std::string &name, Int64 index, UInt32 value) override;
+  UInt32 getParameterUInt32(const std::string &name, Int64 index) const override;
 
   void initialize() override;
 
@@ -75,15 +89,20 @@ public:
   void save_ar(Archive& ar) const {
     ar(cereal::make_nvp("outputFile", filename_));
     ar(CEREAL_NVP(dim_));  // in base class
+    ar(cereal::make_nvp("commitInterval", commitInterval_));
+    ar(cereal::make_nvp("journalMode", journalMode_));
   }
 
   // FOR Cereal Deserialization
   template<class Archive>
   void load_ar(Archive& ar) {
-    ar(cereal::make_nvp("outputFile", filename_));
-		if (filename_ != "")
-		      openFile(filename_);
+    std::string filename;
+    ar(cereal::make_nvp("outputFile", filename));
     ar(CEREAL_NVP(dim_));  // in base class
+    ar(cereal::make_nvp("commitInterval", commitInterval_));
+    ar(cereal::make_nvp("journalMode", journalMode_));
+		if (filename != "")
+		      openFile(filename);
   }
 
   bool operator==(const RegionImpl &other) const override;
@@ -100,15 +119,30 @@ public:
 private:
   void closeFile();
   void openFile(const std::string &filename);
-  void createTable(const std::string &sTableName);
-  void insertData(const std::string &sTableName, const std::shared_ptr<Input> inputData);
+  void openStreams();
+  void createTable(const std::string &sTableName, const std::string &sInputName, bool sdr,
+                   size_t count);
+  void finalizeStatements();
   UInt getRowCount();
   void ExecuteSQLcommand(std::string sqlCommand);
 
+  // A table and the prepared statement which inserts into it.
+  struct Stream {
+    std::string table;
+    std::string input;
+    bool sdr;             // value is the sparse indices of an SDR
+    bool blob;            // value is an array of Real32
+    sqlite3_stmt *insert;
+  };
+  void insertData(Stream &stream);
+
     std::string filename_;          // Name of the output file
+    UInt32 commitInterval_ = 0;     // computes per transaction, 0 commits only on request
+    std::string journalMode_ = "WAL";
 
     sqlite3 *dbHandle;		//Sqlite3 connection handle
-    htm::UInt iTableCount;
+    std::vector<Stream> streams_;
+    UInt64 computeCount_ = 0;
     bool xTransactionActive;
 
   /// Disable unsupported default constructors
@@ -201,6 +201,10 @@ std::string FileInputRegion::executeCommand(const std::vector<std::string> &args
       cout << "Reading binary file" << endl;
       labeled = 4;
     }
+    const char *mappedExtensions[] = {".htmv", nullptr};
+    if (argCount != 3 && checkExtensions(filename, mappedExtensions)) {
+      labeled = 7; // memory mapped binary file
+    }
 
     if (labeled > (UInt32)VectorFile::maxFormat())
       NTA_THROW << "FileInputRegion: unknown file format '" << labeled << "'";
@@ -278,10 +282,18 @@ std::string FileInputRegion::executeCommand(const std::vector<std::string> &args
 
     NTA_CHECK(argCount <= 5) << "FileInputRegion: too many arguments";
 
-    std::ofstream f(filename.c_str());
+    // Write all elements of the vectors, so that the file can be loaded
+    // again with the same configuration.
+    Size elementCount = activeOutputCount_;
+    if (hasCategoryOut_)
+      elementCount++;
+    if (hasResetOut_)
+      elementCount++;
+
+    std::ofstream f(filename.c_str(), (format >= 4) ? std::ios::binary : std::ios::out);
     if (!hasEnd)
-      end = vectorFile_.vectorCount() - 1;
-    vectorFile_.saveVectors(f, dataOut_.getCount(), format, begin, end);
+      end = vectorFile_.vectorCount();
+    vectorFile_.saveVectors(f, elementCount, format, begin, end);
   }
 
   else {
@@ -503,7 +515,8 @@ Spec *FileInputRegion::createSpec() {
         " 0 - Reads in unlabeled file with first number = element count\n"
         " 1 - Reads in a labeled file with first number = element count (deprecated)\n"
         " 2 - Reads in unlabeled file without element count (default)\n"
-        " 3 - Reads in a csv file\n"));
+        " 3 - Reads in a csv file\n"
+        " 7 - Maps a binary vector file, without reading it in (default for .htmv)\n"));
 
   ns->commands.add( "appendFile",
       CommandSpec(
@@ -513,13 +526,16 @@ Spec *FileInputRegion::createSpec() {
         " 0 - Reads in unlabeled file with first number = element count\n"
         " 1 - Reads in a labeled file with first number = element count (deprecated)\n"
         " 2 - Reads in unlabeled file without element count (default)\n"
-        " 3 - Reads in a csv file\n"));
+        " 3 - Reads in a csv file\n"
+        " A mapped binary vector file (7) can not be appended.\n"));
 
   ns->commands.add( "saveFile",
        CommandSpec("saveFile filename [format [begin [end]]]\n"
                               "Save the currently loaded vectors to a file. "
                               "Typically used for debugging\n"
-                              "but may be used to convert between formats.\n"));
+                              "but may be used to convert between formats.\n"
+                              "Format 7 writes a binary vector file, which\n"
+                              "loadFile maps into memory instead of reading it.\n"));
 
   ns->commands.add("dump",
        CommandSpec("Displays some debugging info."));
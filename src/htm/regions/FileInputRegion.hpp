@@ -89,6 +89,10 @@ namespace htm {
  *  The full list of vectors is read into memory when the loadFile command
  *  is executed.
  *
+ *  For large data sets, convert the file once to the binary vector format
+ *  (format 7, see VectorFile) with the saveFile command. loadFile maps such a
+ *  file into memory, and compute() reads one vector at a time from it.
+ *
  */
 
 class FileInputRegion : public RegionImpl, Serializable {
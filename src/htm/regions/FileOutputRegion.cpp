@@ -20,6 +20,7 @@
  *     (was VectorFileEffector)
  */
 
+#include <cstring>
 #include <iostream>
 #include <list>
 #include <sstream>
@@ -31,6 +32,7 @@
 #include <htm/engine/Region.hpp>
 #include <htm/engine/Spec.hpp>
 #include <htm/regions/FileOutputRegion.hpp>
+#include <htm/regions/VectorFile.hpp>
 #include <htm/utils/Log.hpp>
 
 namespace htm {
@@ -38,6 +40,10 @@ namespace htm {
 FileOutputRegion::FileOutputRegion(const ValueMap &params, Region* region)
     : RegionImpl(region), dataIn_(NTA_BasicType_Real64), filename_(""),
       outFile_(nullptr) {
+  format_ = params.getString("outputFormat", "csv");
+  NTA_CHECK(format_ == "csv" || format_ == "binary" || format_ == "sparse")
+      << "FileOutputRegion -- unknown outputFormat '" << format_ << "'";
+  flushInterval_ = params.getScalarT<UInt32>("flushInterval", 0);
   if (params.contains("outputFile")) {
     std::string s = params.getString("outputFile", "");
     openFile(s);
@@ -53,7 +59,13 @@ FileOutputRegion::FileOutputRegion(ArWrapper& wrapper, Region* region)
 }
 
 
-FileOutputRegion::~FileOutputRegion() { closeFile(); }
+FileOutputRegion::~FileOutputRegion() {
+  try {
+    closeFile();
+  } catch (const std::exception &e) {
+    NTA_WARN << "FileOutputRegion: " << e.what();
+  }
+}
 
 void FileOutputRegion::initialize() {
   NTA_CHECK(region_ != nullptr);
@@ -83,30 +95,172 @@ void FileOutputRegion::compute() {
     return;
   }
 
-  // Ensure we can write to it
-  if (outFile_->fail()) {
+  // Ensure we can write to it. The writer thread reports its own errors.
+  if (!writer_.joinable() && outFile_->fail()) {
     NTA_THROW << "FileOutputRegion: There was an error writing to the file "
               << filename_.c_str() << "\n";
   }
 
-
-  Real64 *inputVec = (Real64 *)(dataIn_.getBuffer());
+  const Real64 *inputVec = (const Real64 *)(dataIn_.getBuffer());
   NTA_CHECK(inputVec != nullptr);
+  const size_t count = dataIn_.getCount();
+  if (elements_ == 0)
+    elements_ = count;
+  NTA_CHECK(count == elements_)
+      << "FileOutputRegion: input width " << count
+      << " does not match the width of the vectors in " << filename_ << ", " << elements_;
+
+  // Only copy the raw record here, the formatting is done by writeRecords_().
+  if (format_ == "sparse") {
+    const size_t start = pending_.size();
+    pending_.resize(start + sizeof(UInt32) * (count + 1u));
+    UInt32 *record = reinterpret_cast<UInt32 *>(pending_.data() + start);
+    UInt32 nActive = 0u;
+    for (Size offset = 0; offset < count; ++offset) {
+      if (inputVec[offset] != 0.0)
+        record[++nActive] = static_cast<UInt32>(offset);
+    }
+    record[0] = nActive;
+    pending_.resize(start + sizeof(UInt32) * (nActive + 1u));
+  } else {
+    const char *bytes = reinterpret_cast<const char *>(inputVec);
+    pending_.insert(pending_.end(), bytes, bytes + count * sizeof(Real64));
+  }
+  pendingRecords_++;
+
+  if (flushInterval_ == 0u) {
+    writeRecords_(pending_);
+    pending_.clear();
+    pendingRecords_ = 0u;
+  } else if (pendingRecords_ >= flushInterval_) {
+    handOff_();
+  }
+}
+
+void FileOutputRegion::writeRecords_(const std::vector<char> &records) {
   std::ofstream &outFile = *outFile_;
-  for (Size offset = 0; offset < dataIn_.getCount(); ++offset) {
-    if (offset == 0)
-      outFile << inputVec[offset];
-    else
-      outFile << "," << inputVec[offset];
+  if (format_ == "csv") {
+    const Real64 *inputVec = reinterpret_cast<const Real64 *>(records.data());
+    const size_t n = records.size() / sizeof(Real64);
+    for (size_t row = 0; row < n; row += elements_) {
+      for (Size offset = 0; offset < elements_; ++offset) {
+        if (offset == 0)
+          outFile << inputVec[row + offset];
+        else
+          outFile << "," << inputVec[row + offset];
+      }
+      outFile << "\n";
+    }
+  } else {
+    if (format_ == "binary") {
+      if (!headerWritten_) {
+        headerWritten_ = true;
+        writeHeader_();
+      }
+      rows_ += records.size() / (elements_ * sizeof(Real64));
+    }
+    outFile.write(records.data(), static_cast<std::streamsize>(records.size()));
+  }
+}
+
+void FileOutputRegion::writeHeader_() {
+  if (!headerWritten_)
+    return;
+  VectorFile::MappedHeader header;
+  header.elements = elements_;
+  header.rows = rows_;
+  outFile_->seekp(0, std::ios::beg);
+  outFile_->write(reinterpret_cast<const char *>(&header), sizeof header);
+  outFile_->seekp(0, std::ios::end);
+}
+
+void FileOutputRegion::handOff_() {
+  if (!writer_.joinable()) {
+    writerStop_ = false;
+    writer_ = std::thread(&FileOutputRegion::writerLoop_, this);
+  }
+  std::unique_lock<std::mutex> lock(writerMutex_);
+  // If the writer is still busy with the previous buffer, wait for it.
+  writerCv_.wait(lock, [this] { return !writerBusy_; });
+  if (!writerError_.empty())
+    NTA_THROW << "FileOutputRegion: There was an error writing to the file "
+              << filename_ << ": " << writerError_;
+  writing_.swap(pending_);
+  pending_.clear();
+  pendingRecords_ = 0u;
+  writerBusy_ = true;
+  writerCv_.notify_all();
+}
+
+void FileOutputRegion::drain_() {
+  if (!pending_.empty())
+    handOff_();
+  if (writer_.joinable()) {
+    std::unique_lock<std::mutex> lock(writerMutex_);
+    writerCv_.wait(lock, [this] { return !writerBusy_; });
+    if (!writerError_.empty())
+      NTA_THROW << "FileOutputRegion: There was an error writing to the file "
+                << filename_ << ": " << writerError_;
+  }
+}
+
+void FileOutputRegion::stopWriter_() {
+  if (!writer_.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    writerStop_ = true;
+  }
+  writerCv_.notify_all();
+  writer_.join();
+  writerStop_ = false;
+}
+
+void FileOutputRegion::writerLoop_() {
+  std::unique_lock<std::mutex> lock(writerMutex_);
+  for (;;) {
+    writerCv_.wait(lock, [this] { return writerBusy_ || writerStop_; });
+    if (!writerBusy_)
+      return; // stopped, with nothing left to write.
+    lock.unlock();
+    std::string error;
+    try {
+      writeRecords_(writing_);
+      outFile_->flush();
+      if (outFile_->fail())
+        error = "write failed";
+    } catch (const std::exception &e) {
+      error = e.what();
+    }
+    lock.lock();
+    writing_.clear();
+    if (!error.empty())
+      writerError_ = error;
+    writerBusy_ = false;
+    writerCv_.notify_all();
   }
-  outFile << "\n";
 }
 
 void FileOutputRegion::closeFile() {
   if (outFile_) {
+    std::string error;
+    try {
+      drain_();
+    } catch (const std::exception &e) {
+      error = e.what();
+    }
+    stopWriter_();
+    if (format_ == "binary")
+      writeHeader_();
     outFile_->close();
+    delete outFile_;
     outFile_ = nullptr;
     filename_ = "";
+    pending_.clear();
+    pendingRecords_ = 0u;
+    writerError_.clear();
+    if (!error.empty())
+      NTA_THROW << error;
   }
 }
 
@@ -117,7 +271,37 @@ void FileOutputRegion::openFile(const std::string &filename) {
   if (filename == "")
     return;
 
-  outFile_ = new std::ofstream(filename.c_str(), std::ios::app);
+  elements_ = 0;
+  rows_ = 0;
+  headerWritten_ = false;
+  if (format_ == "binary") {
+    // Append to an existing binary file, which means its header must be
+    // rewritten, so the file is opened for update rather than append.
+    std::ifstream in(filename.c_str(), std::ios::binary | std::ios::ate);
+    const std::streamoff size = in ? static_cast<std::streamoff>(in.tellg()) : 0;
+    if (size > 0) {
+      VectorFile::MappedHeader header, expected;
+      in.seekg(0, std::ios::beg);
+      in.read(reinterpret_cast<char *>(&header), sizeof header);
+      NTA_CHECK(in && ::memcmp(header.magic, expected.magic, sizeof header.magic) == 0 &&
+                header.version == expected.version && header.byteOrder == expected.byteOrder &&
+                header.matchesFileSize(static_cast<UInt64>(size)))
+          << "FileOutputRegion::openFile -- '" << filename
+          << "' exists and is not a binary vector file which can be appended to.";
+      elements_ = static_cast<size_t>(header.elements);
+      rows_ = header.rows;
+      headerWritten_ = true;
+    } else {
+      std::ofstream create(filename.c_str(), std::ios::binary);
+    }
+    in.close();
+    outFile_ = new std::ofstream(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    outFile_->seekp(0, std::ios::end);
+  } else if (format_ == "sparse") {
+    outFile_ = new std::ofstream(filename.c_str(), std::ios::app | std::ios::binary);
+  } else {
+    outFile_ = new std::ofstream(filename.c_str(), std::ios::app);
+  }
   if (outFile_->fail())
   {
     delete outFile_;
@@ -138,6 +322,16 @@ void FileOutputRegion::setParameterString(const std::string &paramName,
     if (outFile_)
       closeFile();
     openFile(s);
+  } else if (paramName == "outputFormat") {
+    NTA_CHECK(s == "csv" || s == "binary" || s == "sparse")
+        << "FileOutputRegion -- unknown outputFormat '" << s << "'";
+    if (s == format_)
+      return;
+    // Reopen the file in the new format.
+    std::string filename = filename_;
+    closeFile();
+    format_ = s;
+    openFile(filename);
   } else {
     NTA_THROW << "FileOutputRegion -- Unknown string parameter " << paramName;
   }
@@ -147,6 +341,27 @@ std::string FileOutputRegion::getParameterString(const std::string &paramName,
                                                    Int64 index) const {
   if (paramName == "outputFile") {
     return filename_;
+  } else if (paramName == "outputFormat") {
+    return format_;
+  } else {
+    NTA_THROW << "FileOutputRegion -- unknown parameter " << paramName;
+  }
+}
+
+void FileOutputRegion::setParameterUInt32(const std::string &paramName,
+                                          Int64 index, UInt32 value) {
+  if (paramName == "flushInterval") {
+    drain_();
+    flushInterval_ = value;
+  } else {
+    NTA_THROW << "FileOutputRegion -- Unknown UInt32 parameter " << paramName;
+  }
+}
+
+UInt32 FileOutputRegion::getParameterUInt32(const std::string &paramName,
+                                            Int64 index) const {
+  if (paramName == "flushInterval") {
+    return flushInterval_;
   } else {
     NTA_THROW << "FileOutputRegion -- unknown parameter " << paramName;
   }
@@ -159,8 +374,12 @@ FileOutputRegion::executeCommand(const std::vector<std::string> &args,
   // Process the flushFile command
   if (args[0] == "flushFile") {
     // Ensure we have a valid file before flushing, otherwise fail silently.
-    if (!((outFile_ == nullptr) || (outFile_->fail()))) {
-      outFile_->flush();
+    if (outFile_ != nullptr) {
+      drain_();
+      if (format_ == "binary")
+        writeHeader_();
+      if (!outFile_->fail())
+        outFile_->flush();
     }
   } else if (args[0] == "closeFile") {
     closeFile();
@@ -170,6 +389,10 @@ FileOutputRegion::executeCommand(const std::vector<std::string> &args,
       NTA_THROW << "VectorFileEffector: echo command failed because there is "
                    "no file open";
     }
+    if (format_ != "csv") {
+      NTA_THROW << "VectorFileEffector: echo command requires the csv outputFormat";
+    }
+    drain_();
 
     for (size_t i = 1; i < args.size(); i++) {
       *outFile_ << args[i];
@@ -191,7 +414,8 @@ Spec *FileOutputRegion::createSpec() {
       "input vectors to a text file. The target filename is specified "
       "using the 'outputFile' parameter at run time. On each "
       "compute, the current input vector is written (but not flushed) "
-      "to the file.\n";
+      "to the file. With 'flushInterval' the vectors are buffered and "
+      "written by a background thread instead.\n";
 
   ns->inputs.add("dataIn",
               InputSpec("Data to be written to file",
@@ -216,6 +440,31 @@ Spec *FileOutputRegion::createSpec() {
                             "", // defaultValue
                             ParameterSpec::ReadWriteAccess));
 
+  ns->parameters.add("outputFormat",
+              ParameterSpec("Format of the output file. One of\n"
+                            "  csv    - comma separated text, one vector per line.\n"
+                            "  binary - binary vector file, FileInputRegion file format 7.\n"
+                            "  sparse - per vector a UInt32 count followed by the UInt32\n"
+                            "           indices of its non-zero elements.\n"
+                            "Set it before 'outputFile'; changing it reopens the file.\n",
+                            NTA_BasicType_Byte,
+                            0,     // elementCount
+                            "",    // constraints
+                            "csv", // defaultValue
+                            ParameterSpec::ReadWriteAccess));
+
+  ns->parameters.add("flushInterval",
+              ParameterSpec("Number of computes between writes. If 0 each vector "
+                            "is written during compute. Otherwise the vectors "
+                            "are buffered and every 'flushInterval' computes a "
+                            "background thread formats, writes and flushes them. "
+                            "Use the flushFile command to write the rest.\n",
+                            NTA_BasicType_UInt32,
+                            1,   // elementCount
+                            "",  // constraints
+                            "0", // defaultValue
+                            ParameterSpec::ReadWriteAccess));
+
   ns->commands.add("flushFile", CommandSpec("Flush file data to disk"));
 
   ns->commands.add("closeFile",
@@ -236,6 +485,8 @@ bool FileOutputRegion::operator==(const RegionImpl &o) const {
   if (o.getType() != "FileOutputRegion") return false;
   FileOutputRegion& other = (FileOutputRegion&)o;
   if (filename_ != other.filename_) return false;
+  if (format_ != other.format_) return false;
+  if (flushInterval_ != other.flushInterval_) return false;
 
   return true;
 }
@@ -27,6 +27,12 @@
 
 //----------------------------------------------------------------------
 
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <htm/engine/RegionImpl.hpp>
 #include <htm/ntypes/Array.hpp>
 #include <htm/types/Types.hpp>
@@ -51,6 +57,20 @@ namespace htm {
  *           :
  *        eM1 eM2 eM3 ... eMN
  *
+ *  The 'outputFormat' parameter selects one of:
+ *    csv    - the text format above (default), appended to the file.
+ *    binary - the fixed stride binary vector file of VectorFile format 7,
+ *             which FileInputRegion maps directly. The header is rewritten
+ *             on flushFile and closeFile. An existing file is appended to
+ *             if its vectors have the same width.
+ *    sparse - for each vector a UInt32 count followed by the UInt32 indices
+ *             of its non-zero elements, appended to the file.
+ *
+ *  When 'flushInterval' is N > 0 the vectors are buffered in raw form and
+ *  every N computes the buffer is handed to a background thread which
+ *  formats and writes it and then flushes the file. With 0 (the default)
+ *  each vector is written by compute() itself.
+ *
  *  VectorFileEffector implements the execute() commands as defined in the
  *  nodeSpec.
  *
@@ -62,6 +82,8 @@ public:
   void setParameterString(const std::string &name, Int64 index,
                           const std::string &s) override;
   std::string getParameterString(const std::string &name, Int64 index) const override;
+  void setParameterUInt32(const std::string &name, Int64 index, UInt32 value) override;
+  UInt32 getParameterUInt32(const std::string &name, Int64 index) const override;
 
   void initialize() override;
 
@@ -78,15 +100,20 @@ public:
   void save_ar(Archive& ar) const {
     ar(cereal::make_nvp("outputFile", filename_));
     ar(CEREAL_NVP(dim_));  // in base class
+    ar(cereal::make_nvp("outputFormat", format_));
+    ar(cereal::make_nvp("flushInterval", flushInterval_));
   }
 
   // FOR Cereal Deserialization
   template<class Archive>
   void load_ar(Archive& ar) {
-    ar(cereal::make_nvp("outputFile", filename_));
-		if (filename_ != "")
-		      openFile(filename_);
+    std::string filename;
+    ar(cereal::make_nvp("outputFile", filename));
     ar(CEREAL_NVP(dim_));  // in base class
+    ar(cereal::make_nvp("outputFormat", format_));
+    ar(cereal::make_nvp("flushInterval", flushInterval_));
+		if (filename != "")
+		      openFile(filename);
   }	
 
   bool operator==(const RegionImpl &other) const override;
@@ -104,9 +131,37 @@ private:
   void closeFile();
   void openFile(const std::string &filename);
 
+  // Hand the pending records to the writer thread, starting it if needed.
+  void handOff_();
+  // Write all pending records and wait until the writer thread is idle.
+  void drain_();
+  void stopWriter_();
+  void writerLoop_();
+  // Format and write a buffer of records. Runs on the writer thread if there is one.
+  void writeRecords_(const std::vector<char> &records);
+  // Rewrite the header of a binary file with the current row count.
+  void writeHeader_();
+
     Array dataIn_;
     std::string filename_;          // Name of the output file
     std::ofstream *outFile_;        // Handle to current file
+    std::string format_ = "csv";    // csv, binary or sparse
+    UInt32 flushInterval_ = 0;      // computes per hand off to the writer thread, 0 is synchronous
+
+    size_t elements_ = 0;           // width of each record
+    UInt64 rows_ = 0;               // records in a binary file
+    bool headerWritten_ = false;
+    std::vector<char> pending_;     // records not yet handed off, raw Real64 or sparse
+    UInt32 pendingRecords_ = 0;
+
+    // writer thread, the members below are guarded by writerMutex_
+    std::thread writer_;
+    std::mutex writerMutex_;
+    std::condition_variable writerCv_;
+    std::vector<char> writing_;
+    bool writerBusy_ = false;
+    bool writerStop_ = false;
+    std::string writerError_;
 
   /// Disable unsupported default constructors
   FileOutputRegion(const FileOutputRegion &);
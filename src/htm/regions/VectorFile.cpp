@@ -34,6 +34,8 @@
 using namespace std;
 using namespace htm;
 
+static_assert(sizeof(VectorFile::MappedHeader) == 32, "The vectors must be aligned");
+
 //----------------------------------------------------------------------------
 VectorFile::VectorFile() {}
 
@@ -54,6 +56,10 @@ void VectorFile::clear(bool clearScaling) {
   }
   fileVectors_.clear();
   own_.clear();
+  mapped_.reset();
+  mappedRows_ = nullptr;
+  mappedCount_ = 0;
+  mappedElements_ = 0;
 
   elementLabels_.clear();
   vectorLabels_.clear();
@@ -67,11 +73,19 @@ void VectorFile::clear(bool clearScaling) {
 void VectorFile::appendFile(const string &fileName,
                             Size expectedElementCount, UInt32 fileFormat) {
   bool handled = false;
+  if (fileFormat != 7) {
+    NTA_CHECK(!isMapped())
+        << "VectorFile::appendFile - can not append to a mapped file.";
+  }
   switch (fileFormat) {
   case 4: // Little-endian.  //TODO supporting just 1 format, remove this switch and fileFormat
     appendFloat64File(fileName, expectedElementCount);
     handled = true;
     break;
+  case 7:
+    appendMappedFile(fileName, expectedElementCount);
+    handled = true;
+    break;
   }
 
   if (!handled) {
@@ -101,13 +115,16 @@ void VectorFile::appendFile(const string &fileName,
     }
   }
 
-  NTA_CHECK(fileVectors_.size() > 0)
+  NTA_CHECK(vectorCount() > 0)
       << "VectorFile::appendFile - no vectors were read in.";
 
+  // A mapped file knows its own vector length, use it if none was expected.
+  const Size elementCount = (isMapped() && expectedElementCount == 0)
+                                ? mappedElements_ : expectedElementCount;
   // Reset scaling only if the vector lengths changed
-  if (scaleVector_.size() != expectedElementCount) {
+  if (scaleVector_.size() != elementCount) {
     NTA_INFO << "appendFile - need to reset scale and offset vectors.";
-    resetScaling((UInt)expectedElementCount);
+    resetScaling((UInt)elementCount);
   }
 }
 
@@ -206,7 +223,7 @@ void VectorFile::saveVectors(ostream &out, Size nColumns, UInt32 fileFormat,
                              Int64 begin, Int64 end, const char *lineEndings) const {
   out.exceptions(ios_base::failbit | ios_base::badbit);
 
-  Size n = fileVectors_.size();
+  Size n = vectorCount();
   while (begin < 0) begin += n;
   while (end < 0)  end += n;
   NTA_CHECK(begin <= Int64(n)) << "Begin (" << begin << ") out of bounds.";
@@ -214,9 +231,9 @@ void VectorFile::saveVectors(ostream &out, Size nColumns, UInt32 fileFormat,
   if (end < begin)
     end = begin;
 
-  // Setup iterators for the rows.
-  vector<Real64 *>::const_iterator i = (fileVectors_.begin() + size_t(begin));
-  auto iend = i + size_t(end - begin);
+  // The range of rows.
+  size_t i = size_t(begin);
+  const size_t iend = size_t(end);
 
   switch (fileFormat) {
   case 0:
@@ -294,7 +311,7 @@ void VectorFile::saveVectors(ostream &out, Size nColumns, UInt32 fileFormat,
         if (nColumns)
           out << sep;
       }
-      const Real64 *p = *i;
+      const Real64 *p = vector_(i);
       if (nColumns) {
         const Real64 *pEnd = p + nColumns;
         out << *(p++);
@@ -332,10 +349,19 @@ void VectorFile::saveVectors(ostream &out, Size nColumns, UInt32 fileFormat,
       delete[] buffer;*/
     } else {
       for (; i != iend; ++i)
-        out.write((char *)(*i), streamsize(rowBytes));
+        out.write((const char *)vector_(i), streamsize(rowBytes));
     }
     break;
   }
+  case 7: {
+    MappedHeader header;
+    header.elements = nColumns;
+    header.rows = iend - i;
+    out.write((const char *)&header, sizeof header);
+    for (; i != iend; ++i)
+      out.write((const char *)vector_(i), streamsize(nColumns * sizeof(Real64)));
+    break;
+  }
   default: {
     NTA_THROW << "File format '" << fileFormat << "' not supported for writing.";
   }
@@ -380,7 +406,7 @@ void VectorFile::appendFloat64File(const string &filename,
   Size offset = fileVectors_.size();
   NTA_CHECK (offset == own_.size()) << "Invalid ownership flags.";
   Size nRowLabels = vectorLabels_.size();
-  NTA_CHECK (nRowLabels && (nRowLabels == offset)) << "Invalid number of row labels.";
+  NTA_CHECK (!nRowLabels || (nRowLabels == offset)) << "Invalid number of row labels.";
 
   Real64 *block = nullptr; //TODO use Real[] block; instead of pointers! will require more changes in the file
 
@@ -402,7 +428,7 @@ void VectorFile::appendFloat64File(const string &filename,
       *(cur++) = pBlock;
     }
 
-    file.read(&block, sizeof block[0] ,int(totalBytes));
+    file.read(block, sizeof block[0], int(nRows * expectedElements));
 
   } catch (...) {
     delete[] block;
@@ -414,6 +440,33 @@ void VectorFile::appendFloat64File(const string &filename,
   }
 }
 
+void VectorFile::appendMappedFile(const string &filename, Size expectedElements) {
+  NTA_CHECK(vectorCount() == 0)
+      << "VectorFile - a mapped file can not be appended to other vectors.";
+
+  auto file = std::make_unique<MappedFile>(filename);
+  MappedHeader header, expected;
+  NTA_CHECK(file->size() >= sizeof header)
+      << "VectorFile - '" << filename << "' is too small for a vector file.";
+  ::memcpy(&header, file->data(), sizeof header);
+  NTA_CHECK(::memcmp(header.magic, expected.magic, sizeof header.magic) == 0 &&
+            header.version == expected.version)
+      << "VectorFile - '" << filename << "' is not a binary vector file (format 7).";
+  NTA_CHECK(header.byteOrder == expected.byteOrder)
+      << "VectorFile - '" << filename << "' was written on a machine with another byte order.";
+  NTA_CHECK(expectedElements == 0 || header.elements == expectedElements)
+      << "VectorFile::appendFile - number of elements in file (" << header.elements
+      << ") does not match output element count (" << expectedElements << ")";
+  NTA_CHECK(header.matchesFileSize(file->size()))
+      << "VectorFile - '" << filename << "' is truncated, expected " << header.rows
+      << " vectors of " << header.elements << " elements.";
+
+  mappedRows_ = reinterpret_cast<const Real64 *>(file->data() + sizeof header);
+  mappedCount_ = static_cast<size_t>(header.rows);
+  mappedElements_ = static_cast<size_t>(header.elements);
+  mapped_ = std::move(file);
+}
+
 // Append a CSV file to the list of stored vectors. There are some strict
 // assumptions here. We assume that each row has at least expectedElements
 // numbers separated by commas. It is ok to have more, we keep the first
@@ -681,7 +734,7 @@ void VectorFile::getRawVector(const UInt v, Real64 *out, UInt offset,
               << " = " << offset + count
               << ", must be smaller than element count: " << getElementCount();
   // Get the pointers and copy over the vector
-  Real64 *vec = fileVectors_[v];
+  const Real64 *vec = vector_(v);
   for (Size i = 0; i < count; i++)
     out[i] = vec[offset + i];
 }
@@ -700,7 +753,7 @@ void VectorFile::getScaledVector(const UInt v, Real64 *out, UInt offset,
   NTA_CHECK(getElementCount() <= offset + count);
 
   // Get the pointers and copy over the vector
-  Real64 *vec = fileVectors_[v];
+  const Real64 *vec = vector_(v);
   for (Size i = 0; i < count; i++) {
     out[i] = scaleVector_[i] * (vec[i + offset] + offsetVector_[i]);
   }
@@ -742,13 +795,13 @@ void VectorFile::setStandardScaling() {
 
     // First compute the mean and offset
     for (Size i = 0; i < nv; i++)
-      sum += fileVectors_[i][e];
+      sum += vector_(i)[e];
     double mean = sum / nv;
     offsetVector_[e] = (Real64)(-mean);
 
     // Now compute the squared term for stdev
     for (Size i = 0; i < nv; i++) {
-      double s = (fileVectors_[i][e] - mean);
+      double s = (vector_(i)[e] - mean);
       sum2 += s * s;
     }
 
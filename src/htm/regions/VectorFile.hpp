@@ -27,7 +27,9 @@
 //----------------------------------------------------------------------
 
 #include <fstream>
+#include <memory>
 #include <sstream>
+#include <htm/os/MappedFile.hpp>
 #include <htm/types/Types.hpp>
 #include <htm/types/Serializable.hpp>
 #include <vector>
@@ -38,13 +40,52 @@ namespace htm {
  * only purpose is to support the needs of the FileInputRegion. Key features of
  *  interest are its ability to read in different text file formats and its
  *  ability to dynamically scale its outputs.
+ *
+ *  Format 7 is a binary file which is memory mapped rather than read in:
+ *  a 32 byte header followed by the vectors as rows of Real64 in the byte
+ *  order of the machine. The header is
+ *  \verbatim
+        char[8]  magic "HTMVECT\0"
+        UInt32   version, 1
+        UInt32   byte order mark, 0x01020304
+        UInt64   number of elements of each vector
+        UInt64   number of vectors
+    \endverbatim
+ *  Opening such a file is instant and the memory used is bounded by the OS,
+ *  regardless of the size of the file. Convert other formats to it with
+ *  saveVectors(), or the saveFile command of FileInputRegion.
+ *  A mapped file can not be combined with other files.
  */
 class VectorFile : public Serializable {
 public:
   VectorFile();
   virtual ~VectorFile();
 
-  static Int32 maxFormat() { return 6; }
+  static Int32 maxFormat() { return 7; }
+
+  /// Header of a binary vector file, format 7. See above.
+  struct MappedHeader {
+    char magic[8] = {'H', 'T', 'M', 'V', 'E', 'C', 'T', '\0'};
+    UInt32 version = 1;
+    UInt32 byteOrder = 0x01020304;
+    UInt64 elements = 0;
+    UInt64 rows = 0;
+
+    /// True if a file of fileSize bytes holds exactly this header and
+    /// rows * elements values. Divides rather than multiplies, so that a
+    /// corrupt header can not overflow the check.
+    bool matchesFileSize(UInt64 fileSize) const {
+      if (fileSize < sizeof(MappedHeader))
+        return false;
+      const UInt64 bytes = fileSize - sizeof(MappedHeader);
+      if (rows == 0)
+        return bytes == 0;
+      if (elements == 0 || bytes % sizeof(Real64) != 0)
+        return false;
+      const UInt64 values = bytes / sizeof(Real64);
+      return values % elements == 0 && values / elements == rows;
+    }
+  };
 
   /// Read in vectors from the given filename. All vectors are expected to
   /// have the same size (i.e. same number of elements).
@@ -60,6 +101,7 @@ public:
   ///           4        # Reads in a little-endian float32 binary file
   ///           5        # Reads in a big-endian float32 binary file
   ///           6        # Reads in a big-endian IDX binary file
+  ///           7        # Maps a binary file with a header, see above
   void appendFile(const std::string &fileName, Size expectedElementCount,
                   UInt32 fileFormat);
 
@@ -72,7 +114,10 @@ public:
   void getRawVector(const UInt i, Real64 *out, UInt offset, Size count);
 
   /// Return the number of stored vectors
-  size_t vectorCount() const { return fileVectors_.size(); }
+  size_t vectorCount() const { return fileVectors_.size() + mappedCount_; }
+
+  /// Return true iff the vectors are in a memory mapped file (format 7)
+  bool isMapped() const { return mapped_ != nullptr; }
 
   /// Return the size of each vector (number of elements per vector)
   size_t getElementCount() const;
@@ -121,11 +166,18 @@ public:
   template<class Archive>
 	void save_ar(Archive& ar) const { 
 	  UInt32 format = (isLabeled())?1:2;     // format (1 if labled, 2 if not)
-		size_t nRows = fileVectors_.size();
+		size_t nRows = vectorCount();
 		Size nCols = scaleVector_.size();
-		std::stringstream ss;
-	  saveVectors(ss, nCols, format, 0, fileVectors_.size(), nullptr);
-		std::string data = ss.str();
+		std::string data;
+		if (isMapped()) {
+		  // Refer to the mapped file rather than copying it.
+		  format = 7;
+		  data = mapped_->path();
+		} else {
+		  std::stringstream ss;
+	    saveVectors(ss, nCols, format, 0, fileVectors_.size(), nullptr);
+		  data = ss.str();
+		}
     ar(cereal::make_nvp("format", format),
 		   cereal::make_nvp("nRows", nRows),
 			 cereal::make_nvp("nCols", nCols),
@@ -140,6 +192,10 @@ public:
 		size_t nCols;
 		std::string data;
     ar( format, nRows,  nCols, scaleVector_, offsetVector_, data);
+		if (format == 7) {
+		  appendMappedFile(data, 0);
+		  return;
+		}
 		std::stringstream ss(data);
 	  loadVectors(ss, nRows, nCols, format);
 	}
@@ -148,6 +204,12 @@ public:
 private:
   std::vector<Real64 *> fileVectors_; // list of vectors
   std::vector<bool> own_;           // memory ownership flags
+
+  // The vectors of a mapped file, instead of fileVectors_
+  std::unique_ptr<MappedFile> mapped_;
+  const Real64 *mappedRows_ = nullptr;
+  size_t mappedCount_ = 0;
+  size_t mappedElements_ = 0;
   std::vector<Real64> scaleVector_;   // the scaling vector
   std::vector<Real64> offsetVector_;  // the offset vector
 
@@ -162,6 +224,15 @@ private:
 
   /// Read vectors from a binary IDX file.
   void appendIDXFile(const std::string &filename, int expectedElements);
+
+  /// Map the vectors of a binary file with a header (format 7).
+  /// expectedElements == 0 accepts any number of elements.
+  void appendMappedFile(const std::string &filename, Size expectedElements);
+
+  /// The i'th vector
+  const Real64 *vector_(size_t i) const {
+    return mapped_ ? mappedRows_ + i * mappedElements_ : fileVectors_[i];
+  }
   void loadVectors(std::istream &f, size_t nRows, size_t nCols, int format);
 }; // end class VectorFile
 
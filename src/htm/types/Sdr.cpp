@@ -25,18 +25,55 @@
 
 #include <numeric>
 #include <algorithm> // std::sort, std::accumulate
+#include <functional> // std::greater
+#include <iterator>
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward64
+#endif
 
 using namespace std;
 
 namespace htm {
 
+    namespace {
+        // Defined with intersectSorted(), further down.
+        inline UInt countTrailingZeros(UInt64 word);
+
+        inline UInt countBits(UInt64 word) {
+        #if defined(_MSC_VER)
+            return static_cast<UInt>(__popcnt64(word));
+        #else
+            return static_cast<UInt>(__builtin_popcountll(word));
+        #endif
+        }
+
+        inline size_t bitsetWords(UInt size)
+            { return (size + 63u) / 64u; }
+
+        // Appends the indices of the set bits, in order.
+        void bitsetToSparse(const SDR_bitset_t &bitset, SDR_sparse_t &sparse) {
+            for( size_t w = 0u; w < bitset.size(); ++w ) {
+                for( UInt64 bits = bitset[w]; bits != 0u; bits &= bits - 1u )
+                    sparse.push_back( static_cast<ElemSparse>( w * 64u + countTrailingZeros( bits ) ) );
+            }
+        }
+
+    } // namespace
+
     void SparseDistributedRepresentation::clear() const {
         dense_valid       = false;
         sparse_valid      = false;
         coordinates_valid = false;
+        bitset_valid      = false;
     }
 
     void SparseDistributedRepresentation::do_callbacks() const {
+        if( numCallbacks_ == 0u )
+            return;
+        if( callbacksSuspended_ > 0u ) {
+            callbacksPending_ = true;
+            return;
+        }
         for(const auto &func_ptr : callbacks) {
             if( func_ptr != nullptr )
                 func_ptr();
@@ -97,6 +134,17 @@ namespace htm {
         do_callbacks();
     }
 
+    void SparseDistributedRepresentation::setBitsetInplace() const {
+        // Check data is valid.
+        NTA_ASSERT( bitset_.size() == bitsetWords( size ) );
+        NTA_ASSERT( size % 64u == 0u || bitset_.empty() || (bitset_.back() >> (size % 64u)) == 0u )
+            << "Bitset has bits set past the end of the SDR!";
+        // Set the valid flags.
+        clear();
+        bitset_valid = true;
+        do_callbacks();
+    }
+
     void SparseDistributedRepresentation::deconstruct() {
         clear();
         size_ = 0;
@@ -107,6 +155,9 @@ namespace htm {
         }
         callbacks.clear();
         destroyCallbacks.clear();
+        numCallbacks_       = 0u;
+        callbacksSuspended_ = 0u;
+        callbacksPending_   = false;
     }
 
     // Constructors
@@ -134,6 +185,8 @@ namespace htm {
         // Initialize the index tuple.
         coordinates_.assign( dimensions.size(), {} );
         coordinates_valid = true;
+        // The bitset is allocated when it's needed.
+        bitset_valid = false;
     }
 
     SparseDistributedRepresentation::SparseDistributedRepresentation(
@@ -148,7 +201,7 @@ namespace htm {
     void SparseDistributedRepresentation::reshape(const vector<UInt> &dimensions) const {
         // Make sure we have the data in a format which does not care about the
         // dimensions, IE: dense or sparse but not coordinates
-        if( not dense_valid and not sparse_valid )
+        if( not dense_valid and not sparse_valid and not bitset_valid )
             getSparse();
         coordinates_valid = false;
         coordinates_.assign( dimensions.size(), {} );
@@ -219,6 +272,10 @@ namespace htm {
                     sparse_.push_back(flat);
                 }
             }
+            else if( bitset_valid ) {
+                // Convert from bitset to flatSparse.
+                bitsetToSparse( bitset_, sparse_ );
+            }
             else if( dense_valid ) {
                 // Convert from dense to flatSparse.
                 const auto &dense = getDense();
@@ -260,6 +317,35 @@ namespace htm {
     }
 
 
+    void SparseDistributedRepresentation::setBitset( SDR_bitset_t &value ) {
+        bitset_.swap( value );
+        setBitsetInplace();
+    }
+
+    void SparseDistributedRepresentation::setBitset( const SDR_bitset_t &value ) {
+        bitset_.assign( value.begin(), value.end() );
+        setBitsetInplace();
+    }
+
+    SDR_bitset_t& SparseDistributedRepresentation::getBitset() const {
+        if( !bitset_valid ) {
+            bitset_.assign( bitsetWords( size ), 0u );
+            if( dense_valid and not sparse_valid ) {
+                // Convert from dense to bitset.
+                for(UInt idx = 0; idx < size; idx++)
+                    bitset_[idx >> 6u] |= (UInt64)(dense_[idx] != 0) << (idx & 63u);
+            }
+            else {
+                // Convert from flatSparse to bitset.
+                for(const auto idx : getSparse())
+                    bitset_[idx >> 6u] |= (UInt64)1u << (idx & 63u);
+            }
+            bitset_valid = true;
+        }
+        return bitset_;
+    }
+
+
     void SparseDistributedRepresentation::setSDR( const SparseDistributedRepresentation &value ) {
         reshape( value.dimensions );
         // Cast the data to CONST, which forces the SDR to copy the vector
@@ -283,8 +369,13 @@ namespace htm {
         NTA_ASSERT( dimensions == sdr.dimensions );
 
         UInt ovlp = 0u;
-        const auto a_sparse = this->getSparse();
-        const auto b_sparse = sdr.getSparse();
+        if( bitset_valid and sdr.bitset_valid ) {
+            for( size_t w = 0u; w < bitset_.size(); ++w )
+                ovlp += countBits( bitset_[w] & sdr.bitset_[w] );
+            return ovlp;
+        }
+        const auto &a_sparse = this->getSparse();
+        const auto &b_sparse = sdr.getSparse();
         long unsigned int a_idx = 0u;
         long unsigned int b_idx = 0u;
         while( a_idx < a_sparse.size() && b_idx < b_sparse.size() ) {
@@ -335,21 +426,26 @@ namespace htm {
         const UInt num_move_bits = (UInt) std::round( fractionNoise * getSum() );
         const auto& turn_off = rng.sample(getSparse(), num_move_bits);
 
-        auto& dns = getDense();
+        auto& bits = getBitset();
 
+        // Find the inactive bits a word at a time.
         vector<UInt> off_pop;
-        for(UInt idx = 0; idx < size; idx++) {
-            if( dns[idx] == 0 )
-                off_pop.push_back( idx );
+        off_pop.reserve( size - getSum() );
+        for( size_t w = 0u; w < bits.size(); ++w ) {
+            UInt64 zeros = ~bits[w];
+            if( w + 1u == bits.size() && size % 64u != 0u )
+                zeros &= ((UInt64)1u << (size % 64u)) - 1u;
+            for( ; zeros != 0u; zeros &= zeros - 1u )
+                off_pop.push_back( static_cast<UInt>( w * 64u + countTrailingZeros( zeros ) ) );
         }
         const vector<UInt> turn_on = rng.sample(off_pop, num_move_bits);
 
         for( auto idx : turn_on )
-            dns[ idx ] = 1;
+            bits[ idx >> 6u ] |= (UInt64)1u << (idx & 63u);
         for( auto idx : turn_off )
-            dns[ idx ] = 0;
+            bits[ idx >> 6u ] &= ~((UInt64)1u << (idx & 63u));
 
-        setDenseInplace();
+        setBitsetInplace();
     }
 
 
@@ -375,36 +471,113 @@ namespace htm {
         intersection( { &input1, &input2 } );
     }
 
-    void SparseDistributedRepresentation::intersection(vector<const SDR*> inputs) {
-        NTA_CHECK( inputs.size() >= 2u );
-        bool inplace = false;
-        for( size_t i = 0; i < inputs.size(); i++ ) {
-            NTA_CHECK( inputs[i] != nullptr );
-            NTA_CHECK( inputs[i]->dimensions == dimensions );
-            // Check for modifying this SDR inplace.
-            if( inputs[i] == this ) {
-                inplace = true;
-                inputs[i--] = inputs.back();
-                inputs.pop_back();
+    namespace {
+        inline UInt countTrailingZeros(UInt64 word) {
+        #if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanForward64(&idx, word);
+            return static_cast<UInt>(idx);
+        #else
+            return static_cast<UInt>(__builtin_ctzll(word));
+        #endif
+        }
+
+        // Removes the candidates which are not in the sorted set.  When the set
+        // is much larger than the candidates it is searched with exponentially
+        // growing steps (galloping) instead of being walked one by one.
+        void intersectSorted(SDR_sparse_t &candidates, const SDR_sparse_t &set) {
+            const bool gallop = set.size() > 16u * candidates.size();
+            auto out = candidates.begin();
+            auto lo  = set.cbegin();
+            for( const auto c : candidates ) {
+                if( gallop ) {
+                    auto hi = lo;
+                    for( size_t step = 1u; hi != set.cend() && *hi < c; step *= 2u ) {
+                        lo = hi;
+                        hi = (size_t)(set.cend() - hi) > step ? hi + step : set.cend();
+                    }
+                    lo = std::lower_bound( lo, hi, c );
+                }
+                else {
+                    while( lo != set.cend() && *lo < c )
+                        ++lo;
+                }
+                if( lo == set.cend() )
+                    break;
+                if( *lo == c )
+                    *out++ = c;
             }
+            candidates.erase( out, candidates.end() );
         }
-        if( inplace ) {
-            getDense(); // Make sure that the dense data is valid.
+    } // namespace
+
+    void SparseDistributedRepresentation::checkSetInputs_(const vector<const SDR*> &inputs) const {
+        NTA_CHECK( inputs.size() >= 2u );
+        for( const auto *sdr_ptr : inputs ) {
+            NTA_CHECK( sdr_ptr != nullptr );
+            NTA_CHECK( sdr_ptr->dimensions == dimensions );
         }
-        if( not inplace ) {
-            // Copy one of the SDRs over to the output SDR.
-            const auto &denseIn = inputs.back()->getDense();
-            dense_.assign( denseIn.begin(), denseIn.end() );
-            inputs.pop_back();
-            // inplace = true; // Now it's an inplace operation.
+    }
+
+    void SparseDistributedRepresentation::setSparseAndBitsetInplace_() {
+        // Both formats hold the result, mark them valid before notifying so
+        // that a callback which modifies this SDR is not overridden.
+        NTA_ASSERT( bitset_.size() == bitsetWords( size ) );
+        clear();
+        sparse_valid = true;
+        bitset_valid = true;
+        do_callbacks();
+    }
+
+    void SparseDistributedRepresentation::intersection(vector<const SDR*> inputs) {
+        checkSetInputs_( inputs );
+        if( std::all_of( inputs.begin(), inputs.end(),
+                         [](const SDR *sdr_ptr) { return sdr_ptr->bitset_valid; }) ) {
+            // AND the bitsets a word at a time.
+            SDR_bitset_t bitmap( inputs.front()->bitset_ );
+            for( size_t i = 1u; i < inputs.size(); i++ ) {
+                const auto &data = inputs[i]->bitset_;
+                for( size_t w = 0u; w < bitmap.size(); ++w )
+                    bitmap[w] &= data[w];
+            }
+            SDR_sparse_t result;
+            bitsetToSparse( bitmap, result );
+            sparse_.swap( result );
+            bitset_.swap( bitmap );
+            setSparseAndBitsetInplace_();
+            return;
         }
-        for(const auto &sdr_ptr : inputs) {
-            const auto &data = sdr_ptr->getDense();
-            for(auto z = 0u; z < data.size(); ++z) {
-                dense_[z] = dense_[z] && data[z];
+        // Start from the input with the fewest active bits, each of the other
+        // inputs can only remove bits from it.  Inputs which only have dense
+        // data are not converted to sparse, instead the remaining candidates
+        // are looked up in their dense data.
+        auto cheapest = [](const SDR *a, const SDR *b) {
+            if( a->sparse_valid != b->sparse_valid )
+                return a->sparse_valid;
+            return a->sparse_valid && a->sparse_.size() < b->sparse_.size();
+        };
+        std::sort( inputs.begin(), inputs.end(), cheapest );
+        SDR_sparse_t result( inputs.front()->getSparse() );
+        for( size_t i = 1u; i < inputs.size() && not result.empty(); i++ ) {
+            const auto *sdr_ptr = inputs[i];
+            if( not sdr_ptr->sparse_valid && sdr_ptr->bitset_valid ) {
+                const auto &data = sdr_ptr->bitset_;
+                result.erase( std::remove_if( result.begin(), result.end(),
+                                [&data](const ElemSparse idx) { return ((data[idx >> 6u] >> (idx & 63u)) & 1u) == 0u; }),
+                              result.end() );
+            }
+            else if( not sdr_ptr->sparse_valid && sdr_ptr->dense_valid ) {
+                const auto &data = sdr_ptr->dense_;
+                result.erase( std::remove_if( result.begin(), result.end(),
+                                [&data](const ElemSparse idx) { return data[idx] == 0; }),
+                              result.end() );
+            }
+            else {
+                intersectSorted( result, sdr_ptr->getSparse() );
             }
         }
-        SDR::setDenseInplace();
+        sparse_.swap( result );
+        SDR::setSparseInplace();
     }
 
 
@@ -414,35 +587,78 @@ namespace htm {
     }
 
     void SparseDistributedRepresentation::set_union(vector<const SDR*> inputs) {
-        NTA_CHECK( inputs.size() >= 2u );
-        bool inplace = false;
-        for( size_t i = 0; i < inputs.size(); i++ ) {
-            NTA_CHECK( inputs[i] != nullptr );
-            NTA_CHECK( inputs[i]->dimensions == dimensions );
-            // Check for modifying this SDR inplace.
-            if( inputs[i] == this ) {
-                inplace = true;
-                inputs[i--] = inputs.back();
-                inputs.pop_back();
-            }
+        checkSetInputs_( inputs );
+        // Estimate the work of reading the inputs.  Inputs which only have
+        // dense or bitset data are not converted, so they force the bitmap.
+        size_t work = 0u;
+        for( const auto *sdr_ptr : inputs ) {
+            const bool packed_only = not sdr_ptr->sparse_valid && (sdr_ptr->dense_valid || sdr_ptr->bitset_valid);
+            work += packed_only ? size : sdr_ptr->getSparse().size();
         }
-        if( inplace ) {
-            getDense(); // Make sure that the dense data is valid.
+        SDR_sparse_t result;
+        if( inputs.size() == 2u && work < size / 16u ) {
+            // Merge the two sorted lists.
+            const auto &a = inputs[0]->getSparse();
+            const auto &b = inputs[1]->getSparse();
+            result.reserve( a.size() + b.size() );
+            std::set_union( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result) );
         }
-        if( not inplace ) {
-            // Copy one of the SDRs over to the output SDR.
-            const auto &denseIn = inputs.back()->getDense();
-            dense_.assign( denseIn.begin(), denseIn.end() );
-            inputs.pop_back();
-            // inplace = true; // Now it's an inplace operation.
+        else if( work < size / 16u ) {
+            // All inputs have sparse data, else the work would exceed size.
+            // Few bits from many inputs: k-way merge with a heap holding the
+            // next index of each input.
+            using Head = std::pair<ElemSparse, size_t>;
+            std::vector<Head> heap;
+            std::vector<size_t> pos( inputs.size(), 0u );
+            for( size_t i = 0u; i < inputs.size(); i++ ) {
+                if( not inputs[i]->sparse_.empty() )
+                    heap.emplace_back( inputs[i]->sparse_[0], i );
+            }
+            std::make_heap( heap.begin(), heap.end(), std::greater<Head>() );
+            result.reserve( work );
+            while( not heap.empty() ) {
+                std::pop_heap( heap.begin(), heap.end(), std::greater<Head>() );
+                const Head head = heap.back();
+                heap.pop_back();
+                if( result.empty() || result.back() != head.first )
+                    result.push_back( head.first );
+                const auto &data = inputs[head.second]->sparse_;
+                if( ++pos[head.second] < data.size() ) {
+                    heap.emplace_back( data[pos[head.second]], head.second );
+                    std::push_heap( heap.begin(), heap.end(), std::greater<Head>() );
+                }
+            }
         }
-        for(const auto &sdr_ptr : inputs) {
-            const auto &data = sdr_ptr->getDense();
-            for(auto z = 0u; z < data.size(); ++z) {
-                dense_[z] = dense_[z] || data[z];
+        else {
+            // Many bits: set them in a bitmap, 64 bits per word, and then read
+            // the active bits back out of it in order.
+            SDR_bitset_t bitmap( bitsetWords( size ), 0u );
+            for( const auto *sdr_ptr : inputs ) {
+                if( sdr_ptr->bitset_valid ) {
+                    const auto &data = sdr_ptr->bitset_;
+                    for( size_t w = 0u; w < bitmap.size(); ++w )
+                        bitmap[w] |= data[w];
+                }
+                else if( not sdr_ptr->sparse_valid && sdr_ptr->dense_valid ) {
+                    const auto &data = sdr_ptr->dense_;
+                    for( UInt z = 0u; z < size; ++z )
+                        bitmap[z >> 6u] |= (UInt64)(data[z] != 0) << (z & 63u);
+                }
+                else {
+                    for( const auto idx : sdr_ptr->getSparse() )
+                        bitmap[idx >> 6u] |= (UInt64)1u << (idx & 63u);
+                }
             }
+            result.reserve( std::min<size_t>( work, size ) );
+            bitsetToSparse( bitmap, result );
+            // Keep the bitmap as this SDRs bitset.
+            sparse_.swap( result );
+            bitset_.swap( bitmap );
+            setSparseAndBitsetInplace_();
+            return;
         }
-        SDR::setDenseInplace();
+        sparse_.swap( result );
+        SDR::setSparseInplace();
     }
 
 
@@ -510,14 +726,16 @@ namespace htm {
                 return false;
         }
         // Check data
-        return std::equal(
-            getDense().begin(),
-            getDense().end(), 
-            sdr.getDense().begin());
+        if( bitset_valid and sdr.bitset_valid )
+            return bitset_ == sdr.bitset_;
+        return getSparse() == sdr.getSparse();
     }
 
 
     UInt SparseDistributedRepresentation::addCallback(SDR_callback_t callback) const {
+        NTA_CHECK( callback != nullptr )
+            << "SparseDistributedRepresentation::addCallback, NULL callback!";
+        numCallbacks_++;
         UInt index = 0;
         for( ; index < callbacks.size(); index++ ) {
             if( callbacks[index] == nullptr ) {
@@ -535,6 +753,22 @@ namespace htm {
         NTA_CHECK( callbacks[index] != nullptr )
             << "SparseDistributedRepresentation::removeCallback, Callback already removed!";
         callbacks[index] = nullptr;
+        numCallbacks_--;
+    }
+
+
+    void SparseDistributedRepresentation::suspendCallbacks() const {
+        callbacksSuspended_++;
+    }
+
+    void SparseDistributedRepresentation::resumeCallbacks() const {
+        NTA_CHECK( callbacksSuspended_ > 0u )
+            << "SparseDistributedRepresentation::resumeCallbacks, Callbacks are not suspended!";
+        callbacksSuspended_--;
+        if( callbacksSuspended_ == 0u and callbacksPending_ ) {
+            callbacksPending_ = false;
+            do_callbacks();
+        }
     }
 
 
@@ -39,6 +39,7 @@ using ElemSparse       = UInt32; //must match with connections::CellIdx
 using SDR_dense_t      = std::vector<ElemDense>;
 using SDR_sparse_t     = std::vector<ElemSparse>;
 using SDR_coordinate_t = std::vector<std::vector<UInt>>;
+using SDR_bitset_t     = std::vector<UInt64>;
 using SDR_callback_t   = std::function<void()>;
 
 /**
@@ -71,6 +72,11 @@ using SDR_callback_t   = std::function<void()>;
  *    useful because it contains the location of each true bit inside of the
  *    SDR's dimensional space.
  *
+ *    Bitset Format: The dense format packed into 64 bit words, bit 'i' of the
+ *    SDR is bit (i % 64) of word (i / 64).  The unused bits of the last word
+ *    are zero.  This format uses 8 times less memory than the dense format
+ *    and allows computing overlaps, unions & intersections a word at a time.
+ *
  * Array Memory Layout: This class uses C-order throughout, meaning that when
  * iterating through the SDR, the last/right-most index changes fastest.
  *
@@ -136,6 +142,7 @@ protected:
     mutable SDR_dense_t      dense_;
     mutable SDR_sparse_t     sparse_;
     mutable SDR_coordinate_t coordinates_;
+    mutable SDR_bitset_t     bitset_;
 
     /**
      * These flags remember which data formats are up-to-date and which formats
@@ -144,6 +151,7 @@ protected:
     mutable bool dense_valid;
     mutable bool sparse_valid;
     mutable bool coordinates_valid;
+    mutable bool bitset_valid;
 
 private:
     /**
@@ -159,6 +167,31 @@ private:
      */
     mutable std::vector<SDR_callback_t> destroyCallbacks;
 
+    /**
+     * Number of non-NULL entries in callbacks, so that SDRs without any
+     * watchers can skip the notification entirely.
+     */
+    mutable UInt numCallbacks_ = 0u;
+
+    /**
+     * While callbacksSuspended_ is non-zero, notifications are not sent and
+     * callbacksPending_ records that a value was assigned.  See method
+     * suspendCallbacks for API details.
+     */
+    mutable UInt callbacksSuspended_ = 0u;
+    mutable bool callbacksPending_   = false;
+
+    /**
+     * Checks the inputs to intersection & set_union.
+     */
+    void checkSetInputs_(const std::vector<const SparseDistributedRepresentation*> &inputs) const;
+
+    /**
+     * Marks the sparse indices and the bitset valid, then notifies the
+     * callbacks.  Both must hold the same value.
+     */
+    void setSparseAndBitsetInplace_();
+
 protected:
     /**
      * Remove the value from this SDR by clearing all of the valid flags.  Does
@@ -172,13 +205,6 @@ protected:
      */
     void do_callbacks() const;
 
-    /**
-     * Update the SDR to reflect the value currently inside of the dense array.
-     * Use this method after modifying the dense buffer inplace, in order to
-     * propagate any changes to the sparse & coordinate formats.
-     */
-    virtual void setDenseInplace() const;
-
     /**
      * Update the SDR to reflect the value currently inside of the flatSparse
      * vector. Use this method after modifying the flatSparse vector inplace, in
@@ -193,6 +219,13 @@ protected:
      */
     virtual void setCoordinatesInplace() const;
 
+    /**
+     * Update the SDR to reflect the value currently inside of the bitset
+     * vector. Use this method after modifying the bitset vector inplace, in
+     * order to propagate any changes to the other formats.
+     */
+    virtual void setBitsetInplace() const;
+
     /**
      * Destroy this SDR.  Makes SDR unusable, should error or clearly fail if
      * used.  Also sends notification to all watchers via destroyCallbacks.
@@ -284,6 +317,14 @@ public:
        setDenseInplace();
      }
 
+    /**
+     * Update the SDR to reflect the value currently inside of the dense array.
+     * Use this method after modifying the dense buffer inplace (eg. through
+     * getDense()), in order to propagate any changes to the sparse & coordinate
+     * formats.  This copies no data.
+     */
+    virtual void setDenseInplace() const;
+
     /**
      * Gets the current value of the SDR.  The result of this method call is
      * cached inside of this SDR until the SDRs value changes.  After modifying
@@ -406,6 +447,36 @@ public:
      */
     virtual SDR_coordinate_t& getCoordinates() const;
 
+    /**
+     * Swap a new value into the SDR, replacing the current value.  This
+     * method is fast since it copies no data.  This method modifies its
+     * argument!
+     *
+     * @param value A bitset of (size + 63) / 64 words to swap into the SDR.
+     * The bits past the end of the SDR must be zero.
+     */
+    void setBitset( SDR_bitset_t &value );
+
+    /**
+     * Copy a new value into the SDR, overwritting the current value.
+     *
+     * @param value A bitset of (size + 63) / 64 words to copy into the SDR.
+     */
+    void setBitset( const SDR_bitset_t &value );
+
+    /**
+     * Gets the current value of the SDR, packed 64 bits per word.  The result
+     * of this method call is cached inside of this SDR until the SDRs value
+     * changes.  After modifying the bitset you MUST call sdr.setBitset() in
+     * order to notify the SDR that its bitset has changed.
+     *
+     * An SDR which is only assigned and read as a bitset never allocates its
+     * dense array.
+     *
+     * @returns A reference to the bitset of the SDR.
+     */
+    virtual SDR_bitset_t& getBitset() const;
+
     /**
      * Deep Copy the given SDR to this SDR.  This overwrites the current value of
      * this SDR.  This SDR and the given SDR will have no shared data and they
@@ -443,6 +514,9 @@ public:
      *
      * @returns Integer, the number of true values which both SDRs have in
      * common.
+     *
+     * If both SDRs have a valid bitset this counts the bits of their
+     * conjunction a word at a time, otherwise it merges the sparse indices.
      */
     UInt getOverlap(const SparseDistributedRepresentation &sdr) const;
 
@@ -507,6 +581,10 @@ public:
      *     B.setSparse(      {2, 3, 4, 5});
      *     C.intersection(A, B);
      *     C.getSparse() -> {2, 3}
+     *
+     * The intersection is computed from the sparse data, starting with the
+     * input with the fewest active bits.  Inputs whose value is only
+     * available in dense format are not converted.
      */
     void intersection(const SparseDistributedRepresentation &input1,
                       const SparseDistributedRepresentation &input2);
@@ -532,6 +610,9 @@ public:
      *     B.setSparse(      {2, 3, 4, 5});
      *     C.set_union(A, B);
      *     C.getSparse() -> {0, 1, 2, 3, 4, 5}
+     *
+     * Inputs with few active bits in total are merged as sorted lists,
+     * otherwise the bits are collected in a bitmap of 64 bit words.
      */
     void set_union(const SparseDistributedRepresentation &input1,
                    const SparseDistributedRepresentation &input2);
@@ -638,6 +719,44 @@ public:
      */
     void removeCallback(UInt index) const;
 
+    /**
+     * Stop notifying the callbacks about changes to this SDR's value, until
+     * the matching call to resumeCallbacks.  Use this to apply several changes
+     * to an SDR while its watchers (such as metrics) only see the final value.
+     * Calls may be nested.
+     */
+    void suspendCallbacks() const;
+
+    /**
+     * Undo one call to suspendCallbacks.  When the last suspension is lifted
+     * and the SDR was assigned to in the mean time, the callbacks are notified
+     * once.  The values are not compared: as with an assignment outside of a
+     * suspension, the callbacks are notified even if the final value equals
+     * the value before the suspension.
+     */
+    void resumeCallbacks() const;
+
+    /**
+     * Suspends the callbacks of an SDR for the lifetime of this object.
+     *
+     * Example Usage:
+     *      {
+     *          SDR::SuspendCallbacks guard( A );
+     *          A.setSparse( ... );
+     *          A.addNoise( 0.1f );
+     *      } // Callbacks of A are notified once, here.
+     */
+    class SuspendCallbacks {
+    public:
+        explicit SuspendCallbacks(const SparseDistributedRepresentation &sdr)
+            : sdr_( sdr ) { sdr_.suspendCallbacks(); }
+        ~SuspendCallbacks() { sdr_.resumeCallbacks(); }
+        SuspendCallbacks(const SuspendCallbacks &) = delete;
+        SuspendCallbacks &operator=(const SuspendCallbacks &) = delete;
+    private:
+        const SparseDistributedRepresentation &sdr_;
+    };
+
     /**
      * This callback notifies you when this SDR is deconstructed and freed from
      * memory.
@@ -0,0 +1,203 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+/** @file
+ * Implementation of the SdrIndex class
+ */
+
+#include "htm/types/SdrIndex.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace htm {
+
+    void SdrIndex::initialize( const vector<UInt> &dimensions ) {
+        NTA_CHECK( dimensions.size() > 0 ) << "SdrIndex has no dimensions!";
+        dimensions_ = dimensions;
+        sdrSize_ = std::accumulate(dimensions.begin(), dimensions.end(), 1u, std::multiplies<UInt>());
+        NTA_CHECK( sdrSize_ > 0u ) << "SdrIndex: all dimensions must be > 0";
+        count_ = 0u;
+        alive_.clear();
+        entries_.clear();
+        postings_.assign( sdrSize_, {} );
+    }
+
+
+    UInt SdrIndex::add( const SDR &sdr ) {
+        NTA_CHECK( sdr.size == sdrSize_ )
+            << "SdrIndex::add - SDR size " << sdr.size << " does not match index size " << sdrSize_;
+        const UInt id = static_cast<UInt>( entries_.size() );
+        entries_.push_back( sdr.getSparse() );
+        alive_.push_back( 1u );
+        for( const auto bit : entries_.back() )
+            postings_[bit].push_back( id );
+        count_++;
+        return id;
+    }
+
+
+    void SdrIndex::remove( UInt id ) {
+        NTA_CHECK( contains( id ) ) << "SdrIndex::remove - unknown id " << id;
+        for( const auto bit : entries_[id] ) {
+            // The order of the ids in a posting list does not matter.
+            auto &list = postings_[bit];
+            auto it = std::find( list.begin(), list.end(), id );
+            NTA_ASSERT( it != list.end() );
+            *it = list.back();
+            list.pop_back();
+        }
+        SDR_sparse_t().swap( entries_[id] );
+        alive_[id] = 0u;
+        count_--;
+    }
+
+
+    const SDR_sparse_t &SdrIndex::getSparse( UInt id ) const {
+        NTA_CHECK( contains( id ) ) << "SdrIndex::getSparse - unknown id " << id;
+        return entries_[id];
+    }
+
+
+    SdrIndex::ScratchPool::Lease::Lease( ScratchPool &pool ) : pool_( pool ) {
+        {
+            std::lock_guard<std::mutex> lock( pool_.mutex_ );
+            if( not pool_.free_.empty() ) {
+                scratch_ = std::move( pool_.free_.back() );
+                pool_.free_.pop_back();
+            }
+        }
+        if( not scratch_ )
+            scratch_.reset( new QueryScratch() );
+    }
+
+
+    SdrIndex::ScratchPool::Lease::~Lease() {
+        try {
+            std::lock_guard<std::mutex> lock( pool_.mutex_ );
+            pool_.free_.push_back( std::move( scratch_ ) );
+        } catch( ... ) {
+            // Out of memory, the scratch space is simply freed.
+        }
+    }
+
+
+    void SdrIndex::query_( const SDR_sparse_t &sparse, UInt k, UInt minOverlap,
+                           QueryScratch &scratch, vector<Match> &matches ) const {
+        // counts is all zeros on entry and on return, only the touched
+        // entries are reset so the cost does not grow with the index size.
+        // It grows when SDRs were added since this scratch's last query.
+        auto &counts  = scratch.counts;
+        auto &touched = scratch.touched;
+        if( counts.size() < entries_.size() )
+            counts.resize( entries_.size(), 0u );
+        touched.clear();
+        // Reset on every exit, so that a throwing push_back can not leave
+        // counts dirty for the next query.
+        struct ResetCounts {
+            vector<UInt> &counts;
+            const vector<UInt> &touched;
+            ~ResetCounts() { for( const auto id : touched ) counts[id] = 0u; }
+        } reset{ counts, touched };
+        for( const auto bit : sparse ) {
+            for( const auto id : postings_[bit] ) {
+                if( counts[id] == 0u )
+                    touched.push_back( id );
+                counts[id]++;
+            }
+        }
+        matches.clear();
+        for( const auto id : touched ) {
+            if( counts[id] >= minOverlap )
+                matches.push_back({ id, counts[id] });
+        }
+        const auto better = [](const Match &a, const Match &b) {
+            return a.overlap > b.overlap or (a.overlap == b.overlap and a.id < b.id);
+        };
+        if( matches.size() > k ) {
+            std::partial_sort( matches.begin(), matches.begin() + k, matches.end(), better );
+            matches.resize( k );
+        }
+        else {
+            std::sort( matches.begin(), matches.end(), better );
+        }
+    }
+
+
+    vector<SdrIndex::Match> SdrIndex::query( const SDR &sdr, UInt k, UInt minOverlap ) const {
+        NTA_CHECK( sdr.size == sdrSize_ )
+            << "SdrIndex::query - SDR size " << sdr.size << " does not match index size " << sdrSize_;
+        NTA_CHECK( minOverlap >= 1u ) << "SdrIndex::query - minOverlap must be at least 1";
+        const ScratchPool::Lease scratch( scratch_ );
+        vector<Match> matches;
+        query_( sdr.getSparse(), k, minOverlap, *scratch, matches );
+        return matches;
+    }
+
+
+    vector<vector<SdrIndex::Match>> SdrIndex::queryBatch( const vector<SDR> &sdrs,
+                                                           UInt k, UInt minOverlap ) const {
+        NTA_CHECK( minOverlap >= 1u ) << "SdrIndex::queryBatch - minOverlap must be at least 1";
+        for( const auto &sdr : sdrs ) {
+            NTA_CHECK( sdr.size == sdrSize_ )
+                << "SdrIndex::queryBatch - SDR size " << sdr.size << " does not match index size " << sdrSize_;
+            sdr.getSparse(); // Convert before the SDRs are shared between threads.
+        }
+        vector<vector<Match>> results( sdrs.size() );
+        if( sdrs.empty() ) return results;
+
+        // Each task handles a contiguous slice of the queries, with its own
+        // scratch space from this index's pool.
+        const size_t numTasks = pool_ ? std::min<size_t>( sdrs.size(), 4u * pool_->numThreads() ) : 1u;
+        const auto runTask = [&](const size_t task) {
+            const ScratchPool::Lease scratch( scratch_ );
+            const auto range = ThreadPool::split( sdrs.size(), numTasks, task );
+            for( size_t i = range.first; i < range.second; i++ )
+                query_( sdrs[i].getSparse(), k, minOverlap, *scratch, results[i] );
+        };
+        if( pool_ ) {
+            pool_->parallelFor( numTasks, runTask );
+        } else {
+            runTask( 0u );
+        }
+        return results;
+    }
+
+
+    void SdrIndex::rebuild_() {
+        postings_.assign( sdrSize_, {} );
+        count_ = 0u;
+        for( UInt id = 0u; id < entries_.size(); id++ ) {
+            if( not alive_[id] ) continue;
+            for( const auto bit : entries_[id] ) {
+                NTA_CHECK( bit < sdrSize_ ) << "SdrIndex: stored SDR is out of bounds";
+                postings_[bit].push_back( id );
+            }
+            count_++;
+        }
+    }
+
+
+    bool SdrIndex::operator==( const SdrIndex &other ) const {
+        return dimensions_ == other.dimensions_
+           and alive_      == other.alive_
+           and entries_    == other.entries_;
+    }
+
+} // end namespace htm
@@ -0,0 +1,234 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+/** @file
+ * Definitions for the SdrIndex class
+ */
+
+#ifndef SDR_INDEX_HPP
+#define SDR_INDEX_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <htm/types/Sdr.hpp>
+#include <htm/types/Serializable.hpp>
+#include <htm/types/Types.hpp>
+#include <htm/utils/ThreadPool.hpp>
+
+namespace htm {
+
+/**
+ * SdrIndex stores SDRs and finds the stored SDRs which have the largest
+ * overlap with a query SDR.
+ *
+ * ### Description
+ * The index keeps, for every bit, the list of the stored SDRs which have that
+ * bit active (an inverted index).  A query only visits the lists of its own
+ * active bits, so its cost is proportional to the number of stored bits it
+ * shares with the query, rather than to the number of stored SDRs.
+ *
+ * Stored SDRs are identified by the id returned from add().  Ids are not
+ * reused after remove(), so they remain valid for the lifetime of the index,
+ * including across serialization.
+ *
+ * Example Usage:
+ *    SdrIndex index({ 1000 });
+ *    SDR A({ 1000 });  A.randomize( 0.02f );
+ *    UInt id = index.add( A );
+ *    auto matches = index.query( A, 10 );
+ *    matches[0].id      -> id
+ *    matches[0].overlap -> 20
+ */
+class SdrIndex : public Serializable
+{
+public:
+    /**
+     * A stored SDR and its overlap with a query.
+     */
+    struct Match {
+        UInt id;
+        UInt overlap;
+
+        bool operator==(const Match &other) const
+            { return id == other.id and overlap == other.overlap; }
+    };
+
+    /**
+     * Use this method only in conjuction with initialize() or load().
+     */
+    SdrIndex() {}
+
+    /**
+     * @param dimensions The dimensions of the SDRs which will be stored.
+     */
+    SdrIndex( const std::vector<UInt> &dimensions )
+        { initialize( dimensions ); }
+
+    void initialize( const std::vector<UInt> &dimensions );
+
+    /**
+     * @returns The dimensions of the stored SDRs.
+     */
+    const std::vector<UInt> &dimensions() const { return dimensions_; }
+
+    /**
+     * @returns The number of SDRs currently stored.
+     */
+    size_t size() const { return count_; }
+
+    /**
+     * Stores a copy of the given SDR.
+     *
+     * @returns The id of the stored SDR.
+     */
+    UInt add( const SDR &sdr );
+
+    /**
+     * Removes a stored SDR.
+     *
+     * @param id An id returned by add() which has not been removed yet.
+     */
+    void remove( UInt id );
+
+    /**
+     * @returns True if the id refers to a stored SDR.
+     */
+    bool contains( UInt id ) const
+        { return id < alive_.size() and alive_[id]; }
+
+    /**
+     * @returns The sparse indices of a stored SDR.
+     */
+    const SDR_sparse_t &getSparse( UInt id ) const;
+
+    /**
+     * Finds the stored SDRs with the largest overlap with the query.
+     *
+     * @param sdr The query, must have the same size as the stored SDRs.
+     * @param k The maximum number of matches to return.
+     * @param minOverlap Stored SDRs with a smaller overlap are not returned.
+     * Must be at least 1.
+     *
+     * @returns Up to k matches, by decreasing overlap and then by id.
+     *
+     * query() and queryBatch() may run concurrently with each other, each
+     * call uses its own scratch space.  They must not run concurrently with
+     * add(), remove(), initialize() or load().
+     */
+    std::vector<Match> query( const SDR &sdr, UInt k, UInt minOverlap = 1u ) const;
+
+    /**
+     * Runs query() for each of the given SDRs.  The queries are split over
+     * the threads of the ThreadPool given to setThreadPool(), if any.
+     */
+    std::vector<std::vector<Match>> queryBatch( const std::vector<SDR> &sdrs,
+                                                UInt k, UInt minOverlap = 1u ) const;
+
+    /**
+     * Use the given ThreadPool for queryBatch().
+     *
+     * @param pool ThreadPool to use, or nullptr to run serially.
+     */
+    void setThreadPool( std::shared_ptr<ThreadPool> pool ) { pool_ = pool; }
+    std::shared_ptr<ThreadPool> getThreadPool() const { return pool_; }
+
+    bool operator==( const SdrIndex &other ) const;
+    inline bool operator!=( const SdrIndex &other ) const
+        { return not ((*this) == other); }
+
+    /**
+     * Serialization routines.  See Serializable.hpp
+     * The inverted index is not saved, it is rebuilt on load.
+     */
+    CerealAdapter;
+
+    template<class Archive>
+    void save_ar(Archive & ar) const
+    {
+        ar(cereal::make_nvp("dimensions", dimensions_),
+           cereal::make_nvp("alive", alive_),
+           cereal::make_nvp("entries", entries_));
+    }
+
+    template<class Archive>
+    void load_ar(Archive & ar)
+    {
+        std::vector<UInt> dimensions;
+        std::vector<Byte> alive;
+        std::vector<SDR_sparse_t> entries;
+        ar(dimensions, alive, entries);
+        NTA_CHECK( alive.size() == entries.size() );
+        initialize( dimensions );
+        alive_.swap( alive );
+        entries_.swap( entries );
+        rebuild_();
+    }
+
+private:
+    // Scratch space of one query.  counts is all zeros between queries.
+    struct QueryScratch {
+        std::vector<UInt> counts;
+        std::vector<UInt> touched;
+    };
+
+    // The scratch spaces of this index which are not in use, so that
+    // concurrent queries each get their own.  Copies start out empty.
+    class ScratchPool {
+    public:
+        ScratchPool() = default;
+        ScratchPool( const ScratchPool & ) {}
+        ScratchPool &operator=( const ScratchPool & ) { return *this; }
+
+        // Takes a scratch space from the pool and gives it back when
+        // destroyed, also when the query throws.
+        class Lease {
+        public:
+            explicit Lease( ScratchPool &pool );
+            ~Lease();
+            Lease( const Lease & ) = delete;
+            Lease &operator=( const Lease & ) = delete;
+            QueryScratch &operator*() const { return *scratch_; }
+        private:
+            ScratchPool &pool_;
+            std::unique_ptr<QueryScratch> scratch_;
+        };
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<QueryScratch>> free_;
+    };
+
+    // Counts the overlaps of the query with the stored SDRs, using the
+    // given scratch space, and selects the top k.
+    void query_( const SDR_sparse_t &sparse, UInt k, UInt minOverlap,
+                 QueryScratch &scratch, std::vector<Match> &matches ) const;
+    void rebuild_();
+
+    std::vector<UInt>          dimensions_;
+    UInt                       sdrSize_ = 0u;
+    size_t                     count_   = 0u;
+    std::vector<Byte>          alive_;     // for each id
+    std::vector<SDR_sparse_t>  entries_;   // for each id, empty once removed
+    std::vector<std::vector<UInt>> postings_; // for each bit, the ids with the bit active
+    std::shared_ptr<ThreadPool> pool_;
+    mutable ScratchPool        scratch_;
+};
+
+} // end namespace htm
+#endif // end ifndef SDR_INDEX_HPP
@@ -0,0 +1,180 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+/** @file
+ * Implementation of the snapshot file format
+ */
+
+#include <htm/types/Snapshot.hpp>
+#include <htm/os/MappedFile.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace htm {
+
+static_assert(sizeof(SnapshotHeader)  == 64, "The sections must be aligned");
+static_assert(sizeof(SnapshotSection) == 64, "The sections must be aligned");
+
+namespace {
+  const UInt64 SECTION_ALIGNMENT = 64u;
+
+  UInt64 alignUp(UInt64 offset)
+    { return (offset + SECTION_ALIGNMENT - 1u) / SECTION_ALIGNMENT * SECTION_ALIGNMENT; }
+}
+
+
+SnapshotWriter::SnapshotWriter(const std::string &kind) {
+  NTA_CHECK(kind.size() < sizeof(header_.kind)) << "Snapshot kind '" << kind << "' is too long.";
+  std::strncpy(header_.kind, kind.c_str(), sizeof(header_.kind) - 1u);
+}
+
+
+void SnapshotWriter::add_(const std::string &name, const char *data, size_t elementSize,
+                          size_t count, std::shared_ptr<void> owner) {
+  Pending p;
+  NTA_CHECK(name.size() < sizeof(p.section.name)) << "Snapshot section name '" << name << "' is too long.";
+  for(const auto &other : sections_) {
+    NTA_CHECK(name != other.section.name) << "Snapshot section '" << name << "' was added twice.";
+  }
+  std::strncpy(p.section.name, name.c_str(), sizeof(p.section.name) - 1u);
+  p.section.elementSize = static_cast<UInt32>(elementSize);
+  p.section.count       = count;
+  p.data  = data;
+  p.owner = owner;
+  sections_.push_back(p);
+}
+
+
+void SnapshotWriter::save(std::ostream &out) const {
+  // Lay out the sections after the header and the section table.
+  SnapshotHeader header = header_;
+  header.numSections = sections_.size();
+  std::vector<SnapshotSection> table;
+  UInt64 offset = sizeof(SnapshotHeader) + sections_.size() * sizeof(SnapshotSection);
+  for(const auto &p : sections_) {
+    table.push_back(p.section);
+    offset = alignUp(offset);
+    table.back().offset = offset;
+    offset += p.section.count * p.section.elementSize;
+  }
+  header.fileSize = offset;
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(SnapshotSection));
+  UInt64 position = sizeof(SnapshotHeader) + table.size() * sizeof(SnapshotSection);
+  const char padding[SECTION_ALIGNMENT] = {};
+  for(size_t i = 0u; i < sections_.size(); i++) {
+    out.write(padding, table[i].offset - position);
+    const UInt64 bytes = table[i].count * table[i].elementSize;
+    out.write(sections_[i].data, bytes);
+    position = table[i].offset + bytes;
+  }
+  NTA_CHECK(out.good()) << "Unable to write snapshot.";
+}
+
+
+void SnapshotWriter::saveFile(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  NTA_CHECK(out.is_open()) << "Unable to create snapshot file '" << path << "'.";
+  save(out);
+  out.close();
+  NTA_CHECK(!out.fail()) << "Unable to write snapshot file '" << path << "'.";
+}
+
+
+SnapshotReader::SnapshotReader(const std::string &path) {
+  file_.reset(new MappedFile(path));
+  data_ = file_->data();
+  NTA_CHECK(file_->size() >= sizeof(SnapshotHeader)) << "'" << path << "' is not a snapshot file.";
+  parse_(file_->size());
+}
+
+
+SnapshotReader::SnapshotReader(std::istream &in) {
+  SnapshotHeader header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  NTA_CHECK(in.gcount() == sizeof(header)) << "Snapshot is truncated.";
+  NTA_CHECK(std::memcmp(header.magic, header_.magic, sizeof(header.magic)) == 0) << "Not a snapshot.";
+  NTA_CHECK(header.fileSize >= sizeof(header)) << "Snapshot is corrupt.";
+
+  // fileSize is not trusted yet, so the buffer only grows as data arrives:
+  // at most twice what was actually read, plus one chunk.
+  const UInt64 chunk = UInt64(1u) << 20u;
+  UInt64 size = sizeof(header);
+  buffer_.resize((size + sizeof(UInt64) - 1u) / sizeof(UInt64));
+  std::memcpy(buffer_.data(), &header, sizeof(header));
+  while(size < header.fileSize) {
+    const UInt64 step = std::min(header.fileSize - size, std::max(chunk, size));
+    buffer_.resize((size + step + sizeof(UInt64) - 1u) / sizeof(UInt64));
+    in.read(reinterpret_cast<char *>(buffer_.data()) + size, static_cast<std::streamsize>(step));
+    NTA_CHECK(in.gcount() == static_cast<std::streamsize>(step)) << "Snapshot is truncated.";
+    size += step;
+  }
+  data_ = reinterpret_cast<const char *>(buffer_.data());
+  parse_(header.fileSize);
+}
+
+
+SnapshotReader::~SnapshotReader() {}
+
+
+void SnapshotReader::parse_(size_t size) {
+  const SnapshotHeader expected;
+  std::memcpy(&header_, data_, sizeof(header_));
+  NTA_CHECK(std::memcmp(header_.magic, expected.magic, sizeof(header_.magic)) == 0) << "Not a snapshot.";
+  NTA_CHECK(header_.byteOrder == expected.byteOrder)
+      << "Snapshot was written on a machine with a different byte order.";
+  NTA_CHECK(header_.version <= expected.version)
+      << "Snapshot version " << header_.version << " is newer than the supported version " << expected.version;
+  header_.kind[sizeof(header_.kind) - 1u] = '\0';
+  NTA_CHECK(header_.fileSize <= size) << "Snapshot is truncated.";
+
+  const UInt64 tableEnd = sizeof(SnapshotHeader) + header_.numSections * sizeof(SnapshotSection);
+  NTA_CHECK(header_.numSections < size / sizeof(SnapshotSection) && tableEnd <= size) << "Snapshot is corrupt.";
+  sections_ = reinterpret_cast<const SnapshotSection *>(data_ + sizeof(SnapshotHeader));
+  for(UInt64 i = 0u; i < header_.numSections; i++) {
+    const SnapshotSection &s = sections_[i];
+    NTA_CHECK(s.name[sizeof(s.name) - 1u] == '\0') << "Snapshot is corrupt.";
+    NTA_CHECK(s.offset % SECTION_ALIGNMENT == 0u && s.offset >= tableEnd && s.offset <= size)
+        << "Snapshot section '" << s.name << "' is corrupt.";
+    NTA_CHECK(s.elementSize == 0u || s.count <= (size - s.offset) / s.elementSize)
+        << "Snapshot section '" << s.name << "' is truncated.";
+  }
+}
+
+
+const SnapshotSection *SnapshotReader::find_(const std::string &name) const {
+  for(UInt64 i = 0u; i < header_.numSections; i++) {
+    if(name == sections_[i].name)
+      return &sections_[i];
+  }
+  return nullptr;
+}
+
+
+const SnapshotSection &SnapshotReader::section_(const std::string &name, size_t elementSize) const {
+  const SnapshotSection *s = find_(name);
+  NTA_CHECK(s != nullptr) << "Snapshot of " << header_.kind << " has no section '" << name << "'.";
+  NTA_CHECK(s->elementSize == elementSize)
+      << "Snapshot section '" << name << "' has records of " << s->elementSize
+      << " bytes, expected " << elementSize << ".";
+  return *s;
+}
+
+} // namespace htm
@@ -0,0 +1,205 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+/** @file
+ * Definitions for the snapshot file format
+ */
+
+#ifndef NTA_SNAPSHOT_HPP
+#define NTA_SNAPSHOT_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <htm/types/Types.hpp>
+#include <htm/utils/Log.hpp>
+
+namespace htm {
+
+class MappedFile;
+
+/**
+ * Snapshot file format.
+ *
+ * @b Description
+ * A snapshot is a flat binary image of a large object (Connections,
+ * SpatialPooler, TemporalMemory), meant for restarting from a saved model
+ * quickly. Unlike the Serializable formats nothing is parsed element by
+ * element: the file is a list of named sections and each section is an array
+ * of fixed size records, written and read with a single bulk copy.
+ *
+ * Layout:
+ *    SnapshotHeader                      64 bytes
+ *    SnapshotSection[numSections]        64 bytes each
+ *    section data, each section starts at a multiple of 64 bytes
+ *
+ * The records are stored in the native byte order. The header carries a byte
+ * order mark, and a snapshot can only be read on a machine with the same byte
+ * order and type sizes; it is not a portable interchange format.
+ */
+struct SnapshotHeader {
+  char   magic[8]  = {'H', 'T', 'M', 'S', 'N', 'A', 'P', '\0'};
+  UInt32 version   = 1;
+  UInt32 byteOrder = 0x01020304;
+  char   kind[24]  = {};  // type of the saved object, NUL terminated
+  UInt64 numSections = 0;
+  UInt64 fileSize    = 0;
+  UInt64 reserved    = 0;
+};
+
+struct SnapshotSection {
+  char   name[40]    = {}; // NUL terminated
+  UInt32 elementSize = 0;  // bytes per record
+  UInt32 reserved    = 0;
+  UInt64 offset      = 0;  // from the start of the file
+  UInt64 count       = 0;  // number of records
+};
+
+
+/**
+ * Collects the sections of a snapshot and writes them out.
+ *
+ * Sections added by pointer are not copied, the data must stay valid until
+ * the snapshot is saved. Sections added by value are owned by the writer.
+ *
+ * Example Usage:
+ *    SnapshotWriter w("Example");
+ *    w.add("values", values);                  // std::vector<Real>, by pointer
+ *    w.add("flat",   std::move(flatList));      // owned
+ *    w.saveFile("model.htms");
+ */
+class SnapshotWriter {
+public:
+  explicit SnapshotWriter(const std::string &kind);
+
+  template<typename T>
+  void add(const std::string &name, const T *data, size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot records must be trivially copyable");
+    add_(name, reinterpret_cast<const char *>(data), sizeof(T), count, nullptr);
+  }
+
+  template<typename T>
+  void add(const std::string &name, const std::vector<T> &data)
+    { add(name, data.data(), data.size()); }
+
+  template<typename T>
+  void add(const std::string &name, std::vector<T> &&data) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot records must be trivially copyable");
+    auto owned = std::make_shared<std::vector<T>>(std::move(data));
+    add_(name, reinterpret_cast<const char *>(owned->data()), sizeof(T), owned->size(), owned);
+  }
+
+  /** Adds a single record. */
+  template<typename T>
+  void addValue(const std::string &name, const T &value)
+    { add(name, std::vector<T>{value}); }
+
+  void save(std::ostream &out) const;
+  void saveFile(const std::string &path) const;
+
+private:
+  struct Pending {
+    SnapshotSection       section;
+    const char           *data;
+    std::shared_ptr<void> owner;
+  };
+  void add_(const std::string &name, const char *data, size_t elementSize,
+            size_t count, std::shared_ptr<void> owner);
+
+  SnapshotHeader       header_;
+  std::vector<Pending> sections_;
+};
+
+
+/**
+ * Reads a snapshot.
+ *
+ * A snapshot file is mapped into memory: the sections are used in place, the
+ * OS reads the pages on first access. A snapshot in a stream is read with one
+ * bulk read into an aligned buffer. In both cases the data stays valid for the
+ * lifetime of the reader.
+ */
+class SnapshotReader {
+public:
+  /** Read only view of the records of a section. */
+  template<typename T>
+  struct Range {
+    const T *first;
+    const T *last;
+    const T *begin() const noexcept { return first; }
+    const T *end()   const noexcept { return last; }
+    size_t   size()  const noexcept { return static_cast<size_t>(last - first); }
+    const T &operator[](size_t idx) const { return first[idx]; }
+  };
+
+  explicit SnapshotReader(const std::string &path);
+  explicit SnapshotReader(std::istream &in);
+  ~SnapshotReader();
+
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  std::string kind() const { return header_.kind; }
+  UInt32 version() const { return header_.version; }
+
+  bool has(const std::string &name) const { return find_(name) != nullptr; }
+
+  /**
+   * @returns The records of a section, in place.
+   * @throws if the section is missing or its records have a different size.
+   */
+  template<typename T>
+  Range<T> get(const std::string &name) const {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot records must be trivially copyable");
+    const SnapshotSection &s = section_(name, sizeof(T));
+    const T *data = reinterpret_cast<const T *>(data_ + s.offset);
+    return {data, data + s.count};
+  }
+
+  /** Copies a section into a vector, replacing its contents. */
+  template<typename T>
+  void read(const std::string &name, std::vector<T> &out) const {
+    const auto range = get<T>(name);
+    out.assign(range.begin(), range.end());
+  }
+
+  /** Reads a section which holds a single record. */
+  template<typename T>
+  T getValue(const std::string &name) const {
+    const auto range = get<T>(name);
+    NTA_CHECK(range.size() == 1u) << "Snapshot section '" << name << "' is not a single value.";
+    return range[0];
+  }
+
+private:
+  void parse_(size_t size);
+  const SnapshotSection *find_(const std::string &name) const;
+  const SnapshotSection &section_(const std::string &name, size_t elementSize) const;
+
+  SnapshotHeader                  header_;
+  const SnapshotSection          *sections_ = nullptr;
+  const char                     *data_     = nullptr;
+  std::unique_ptr<MappedFile>     file_;
+  std::vector<UInt64>             buffer_;  // 8 byte aligned
+};
+
+} // namespace htm
+
+#endif // NTA_SNAPSHOT_HPP
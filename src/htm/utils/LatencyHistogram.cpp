@@ -0,0 +1,89 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+#include "htm/utils/LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace htm;
+
+static const Real64 NS_TO_SECONDS = 1.0e-9;
+
+
+size_t LatencyHistogram::bucket(UInt64 ns) noexcept {
+  if( ns < subBuckets ) return static_cast<size_t>(ns); // exact below 8 ns
+  // ns = top * 2^shift + rest, with top in [8, 16)
+  size_t log2 = 3u;
+  while( log2 < 63u && (ns >> (log2 + 1u)) != 0u ) log2++;
+  const size_t shift = log2 - 3u;
+  const size_t top   = static_cast<size_t>(ns >> shift);
+  return subBuckets + shift * subBuckets + (top - subBuckets);
+}
+
+
+UInt64 LatencyHistogram::bucketLimit(size_t b) noexcept {
+  if( b < subBuckets ) return b;
+  const size_t shift = (b - subBuckets) / subBuckets;
+  const UInt64 top   = subBuckets + (b - subBuckets) % subBuckets;
+  return ((top + 1u) << shift) - 1u;
+}
+
+
+void LatencyHistogram::record(const UInt64 ns) noexcept {
+  buckets_[bucket(ns)].fetch_add(1u, memory_order_relaxed);
+  count_.fetch_add(1u, memory_order_relaxed);
+  sum_.fetch_add(ns, memory_order_relaxed);
+  UInt64 prev = max_.load(memory_order_relaxed);
+  while( prev < ns && !max_.compare_exchange_weak(prev, ns, memory_order_relaxed) ) {}
+}
+
+
+void LatencyHistogram::reset() noexcept {
+  for(auto &b : buckets_) b.store(0u, memory_order_relaxed);
+  count_.store(0u, memory_order_relaxed);
+  sum_.store(0u, memory_order_relaxed);
+  max_.store(0u, memory_order_relaxed);
+}
+
+
+Real64 LatencyHistogram::getSum() const noexcept {
+  return static_cast<Real64>(sum_.load(memory_order_relaxed)) * NS_TO_SECONDS;
+}
+
+Real64 LatencyHistogram::getMax() const noexcept {
+  return static_cast<Real64>(max_.load(memory_order_relaxed)) * NS_TO_SECONDS;
+}
+
+
+Real64 LatencyHistogram::getQuantile(Real64 q) const noexcept {
+  const UInt64 count = getCount();
+  if( count == 0u ) return 0.0;
+  q = std::min(1.0, std::max(0.0, q));
+  // rank of the sample, counting from 1
+  const UInt64 rank = std::max<UInt64>(1u, static_cast<UInt64>(std::ceil(q * static_cast<Real64>(count))));
+  const UInt64 maximum = max_.load(memory_order_relaxed);
+  UInt64 seen = 0u;
+  for(size_t b = 0u; b < numBuckets; b++) {
+    seen += buckets_[b].load(memory_order_relaxed);
+    if( seen >= rank ) {
+      return static_cast<Real64>(std::min(bucketLimit(b), maximum)) * NS_TO_SECONDS;
+    }
+  }
+  return static_cast<Real64>(maximum) * NS_TO_SECONDS;
+}
@@ -0,0 +1,104 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+/** @file
+ * Histogram of durations, for profiling the latency of the regions and
+ * links of a Network.
+ */
+
+#ifndef HTM_UTIL_LATENCY_HISTOGRAM_HPP
+#define HTM_UTIL_LATENCY_HISTOGRAM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include <htm/types/Types.hpp>
+
+namespace htm {
+
+/**
+ * LatencyHistogram counts durations in buckets on a logarithmic scale, with
+ * 8 buckets for each power of two nanoseconds. Quantiles are therefore exact
+ * to within 12.5%, using a fixed 4 KB per histogram regardless of the number
+ * of samples. The count, sum and maximum are exact.
+ *
+ * record() is lock free and may be called from several threads, and the
+ * getters may be called while recording; a report taken while recording is
+ * not a consistent snapshot, but every value in it is valid.
+ *
+ * Example Usage:
+ *    LatencyHistogram h;
+ *    const auto begin = LatencyHistogram::clock::now();
+ *    work();
+ *    h.recordSince(begin);
+ *    h.getQuantile(0.99);
+ */
+class LatencyHistogram {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr size_t subBuckets = 8u;
+  static constexpr size_t numBuckets = subBuckets * 62u; // up to 2^64 ns
+
+  LatencyHistogram() { reset(); }
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  /** Add one sample of the given duration in nanoseconds. */
+  void record(UInt64 nanoseconds) noexcept;
+
+  /** Add one sample, the time elapsed since begin. */
+  void recordSince(clock::time_point begin) noexcept {
+    record(static_cast<UInt64>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count()));
+  }
+
+  /** Forget all samples. */
+  void reset() noexcept;
+
+  /** @returns number of samples. */
+  UInt64 getCount() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+  /** @returns the total duration of all samples, in seconds. */
+  Real64 getSum() const noexcept;
+
+  /** @returns the longest duration, in seconds. */
+  Real64 getMax() const noexcept;
+
+  /**
+   * @param q Quantile in [0, 1], ie. 0.5 for the median and 0.99 for the
+   *   99th percentile.
+   * @returns upper bound of the duration of quantile q, in seconds, or 0
+   *   without samples.
+   */
+  Real64 getQuantile(Real64 q) const noexcept;
+
+  /** @returns the bucket of a duration. */
+  static size_t bucket(UInt64 nanoseconds) noexcept;
+  /** @returns the largest duration in a bucket, in nanoseconds. */
+  static UInt64 bucketLimit(size_t bucket) noexcept;
+
+private:
+  std::atomic<UInt64> buckets_[numBuckets];
+  std::atomic<UInt64> count_;
+  std::atomic<UInt64> sum_; // nanoseconds
+  std::atomic<UInt64> max_; // nanoseconds
+};
+
+} // namespace htm
+#endif // HTM_UTIL_LATENCY_HISTOGRAM_HPP
@@ -19,6 +19,7 @@
  */
 
 #include <cmath> // log2, isnan, NAN, INFINITY
+#include <algorithm> // fill, min_element, max_element
 #include <numeric> // accumulate
 #include <regex>
 #include <htm/utils/SdrMetrics.hpp>
@@ -135,15 +136,18 @@ ActivationFrequency::ActivationFrequency( const SDR &dataSource,
 
 void ActivationFrequency::initialize( UInt size, Real initialValue ) {
     if( initialValue == -1 ) {
-        activationFrequency_.assign( size, 1234.567f );
+        scaled_.assign( size, 1234.567f );
         alwaysExponential_ = false;
     }
     else {
         NTA_CHECK( initialValue >= 0.0f );
         NTA_CHECK( initialValue <= 1.0f );
-        activationFrequency_.assign( size, initialValue );
+        scaled_.assign( size, initialValue );
         alwaysExponential_ = true;
     }
+    scale_ = 1.0;
+    activationFrequency_.resize( size );
+    frequenciesValid_ = false;
 }
 
 void ActivationFrequency::callback(const SDR &dataSource, Real alpha)
@@ -151,41 +155,66 @@ void ActivationFrequency::callback(const SDR &dataSource, Real alpha)
     if( alwaysExponential_ ) {
         alpha = 1.0f / period;
     }
-
     const auto decay = 1.0f - alpha;
-    for(auto &value : activationFrequency_)
-        value *= decay;
-
+    if( decay == 0.0f ) {
+        // The new sample replaces all of the history.
+        std::fill( scaled_.begin(), scaled_.end(), 0.0f );
+        scale_ = 1.0;
+    }
+    else {
+        scale_ *= decay;
+        // Fold the scale back into the data before the values grow too large
+        // to be represented accurately.  This visits every bit, but only once
+        // every few dozen periods.
+        if( scale_ < 1.0e-20 ) {
+            for(auto &value : scaled_)
+                value = (Real) (value * scale_);
+            scale_ = 1.0;
+        }
+    }
+    const auto increment = (Real) (alpha / scale_);
     const auto &sparse = dataSource.getSparse();
     for(const auto &idx : sparse)
-        activationFrequency_[idx] += alpha;
+        scaled_[idx] += increment;
+    frequenciesValid_ = false;
+}
+
+const vector<Real> &ActivationFrequency::getActivationFrequency() const {
+    if( not frequenciesValid_ ) {
+        for(size_t i = 0; i < scaled_.size(); i++)
+            activationFrequency_[i] = (Real) (scaled_[i] * scale_);
+        frequenciesValid_ = true;
+    }
+    return activationFrequency_;
 }
 
 Real ActivationFrequency::min() const {
-    return *std::min_element(activationFrequency_.begin(),
-                             activationFrequency_.end());
+    const auto &frequencies = getActivationFrequency();
+    return *std::min_element(frequencies.begin(), frequencies.end());
 }
 
 Real ActivationFrequency::max() const {
-    return *std::max_element(activationFrequency_.begin(),
-                             activationFrequency_.end());
+    const auto &frequencies = getActivationFrequency();
+    return *std::max_element(frequencies.begin(), frequencies.end());
 }
 
 Real ActivationFrequency::mean() const  {
-    const auto sum = std::accumulate( activationFrequency_.begin(),
-                                      activationFrequency_.end(),
+    const auto &frequencies = getActivationFrequency();
+    const auto sum = std::accumulate( frequencies.begin(),
+                                      frequencies.end(),
                                       0.0f);
-    return (Real) sum / activationFrequency_.size();
+    return (Real) sum / frequencies.size();
 }
 
 Real ActivationFrequency::std() const {
     const auto mean_ = mean();
     auto sum_squares = 0.0f;
-    for(const auto &frequency : activationFrequency) {
+    const auto &frequencies = getActivationFrequency();
+    for(const auto &frequency : frequencies) {
         const auto displacement = frequency - mean_;
         sum_squares += displacement * displacement;
     }
-    const auto variance = sum_squares / activationFrequency.size();
+    const auto variance = sum_squares / frequencies.size();
 
     return std::sqrt( variance );
 }
@@ -204,7 +233,7 @@ Real ActivationFrequency::entropy() const {
     const auto max_extropy = binary_entropy_({ mean() });
     if( max_extropy == 0.0f )
         return 0.0f;
-    return binary_entropy_( activationFrequency ) / max_extropy;
+    return binary_entropy_( getActivationFrequency() ) / max_extropy;
 }
 
 std::ostream& operator<< (std::ostream& stream,
@@ -220,13 +249,11 @@ std::ostream& operator<< (std::ostream& stream,
 /******************************************************************************/
 
 Overlap::Overlap( const vector<UInt> &dimensions, UInt period )
-    : MetricsHelper_( dimensions, period ),
-      previous_( dimensions )
+    : MetricsHelper_( dimensions, period )
     { initialize(); }
 
 Overlap::Overlap( const SDR &dataSource, UInt period )
-    : MetricsHelper_( dataSource, period ),
-      previous_( dataSource.dimensions )
+    : MetricsHelper_( dataSource, period )
     { initialize(); }
 
 void Overlap::initialize() {
@@ -242,8 +269,9 @@ void Overlap::reset()
     { previousValid_ = false; }
 
 void Overlap::callback(const SDR &dataSource, Real alpha) {
+    const auto &sparse = dataSource.getSparse();
     if( not previousValid_ ) {
-        previous_.setSDR( dataSource );
+        previous_.assign( sparse.begin(), sparse.end() );
         previousValid_ = true;
         // It takes two data samples to compute overlap so decrement the
         // samples counter & return & wait for the next sample.
@@ -251,8 +279,16 @@ void Overlap::callback(const SDR &dataSource, Real alpha) {
         overlap_ = NAN;
         return;
     }
-    const auto nbits = std::max( previous_.getSum(), dataSource.getSum() );
-    const auto rawOverlap = previous_.getOverlap( dataSource );
+    // Both index lists are sorted, so the overlap is found by merging them.
+    UInt rawOverlap = 0u;
+    auto a = previous_.cbegin();
+    auto b = sparse.cbegin();
+    while( a != previous_.cend() and b != sparse.cend() ) {
+        if( *a < *b )       { ++a; }
+        else if( *b < *a )  { ++b; }
+        else                { ++rawOverlap; ++a; ++b; }
+    }
+    const auto nbits = (UInt) std::max( previous_.size(), sparse.size() );
     overlap_ = (nbits == 0u) ? 1.0f : (Real) rawOverlap / nbits;
     min_     = std::min( min_, overlap_ );
     max_     = std::max( max_, overlap_ );
@@ -262,7 +298,7 @@ void Overlap::callback(const SDR &dataSource, Real alpha) {
     const Real incr      = alpha * diff;
                mean_    += incr;
                variance_ = (1.0f - alpha) * (variance_ + diff * incr);
-    previous_.setSDR( dataSource );
+    previous_.assign( sparse.begin(), sparse.end() );
 }
 
 Real Overlap::min() const { return min_; }
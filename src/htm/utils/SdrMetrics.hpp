@@ -211,7 +211,48 @@ public:
     ActivationFrequency( const std::vector<UInt> &dimensions, UInt period,
                          Real initialValue = -1 );
 
-    const std::vector<Real> &activationFrequency = activationFrequency_;
+    /**
+     * Read only view of the activation frequencies, usable like a
+     * std::vector<Real>.  The frequencies are brought up to date when they are
+     * read, see method getActivationFrequency.
+     */
+    class Frequencies {
+    public:
+        using value_type     = Real;
+        using const_iterator = std::vector<Real>::const_iterator;
+        using iterator       = const_iterator;
+
+        explicit Frequencies(const ActivationFrequency &parent)
+            : parent_( parent ) {}
+
+        operator const std::vector<Real> &() const
+            { return parent_.getActivationFrequency(); }
+
+        size_t         size()  const { return parent_.activationFrequency_.size(); }
+        const Real    *data()  const { return parent_.getActivationFrequency().data(); }
+        const_iterator begin() const { return parent_.getActivationFrequency().begin(); }
+        const_iterator end()   const { return parent_.getActivationFrequency().end(); }
+        Real operator[](size_t idx) const
+            { return parent_.getActivationFrequency()[idx]; }
+        bool operator==(const std::vector<Real> &other) const
+            { return parent_.getActivationFrequency() == other; }
+        bool operator!=(const std::vector<Real> &other) const
+            { return not (*this == other); }
+
+    private:
+        const ActivationFrequency &parent_;
+    };
+
+    const Frequencies activationFrequency{ *this };
+
+    /**
+     * Each update only visits the active bits of the SDR: the decay which
+     * applies to every bit is kept as a single scale factor, and the
+     * frequencies are computed from it when they are read.
+     *
+     * @returns The activation frequency of each bit in the SDR.
+     */
+    const std::vector<Real> &getActivationFrequency() const;
 
     Real min() const;
     Real max() const;
@@ -234,7 +275,12 @@ public:
     friend std::ostream& operator<< (std::ostream &, const ActivationFrequency &);
 
 private:
-    std::vector<Real> activationFrequency_;
+    // The frequency of bit i is (scaled_[i] * scale_).  activationFrequency_
+    // holds these products, and is only valid while frequenciesValid_.
+    std::vector<Real>         scaled_;
+    double                    scale_;
+    mutable std::vector<Real> activationFrequency_;
+    mutable bool              frequenciesValid_;
     bool alwaysExponential_;
 
     void initialize(UInt size, Real initialValue);
@@ -301,8 +347,8 @@ public:
     friend std::ostream& operator<< ( std::ostream &, const Overlap & );
 
 private:
-    SDR  previous_;
-    bool previousValid_;
+    SDR_sparse_t previous_;
+    bool         previousValid_;
     Real overlap_;
     Real min_;
     Real max_;
@@ -0,0 +1,115 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+#include "htm/utils/SlabAllocator.hpp"
+#include "htm/utils/Log.hpp"
+
+using namespace std;
+using namespace htm;
+
+
+SlabArena::~SlabArena() {
+  for(auto chunk : chunks_) {
+    ::operator delete(chunk);
+  }
+}
+
+
+size_t SlabArena::sizeClass(size_t bytes, size_t &blockSize) noexcept {
+  if( bytes == 0u ) bytes = 1u;
+  if( bytes <= 64u ) { // multiples of 8 bytes
+    const size_t cls = (bytes + 7u) / 8u - 1u;
+    blockSize = (cls + 1u) * 8u;
+    return cls;
+  }
+  if( bytes > maxBlockSize ) {
+    blockSize = bytes;
+    return numClasses;
+  }
+  // 4 classes for each power of two: bytes-1 = top * 2^shift + rest, top in [4, 8)
+  const size_t m = bytes - 1u;
+  size_t log2 = 6u;
+  while( (m >> (log2 + 1u)) != 0u ) log2++;
+  const size_t shift = log2 - 2u;
+  const size_t top   = m >> shift;
+  blockSize = (top + 1u) << shift;
+  return 8u + (log2 - 6u) * 4u + (top - 4u);
+}
+
+
+void *SlabArena::allocate(const size_t bytes) {
+  size_t blockSize;
+  const size_t cls = sizeClass(bytes, blockSize);
+  if( cls == numClasses ) {
+    return ::operator new(bytes);
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  inUse_ += blockSize;
+  if( freeLists_[cls] != nullptr ) {
+    FreeBlock *block = freeLists_[cls];
+    freeLists_[cls]  = block->next;
+    free_ -= blockSize;
+    return block;
+  }
+  if( static_cast<size_t>(end_ - next_) < blockSize ) {
+    // The rest of the current chunk is too small for this block. It is
+    // left unused, at most maxBlockSize out of each chunkSize.
+    next_ = static_cast<char*>(::operator new(chunkSize));
+    end_  = next_ + chunkSize;
+    chunks_.push_back(next_);
+    reserved_ += chunkSize;
+  }
+  void *block = next_;
+  next_ += blockSize;
+  return block;
+}
+
+
+void SlabArena::deallocate(void *block, const size_t bytes) noexcept {
+  if( block == nullptr ) return;
+  size_t blockSize;
+  const size_t cls = sizeClass(bytes, blockSize);
+  if( cls == numClasses ) {
+    ::operator delete(block);
+    return;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  NTA_ASSERT(inUse_ >= blockSize);
+  inUse_ -= blockSize;
+  free_  += blockSize;
+  FreeBlock *freed = static_cast<FreeBlock*>(block);
+  freed->next      = freeLists_[cls];
+  freeLists_[cls]  = freed;
+}
+
+
+size_t SlabArena::bytesReserved() const {
+  lock_guard<mutex> lock(mutex_);
+  return reserved_;
+}
+
+size_t SlabArena::bytesInUse() const {
+  lock_guard<mutex> lock(mutex_);
+  return inUse_;
+}
+
+size_t SlabArena::bytesFree() const {
+  lock_guard<mutex> lock(mutex_);
+  return free_;
+}
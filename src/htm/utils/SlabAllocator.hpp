@@ -0,0 +1,176 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+/** @file
+ * Slab arena and a matching STL allocator, for containers with many small
+ * and long lived lists such as the segments and synapses of Connections.
+ */
+
+#ifndef HTM_UTIL_SLAB_ALLOCATOR_HPP
+#define HTM_UTIL_SLAB_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace htm {
+
+/**
+ * SlabArena carves memory blocks out of large chunks and recycles freed
+ * blocks through a free list per size class. Compared to the general purpose
+ * heap this has no per block header, keeps lists which are allocated
+ * together next to each other, and does not fragment the heap with millions
+ * of tiny allocations.
+ *
+ * Sizes are rounded up to a multiple of 8 bytes below 64 bytes, and to a
+ * quarter of a power of two above that, so that the blocks freed by the
+ * geometric growth of std::vector are reused by other lists. Requests larger
+ * than maxBlockSize go straight to the heap.
+ *
+ * Memory is only given back to the system when the arena is destroyed. To
+ * shrink, copy the data into a new arena and drop the old one, see
+ * Connections::compact().
+ *
+ * The arena is thread safe. Its lifetime is managed by SlabAllocator: it is
+ * deleted together with the last allocator which refers to it.
+ */
+class SlabArena {
+public:
+  static constexpr size_t chunkSize    = size_t(1u) << 20u;
+  static constexpr size_t maxBlockSize = size_t(1u) << 15u;
+
+  SlabArena() = default;
+  ~SlabArena();
+
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  void *allocate(size_t bytes);
+  void deallocate(void *block, size_t bytes) noexcept;
+
+  /** Bytes obtained from the system, in chunks. */
+  size_t bytesReserved() const;
+  /** Bytes in live blocks, including the rounding to the size classes. */
+  size_t bytesInUse() const;
+  /** Bytes in freed blocks, waiting in the free lists to be reused. */
+  size_t bytesFree() const;
+
+  /**
+   * Size class of a request, and the rounded size of its blocks.
+   * @returns the index of the class, or numClasses for the heap.
+   */
+  static size_t sizeClass(size_t bytes, size_t &blockSize) noexcept;
+  static constexpr size_t numClasses = 8u + 4u * 9u; // up to maxBlockSize
+
+private:
+  template<typename T> friend class SlabAllocator;
+  void retain_() noexcept { refs_.fetch_add(1u, std::memory_order_relaxed); }
+  void release_() noexcept {
+    if( refs_.fetch_sub(1u, std::memory_order_acq_rel) == 1u ) delete this;
+  }
+
+  struct FreeBlock { FreeBlock *next; };
+
+  mutable std::mutex mutex_;
+  std::vector<char*> chunks_;
+  char *next_ = nullptr; // bump pointer into the last chunk
+  char *end_  = nullptr;
+  FreeBlock *freeLists_[numClasses] = {};
+  size_t reserved_ = 0u;
+  size_t inUse_    = 0u;
+  size_t free_     = 0u;
+  std::atomic<size_t> refs_{0u};
+};
+
+
+/**
+ * STL allocator which takes its memory from a SlabArena, or from the heap
+ * when it has no arena (default constructed).
+ *
+ * The allocator keeps its arena alive. Copies of a container share the arena
+ * of the original. Copy assignment, move assignment and swap carry the arena
+ * along with the data, so an aggregate of containers which is copied member
+ * by member never ends up with some members in one arena and some in another.
+ *
+ * Example Usage:
+ *    SlabAllocator<char> alloc(new SlabArena());
+ *    SlabVector<UInt> list(alloc);
+ */
+template<typename T>
+class SlabAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap            = std::true_type;
+  using is_always_equal                        = std::false_type;
+
+  static_assert(alignof(T) <= 8u, "SlabArena blocks are aligned to 8 bytes");
+
+  SlabAllocator() noexcept = default;
+
+  /** Takes a reference to arena, which may be nullptr for the heap. */
+  explicit SlabAllocator(SlabArena *arena) noexcept : arena_(arena) { retain_(); }
+
+  SlabAllocator(const SlabAllocator &other) noexcept : arena_(other.arena_) { retain_(); }
+
+  template<typename U>
+  SlabAllocator(const SlabAllocator<U> &other) noexcept : arena_(other.arena()) { retain_(); }
+
+  SlabAllocator &operator=(const SlabAllocator &other) noexcept {
+    if( arena_ != other.arena_ ) {
+      release_();
+      arena_ = other.arena_;
+      retain_();
+    }
+    return *this;
+  }
+
+  ~SlabAllocator() { release_(); }
+
+  T *allocate(const size_t n) {
+    const size_t bytes = n * sizeof(T);
+    return static_cast<T*>(arena_ ? arena_->allocate(bytes) : ::operator new(bytes));
+  }
+
+  void deallocate(T *p, const size_t n) noexcept {
+    if( arena_ ) arena_->deallocate(p, n * sizeof(T));
+    else         ::operator delete(p);
+  }
+
+  SlabArena *arena() const noexcept { return arena_; }
+
+  template<typename U>
+  bool operator==(const SlabAllocator<U> &other) const noexcept { return arena_ == other.arena(); }
+  template<typename U>
+  bool operator!=(const SlabAllocator<U> &other) const noexcept { return arena_ != other.arena(); }
+
+private:
+  void retain_()  noexcept { if( arena_ ) arena_->retain_(); }
+  void release_() noexcept { if( arena_ ) arena_->release_(); }
+
+  SlabArena *arena_ = nullptr;
+};
+
+template<typename T>
+using SlabVector = std::vector<T, SlabAllocator<T>>;
+
+} // namespace htm
+#endif // HTM_UTIL_SLAB_ALLOCATOR_HPP
@@ -0,0 +1,114 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+#include "htm/utils/ThreadPool.hpp"
+#include "htm/utils/Log.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace htm;
+
+
+ThreadPool::ThreadPool(UInt numThreads) {
+  if( numThreads == 0u ) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(numThreads - 1u);
+  for(UInt i = 1u; i < numThreads; i++) {
+    workers_.emplace_back(&ThreadPool::workerLoop_, this);
+  }
+}
+
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeWorkers_.notify_all();
+  for(auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+
+void ThreadPool::runTasks_() {
+  const auto &fn = *job_;
+  for(size_t task = nextTask_++; task < numTasks_; task = nextTask_++) {
+    try {
+      fn(task);
+    } catch(...) {
+      lock_guard<mutex> lock(mutex_);
+      if( !error_ ) error_ = current_exception();
+    }
+  }
+}
+
+
+void ThreadPool::workerLoop_() {
+  UInt seen = 0u;
+  while( true ) {
+    {
+      unique_lock<mutex> lock(mutex_);
+      wakeWorkers_.wait(lock, [&]{ return stop_ or generation_ != seen; });
+      if( stop_ ) return;
+      seen = generation_;
+    }
+    runTasks_();
+    {
+      lock_guard<mutex> lock(mutex_);
+      activeWorkers_--;
+    }
+    jobDone_.notify_one();
+  }
+}
+
+
+void ThreadPool::parallelFor(size_t numTasks, const function<void(size_t)> &fn) {
+  if( numTasks == 0u ) return;
+
+  unique_lock<mutex> busy(busy_, try_to_lock);
+  if( workers_.empty() or numTasks == 1u or !busy.owns_lock() ) {
+    for(size_t task = 0u; task < numTasks; task++) {
+      fn(task);
+    }
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    job_      = &fn;
+    numTasks_ = numTasks;
+    nextTask_ = 0u;
+    error_    = nullptr;
+    activeWorkers_ = static_cast<UInt>(workers_.size());
+    generation_++;
+  }
+  wakeWorkers_.notify_all();
+
+  runTasks_();
+
+  exception_ptr error;
+  {
+    unique_lock<mutex> lock(mutex_);
+    jobDone_.wait(lock, [&]{ return activeWorkers_ == 0u; });
+    job_ = nullptr;
+    std::swap(error, error_);
+  }
+  if( error ) rethrow_exception(error);
+}
@@ -0,0 +1,116 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+/** @file
+ * Fixed size pool of worker threads used by the algorithms to split
+ * data-parallel loops across cores.
+ */
+
+#ifndef HTM_UTIL_THREAD_POOL_HPP
+#define HTM_UTIL_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <htm/types/Types.hpp>
+
+namespace htm {
+
+/**
+ * ThreadPool keeps (numThreads - 1) worker threads alive for the lifetime
+ * of the pool; the thread which calls parallelFor() is the remaining one and
+ * participates in the work.
+ *
+ * Only one parallelFor() runs on a pool at a time. If the pool is busy (ie.
+ * it is shared by several models, or parallelFor() is called from inside a
+ * task) the call does not block on the pool but runs all of its tasks in the
+ * calling thread instead. This makes sharing a pool deadlock free.
+ *
+ * Example Usage:
+ *    ThreadPool pool(4);
+ *    vector<UInt> partial(pool.numThreads(), 0u);
+ *    pool.parallelFor(partial.size(), [&](size_t task) {
+ *      const auto r = ThreadPool::split(data.size(), partial.size(), task);
+ *      for(size_t i = r.first; i < r.second; i++) partial[task] += data[i];
+ *    });
+ */
+class ThreadPool {
+public:
+  /**
+   * @param numThreads total number of threads used by parallelFor(),
+   *   including the calling thread. 0 means one per hardware thread.
+   *   A pool with 1 thread runs everything serially in the caller.
+   */
+  explicit ThreadPool(UInt numThreads = 0u);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @returns number of threads which work on a parallelFor(), including the
+   * calling thread.
+   */
+  UInt numThreads() const { return static_cast<UInt>(workers_.size()) + 1u; }
+
+  /**
+   * Calls fn(task) for every task in [0, numTasks) and returns once all of
+   * them have finished. Tasks are handed out dynamically, so any thread may
+   * run any task; per-task scratch space must be indexed by the task, not
+   * by the thread.
+   *
+   * If any task throws, the remaining tasks are still run and the first
+   * exception is rethrown in the calling thread.
+   */
+  void parallelFor(size_t numTasks, const std::function<void(size_t task)> &fn);
+
+  /**
+   * Splits [0, size) into numParts contiguous ranges of nearly equal length.
+   * @returns the half open range [first, second) of the given part.
+   */
+  static std::pair<size_t, size_t> split(size_t size, size_t numParts, size_t part) {
+    return { size * part / numParts, size * (part + 1u) / numParts };
+  }
+
+private:
+  void workerLoop_();
+  void runTasks_();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex busy_;  // held for the duration of one parallelFor()
+  std::mutex mutex_; // guards the job state below
+  std::condition_variable wakeWorkers_;
+  std::condition_variable jobDone_;
+
+  const std::function<void(size_t)> *job_ = nullptr;
+  size_t numTasks_ = 0u;
+  std::atomic<size_t> nextTask_{0u};
+  UInt generation_ = 0u;  // bumped for each job, wakes the workers
+  UInt activeWorkers_ = 0u;
+  std::exception_ptr error_;
+  bool stop_ = false;
+};
+
+} // namespace htm
+#endif // HTM_UTIL_THREAD_POOL_HPP
@@ -259,5 +259,88 @@ unordered_map<CellIdx, vector<CellIdx>> Neighborhood::updateAllNeighbors(
 }
 
 
+NeighborLists::NeighborLists(const UInt radius,
+                             const vector<UInt> &dimensions,
+                             const bool wrap,
+                             const bool skipCenter)
+    : radius_(radius), dimensions_(dimensions), wrap_(wrap), skipCenter_(skipCenter) {
+  NTA_CHECK(!dimensions_.empty());
+  strides_.resize(dimensions_.size());
+  size_ = 1u;
+  for(size_t i = dimensions_.size(); i-- > 0; ) {
+    strides_[i] = static_cast<UInt>(size_);
+    size_ *= dimensions_[i];
+  }
+  // With wrap every point has the same range of offsets in each dimension,
+  // as visited by Neighborhood::Iterator: -radius .. min(radius, dim-1-radius).
+  const Int r = static_cast<Int>(radius_);
+  for(const auto dim : dimensions_) {
+    wrapLast_.push_back(std::min(r, static_cast<Int>(dim) - 1 - r));
+  }
+}
+
+
+void NeighborLists::neighbors(const CellIdx center, vector<CellIdx> &neighbors) const {
+  NTA_ASSERT(center < size_);
+  neighbors.clear();
+  appendNeighbors_(center, 0u, 0u, neighbors);
+
+  // Neighborhood::Iterator yields the first point once more in place of a
+  // skipped center which was the last point; updateAllNeighbors() keeps it.
+  // The center is last when the last offset of every dimension lands on it.
+  if(not skipCenter_ or neighbors.empty()) return;
+  const Int r = static_cast<Int>(radius_);
+  UInt first = 0u;
+  for(size_t i = 0; i < dimensions_.size(); i++) {
+    const Int pos  = static_cast<Int>(position_(center, i));
+    const Int dim  = static_cast<Int>(dimensions_[i]);
+    const Int last = wrap_ ? (((pos + wrapLast_[i]) % dim) + dim) % dim : std::min(pos + r, dim - 1);
+    if(last != pos) return;
+    const Int coordinate = wrap_ ? (((pos - r) % dim) + dim) % dim : std::max(pos - r, Int(0));
+    first = first * dimensions_[i] + static_cast<UInt>(coordinate);
+  }
+  neighbors.insert(std::upper_bound(neighbors.begin(), neighbors.end(), first), first);
+}
+
+
+void NeighborLists::appendNeighbors_(const CellIdx center, const size_t dimension,
+                                     const UInt prefix, vector<CellIdx> &neighbors) const {
+  // The coordinates around the center in this dimension, in increasing
+  // order: one interval, or two when the range wraps past the edge. So the
+  // row major indices come out sorted.
+  const Int r   = static_cast<Int>(radius_);
+  const Int pos = static_cast<Int>(position_(center, dimension));
+  const Int dim = static_cast<Int>(dimensions_[dimension]);
+  Int lo[2], hi[2];
+  size_t numIntervals = 1u;
+  if(wrap_) {
+    const Int start = (((pos - r) % dim) + dim) % dim;
+    const Int count = r + wrapLast_[dimension] + 1;
+    if(start + count <= dim) {
+      lo[0] = start; hi[0] = start + count - 1;
+    } else {
+      lo[0] = 0;     hi[0] = start + count - 1 - dim;
+      lo[1] = start; hi[1] = dim - 1;
+      numIntervals = 2u;
+    }
+  } else {
+    lo[0] = std::max(pos - r, Int(0));
+    hi[0] = std::min(pos + r, dim - 1);
+  }
+
+  const bool innermost = dimension + 1u == dimensions_.size();
+  for(size_t k = 0u; k < numIntervals; k++) {
+    for(Int coordinate = lo[k]; coordinate <= hi[k]; coordinate++) {
+      const UInt index = prefix * dimensions_[dimension] + static_cast<UInt>(coordinate);
+      if(not innermost) {
+        appendNeighbors_(center, dimension + 1u, index, neighbors);
+      } else if(not (skipCenter_ and index == center)) {
+        neighbors.push_back(index);
+      }
+    }
+  }
+}
+
+
 Neighborhood::Iterator Neighborhood::begin() const { return {*this, false}; }
 Neighborhood::Iterator Neighborhood::end() const { return {*this, true}; }
@@ -241,6 +241,60 @@ private:
   const UInt center_; //the idx of self/center column
 };
 
+/**
+ * NeighborLists gives the same neighbor lists as
+ * Neighborhood::updateAllNeighbors(), but computes them on demand instead
+ * of storing a list for every point. It only keeps the radius and the
+ * dimensions, so it takes O(1) memory instead of O(points * neighbors) and
+ * changing the radius is free.
+ *
+ * The neighbors of a point are generated from the per dimension ranges of
+ * coordinates around it (truncated at the edges, or wrapped); with wrap all
+ * points share the same range of offsets, which is computed once. In each
+ * dimension the coordinates form at most two intervals, so the neighbors are
+ * produced already sorted, without sorting or allocating per call.
+ *
+ * Example Usage:
+ *    NeighborLists lists(radius, dimensions, true, true);
+ *    vector<CellIdx> hood;
+ *    for(CellIdx point = 0; point < lists.size(); point++) {
+ *      lists.neighbors(point, hood);
+ *      ...
+ *    }
+ */
+class NeighborLists {
+public:
+  NeighborLists() = default;
+  NeighborLists(const UInt radius,
+                const std::vector<UInt> &dimensions,
+                const bool wrap,
+                const bool skipCenter);
+
+  /**
+   * @param center point whose neighborhood is requested.
+   * @param neighbors output, is overwritten with the neighbors of the point,
+   *   sorted, exactly as the list updateAllNeighbors() stores for it.
+   */
+  void neighbors(const CellIdx center, std::vector<CellIdx> &neighbors) const;
+
+  /** Number of points in the topology. */
+  size_t size() const { return size_; }
+
+private:
+  void appendNeighbors_(const CellIdx center, const size_t dimension,
+                        const UInt prefix, std::vector<CellIdx> &neighbors) const;
+  UInt position_(const CellIdx point, const size_t dimension) const {
+    return (point / strides_[dimension]) % dimensions_[dimension];
+  }
+
+  UInt radius_ = 0u;
+  std::vector<UInt> dimensions_;
+  std::vector<UInt> strides_;  // row major
+  std::vector<Int>  wrapLast_; // last offset of each dimension, with wrap
+  bool wrap_ = false;
+  bool skipCenter_ = false;
+  size_t size_ = 0u;
+};
 
 } // end namespace htm
 
@@ -20,9 +20,12 @@
  */
 
 #include "gtest/gtest.h"
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <htm/algorithms/Connections.hpp>
+#include <htm/types/Snapshot.hpp>
 
 using namespace std;
 using namespace htm;
@@ -85,7 +88,7 @@ TEST(ConnectionsTest, testCreateSegment) {
   Segment segment2 = connections.createSegment(cell);
   ASSERT_EQ(cell, connections.cellForSegment(segment2));
 
-  vector<Segment> segments = connections.segmentsForCell(cell);
+  auto segments = connections.segmentsForCell(cell);
   ASSERT_EQ(segments.size(), 2ul);
 
   ASSERT_EQ(segment1, segments[0]);
@@ -107,7 +110,7 @@ TEST(ConnectionsTest, testCreateSynapse) {
   Synapse synapse2 = connections.createSynapse(segment, 150, 0.48f);
   ASSERT_EQ(segment, connections.segmentForSynapse(synapse2));
 
-  vector<Synapse> synapses = connections.synapsesForSegment(segment);
+  auto synapses = connections.synapsesForSegment(segment);
   ASSERT_EQ(synapses.size(), 2ul);
 
   ASSERT_EQ(synapse1, synapses[0]);
@@ -357,6 +360,251 @@ TEST(ConnectionsTest, testComputeActivity) {
   ASSERT_EQ(3ul, numActivePotentialSynapsesForSegment[segment2_1]);
 }
 
+TEST(ConnectionsTest, testPresynapticIndexFromListsMismatch) {
+  // A synapse list without its segment list is rejected with an htm::Exception.
+  PresynapticIndex index;
+  PresynapticIndex::Lists<Synapse> synapses;
+  PresynapticIndex::Lists<Segment> segments;
+  synapses[3] = {0u, 1u};
+  EXPECT_THROW(index.fromLists(synapses, segments), htm::Exception);
+  segments[3] = {0u};
+  EXPECT_THROW(index.fromLists(synapses, segments), htm::Exception);
+  segments[3] = {0u, 1u};
+  index.fromLists(synapses, segments);
+  ASSERT_EQ(index.size(3), 2u);
+}
+
+/**
+ * Grows, moves and shrinks the presynaptic lists many times (so that the
+ * presynaptic index has to relocate and compact its buckets) and checks
+ * computeActivity against a brute force count over all synapses.
+ */
+TEST(ConnectionsTest, testComputeActivityPresynapticIndexChurn) {
+  Connections connections(64);
+  Random rng(42);
+  vector<Segment> segments;
+  for(CellIdx cell = 0; cell < 64; cell++) {
+    segments.push_back(connections.createSegment(cell));
+  }
+
+  SDR input({ 200u });
+  for(int step = 0; step < 50; step++) {
+    for(const auto seg : segments) {
+      for(int i = 0; i < 5; i++) {
+        const CellIdx presyn = rng.getUInt32(200u);
+        connections.createSynapse(seg, presyn, rng.getReal64() > 0.5 ? 0.75f : 0.25f);
+      }
+      const auto &synapses = connections.synapsesForSegment(seg);
+      if(synapses.size() > 10u) {
+        connections.destroySynapse(synapses[rng.getUInt32((UInt32)synapses.size())]);
+      }
+      input.randomize(0.1f, rng);
+      connections.adaptSegment(seg, input, 0.3f, 0.3f);
+    }
+
+    input.randomize(0.2f, rng);
+    vector<SynapseIdx> numActivePotential(connections.segmentFlatListLength(), 0);
+    const auto numActiveConnected = connections.computeActivity(numActivePotential, input.getSparse());
+
+    const auto &dense = input.getDense();
+    for(const auto seg : segments) {
+      SynapseIdx connected = 0, potential = 0;
+      for(const auto syn : connections.synapsesForSegment(seg)) {
+        const auto &synData = connections.dataForSynapse(syn);
+        if(dense[synData.presynapticCell]) {
+          potential++;
+          if(synData.permanence >= connections.getConnectedThreshold()) connected++;
+        }
+      }
+      ASSERT_EQ(connected, numActiveConnected[seg]);
+      ASSERT_EQ(potential, numActivePotential[seg]);
+    }
+  }
+
+  for(const auto seg : segments) {
+    for(const auto syn : connections.synapsesForSegment(seg)) {
+      const auto &onPresyn = connections.synapsesForPresynapticCell(connections.dataForSynapse(syn).presynapticCell);
+      ASSERT_NE(std::find(onPresyn.begin(), onPresyn.end(), syn), onPresyn.end());
+    }
+  }
+}
+
+TEST(ConnectionsTest, testComputeActivityParallel) {
+  Connections serial(100);
+  Random rng(7);
+  for(CellIdx cell = 0; cell < 100; cell++) {
+    const Segment seg = serial.createSegment(cell);
+    for(int i = 0; i < 200; i++) {
+      serial.createSynapse(seg, rng.getUInt32(1000u), (Permanence)rng.getReal64());
+    }
+  }
+  Connections parallel = serial;
+  parallel.setThreadPool(std::make_shared<ThreadPool>(4));
+
+  SDR input({ 1000u });
+  for(const Real sparsity : {0.01f, 0.5f, 0.9f}) { //small input stays serial, large goes parallel
+    input.randomize(sparsity, rng);
+    vector<SynapseIdx> potentialSerial(serial.segmentFlatListLength(), 0);
+    vector<SynapseIdx> potentialParallel(parallel.segmentFlatListLength(), 0);
+    const auto connectedSerial   = serial.computeActivity(potentialSerial, input.getSparse());
+    const auto connectedParallel = parallel.computeActivity(potentialParallel, input.getSparse());
+    ASSERT_EQ(connectedSerial, connectedParallel);
+    ASSERT_EQ(potentialSerial, potentialParallel);
+  }
+  ASSERT_EQ(serial, parallel);
+}
+
+TEST(ConnectionsTest, testComputeActivitySparse) {
+  Connections dense(1000);
+  Random rng(11);
+  for(int i = 0; i < 300; i++) {
+    const Segment seg = dense.createSegment(rng.getUInt32(1000u));
+    for(int k = 0; k < 20; k++) {
+      dense.createSynapse(seg, rng.getUInt32(1000u), (Permanence)rng.getReal64());
+    }
+  }
+  Connections sparse = dense;
+  Connections parallel = dense;
+  parallel.setThreadPool(std::make_shared<ThreadPool>(4));
+
+  vector<SynapseIdx> connectedSparse, potentialSparse, connectedParallel, potentialParallel;
+  vector<Segment> touchedSparse, touchedParallel;
+  SDR input({ 1000u });
+  for(const Real sparsity : {0.02f, 0.1f, 0.9f, 0.0f, 0.05f}) { //reuses the counts of the previous call
+    input.randomize(sparsity, rng);
+    vector<SynapseIdx> potential(dense.segmentFlatListLength(), 0);
+    const auto connected = dense.computeActivity(potential, input.getSparse());
+    sparse.computeActivitySparse(connectedSparse, potentialSparse, touchedSparse, input.getSparse());
+    parallel.computeActivitySparse(connectedParallel, potentialParallel, touchedParallel, input.getSparse());
+    ASSERT_EQ(connected, connectedSparse);
+    ASSERT_EQ(potential, potentialSparse);
+    ASSERT_EQ(connected, connectedParallel);
+    ASSERT_EQ(potential, potentialParallel);
+
+    vector<Segment> touched;
+    for(Segment seg = 0; seg < potential.size(); seg++) {
+      if(potential[seg] > 0) touched.push_back(seg);
+    }
+    std::sort(touchedSparse.begin(), touchedSparse.end());
+    std::sort(touchedParallel.begin(), touchedParallel.end());
+    ASSERT_EQ(touched, touchedSparse);
+    ASSERT_EQ(touched, touchedParallel);
+  }
+  ASSERT_EQ(dense, sparse);
+}
+
+TEST(ConnectionsTest, testSortSegments) {
+  Connections con(5000);
+  Random rng(3);
+  vector<Segment> segments;
+  for(int i = 0; i < 2000; i++) {
+    segments.push_back(con.createSegment(rng.getUInt32(5000u)));
+  }
+  for(const size_t size : {0u, 1u, 10u, 63u, 64u, 2000u}) { //below and above the radix cut-off
+    vector<Segment> list(segments.begin(), segments.begin() + size);
+    rng.shuffle(list.begin(), list.end());
+    vector<Segment> expected = list;
+    std::sort(expected.begin(), expected.end(),
+              [&](const Segment a, const Segment b) { return con.compareSegments(a, b); });
+    con.sortSegments(list);
+    ASSERT_EQ(expected, list) << "size " << size;
+  }
+}
+
+TEST(ConnectionsTest, testArenaStorage) {
+  Connections heap(500);
+  Connections arena(500);
+  arena.setArenaStorage(true);
+  ASSERT_TRUE(arena.getArenaStorage());
+  ASSERT_NE(arena.getArena(), nullptr);
+  ASSERT_FALSE(heap.getArenaStorage());
+
+  // Grow and destroy segments and synapses, the same way on both.
+  Random rng(5);
+  for(int step = 0; step < 3000; step++) {
+    const CellIdx cell = rng.getUInt32(500u);
+    const UInt32 action = rng.getUInt32(10u);
+    if(action == 0u and heap.numSegments(cell) > 0u) {
+      const Segment seg = heap.segmentsForCell(cell)[0];
+      heap.destroySegment(seg);
+      arena.destroySegment(seg);
+    }
+    else if(action < 3u or heap.numSegments(cell) == 0u) {
+      ASSERT_EQ(heap.createSegment(cell, 8), arena.createSegment(cell, 8));
+    }
+    else {
+      const Segment seg = heap.segmentsForCell(cell).back();
+      for(int i = 0; i < 10; i++) {
+        const CellIdx presyn = rng.getUInt32(500u);
+        const Permanence perm = (Permanence)rng.getReal64();
+        ASSERT_EQ(heap.createSynapse(seg, presyn, perm), arena.createSynapse(seg, presyn, perm));
+      }
+      if(heap.numSynapses(seg) > 4u) {
+        const Synapse syn = heap.synapsesForSegment(seg)[1];
+        heap.destroySynapse(syn);
+        arena.destroySynapse(syn);
+      }
+    }
+  }
+  ASSERT_EQ(heap, arena);
+  ASSERT_GT(arena.getArena()->bytesInUse(), 0u);
+  for(CellIdx cell = 0; cell < 500; cell++) {
+    for(const auto seg : arena.segmentsForCell(cell)) {
+      ASSERT_EQ(arena.dataForSegment(seg).permanences.get_allocator().arena(), arena.getArena());
+    }
+  }
+
+  // Compaction moves everything into a new arena without any free blocks.
+  const auto before = arena;
+  const SlabArena *old = arena.getArena();
+  arena.compact();
+  ASSERT_NE(arena.getArena(), old);
+  ASSERT_EQ(arena.getArena()->bytesFree(), 0u);
+  ASSERT_EQ(before, arena);
+  heap.compact();
+  ASSERT_EQ(heap, arena);
+  const SlabArena *old2 = arena.getArena();
+
+  // Copy assignment takes over the arena of the source, for every list.
+  Connections assigned(10);
+  assigned = arena;
+  ASSERT_EQ(assigned.getArena(), arena.getArena());
+  for(CellIdx cell = 0; cell < 500; cell++) {
+    for(const auto seg : assigned.segmentsForCell(cell)) {
+      ASSERT_EQ(assigned.dataForSegment(seg).permanences.get_allocator().arena(), arena.getArena());
+    }
+  }
+  ASSERT_EQ(assigned, arena);
+
+  SDR input({500u});
+  input.randomize(0.2f, rng);
+  vector<SynapseIdx> potentialHeap(heap.segmentFlatListLength(), 0);
+  vector<SynapseIdx> potentialArena(arena.segmentFlatListLength(), 0);
+  ASSERT_EQ(heap.computeActivity(potentialHeap, input.getSparse()),
+            arena.computeActivity(potentialArena, input.getSparse()));
+  ASSERT_EQ(potentialHeap, potentialArena);
+  ASSERT_EQ(arena.getArena(), old2) << "computeActivity must not compact";
+  for(const auto seg : {0u, 1u, 2u}) {
+    heap.adaptSegment(seg, input, 0.1f, 0.05f, true);
+    arena.adaptSegment(seg, input, 0.1f, 0.05f, true);
+  }
+  ASSERT_EQ(heap, arena);
+
+  // Back to the heap.
+  arena.setArenaStorage(false);
+  ASSERT_EQ(arena.getArena(), nullptr);
+  ASSERT_EQ(heap, arena);
+
+  // The mode survives loading.
+  stringstream ss;
+  heap.save(ss);
+  Connections loaded;
+  loaded.setArenaStorage(true);
+  loaded.load(ss);
+  ASSERT_TRUE(loaded.getArenaStorage());
+  ASSERT_EQ(heap, loaded);
+}
+
 TEST(ConnectionsTest, testAdaptSynapses) {
   UInt numCells = 4;
   // NOTE: One segment per cell.
@@ -802,6 +1050,176 @@ TEST(ConnectionsTest, testSaveLoad) {
   ASSERT_EQ(c1, c2);
 }
 
+TEST(ConnectionsTest, testSnapshot) {
+  const char *filename = "ConnectionsSnapshot.tmp";
+  Connections c1(1024), c2;
+  setupSampleConnections(c1);
+
+  auto segment = c1.createSegment(10);
+  c1.createSynapse(segment, 400, 0.5);
+  c1.destroySegment(segment);
+  computeSampleActivity(c1);
+
+  c1.saveSnapshot(filename);
+  c2.loadSnapshot(filename);
+  ASSERT_EQ(c1, c2);
+
+  // Both continue identically.
+  computeSampleActivity(c1);
+  computeSampleActivity(c2);
+  ASSERT_EQ(c1, c2);
+
+  // A snapshot can also be read from a stream.
+  SnapshotWriter writer("Test");
+  c1.saveSnapshot(writer, "c.");
+  stringstream ss;
+  writer.save(ss);
+  SnapshotReader reader(ss);
+  Connections c3;
+  c3.loadSnapshot(reader, "c.");
+  ASSERT_EQ(c1, c3);
+
+  // Files of the wrong kind or format are rejected.
+  writer.saveFile(filename);
+  EXPECT_ANY_THROW(c3.loadSnapshot(filename));
+  c1.save(ss);
+  { ofstream out(filename, ios::binary); out << ss.rdbuf(); }
+  EXPECT_ANY_THROW(c3.loadSnapshot(filename));
+
+  int ret = ::remove(filename);
+  ASSERT_TRUE(ret == 0) << "Failed to delete " << filename;
+}
+
+TEST(ConnectionsTest, testSnapshotCorrupt) {
+  // Synapse records pointing outside of the segments or the presynaptic maps
+  // are rejected. A record is {presynapticCell, permanence, segment,
+  // presynapticMapIndex}, 4 bytes each.
+  Connections c1(1024);
+  setupSampleConnections(c1);
+  ASSERT_EQ(c1.dataForSynapse(0).segment, 0u);
+  SnapshotWriter writer("Test");
+  c1.saveSnapshot(writer, "");
+  stringstream ss;
+  writer.save(ss);
+  const string data = ss.str();
+
+  SnapshotHeader header;
+  std::memcpy(&header, data.data(), sizeof header);
+  const auto findSection = [&](const string &name) {
+    SnapshotSection section;
+    for(UInt64 i = 0u; i < header.numSections; i++) {
+      std::memcpy(&section, data.data() + sizeof header + i * sizeof section, sizeof section);
+      if(string(section.name) == name) return section;
+    }
+    return SnapshotSection();
+  };
+  const auto expectRejected = [](const string &corrupt, const string &what) {
+    stringstream in(corrupt);
+    SnapshotReader reader(in);
+    Connections c2;
+    EXPECT_ANY_THROW(c2.loadSnapshot(reader, "")) << what;
+  };
+  const UInt64 synapsesOffset = findSection("synapses").offset;
+  ASSERT_NE(synapsesOffset, 0u);
+
+  for(const size_t field : {2u, 3u}) { //segment, presynapticMapIndex
+    string corrupt = data;
+    const UInt32 bad = 0xFFFFFFFFu;
+    std::memcpy(&corrupt[synapsesOffset + field * sizeof(UInt32)], &bad, sizeof bad);
+    expectRejected(corrupt, "synapse field " + to_string(field));
+  }
+
+  // The segment pool of the presynaptic maps, and the bucket offsets, which
+  // computeActivity() uses as indices without any checks. A bucket is
+  // {offset (8 bytes), size, capacity}; a huge offset overflows offset + capacity.
+  const SnapshotSection pool = findSection("potential.segments");
+  ASSERT_GT(pool.count, 0u);
+  string corrupt = data;
+  for(UInt64 i = 0u; i < pool.count; i++) {
+    const Segment bad = 0xFFFFFFFFu;
+    std::memcpy(&corrupt[pool.offset + i * pool.elementSize], &bad, sizeof bad);
+  }
+  expectRejected(corrupt, "presynaptic segments");
+
+  const SnapshotSection buckets = findSection("potential.buckets");
+  ASSERT_GT(buckets.count, 0u);
+  corrupt = data;
+  for(UInt64 i = 0u; i < buckets.count; i++) {
+    const UInt64 bad = ~UInt64(0u);
+    std::memcpy(&corrupt[buckets.offset + i * buckets.elementSize], &bad, sizeof bad);
+  }
+  expectRejected(corrupt, "bucket offsets");
+
+  // A header claiming a huge file must not allocate before reading.
+  corrupt = data;
+  const UInt64 huge = UInt64(1u) << 60u;
+  std::memcpy(&corrupt[offsetof(SnapshotHeader, fileSize)], &huge, sizeof huge);
+  stringstream hugeIn(corrupt);
+  EXPECT_ANY_THROW(SnapshotReader reader(hugeIn));
+  stringstream in(data);
+  SnapshotReader reader(in);
+  Connections c3;
+  c3.loadSnapshot(reader, "");
+  ASSERT_EQ(c1, c3);
+}
+
+/**
+ * The per-segment presynapticCells/permanences arrays must mirror the
+ * SynapseData after every kind of update.
+ */
+static void checkSegmentArrays(const Connections &c, const vector<Segment> &segments) {
+  for(const auto seg : segments) {
+    const auto &segData = c.dataForSegment(seg);
+    ASSERT_EQ(segData.synapses.size(), segData.presynapticCells.size());
+    ASSERT_EQ(segData.synapses.size(), segData.permanences.size());
+    SynapseIdx connected = 0;
+    for(size_t i = 0; i < segData.synapses.size(); i++) {
+      const auto &synData = c.dataForSynapse(segData.synapses[i]);
+      ASSERT_EQ(synData.presynapticCell, segData.presynapticCells[i]);
+      ASSERT_EQ(synData.permanence,      segData.permanences[i]);
+      if(synData.permanence >= c.getConnectedThreshold()) connected++;
+    }
+    ASSERT_EQ(connected, segData.numConnected);
+  }
+}
+
+TEST(ConnectionsTest, testSegmentArrays) {
+  Connections c(20, 0.5f);
+  Random rng(3);
+  vector<Segment> segments;
+  for(CellIdx cell = 0; cell < 20; cell++) {
+    segments.push_back(c.createSegment(cell));
+    for(int i = 0; i < 37; i++) { //not a multiple of the SIMD width
+      c.createSynapse(segments.back(), rng.getUInt32(100u), (Permanence)rng.getReal64());
+    }
+  }
+  checkSegmentArrays(c, segments);
+
+  SDR input({ 100u });
+  for(int step = 0; step < 10; step++) {
+    for(const auto seg : segments) {
+      input.randomize(0.3f, rng);
+      c.adaptSegment(seg, input, 0.1f, 0.05f, /*prune*/ step % 2 == 0);
+    }
+    checkSegmentArrays(c, segments);
+    c.bumpSegment(segments[step], -0.2f);
+    c.raisePermanencesToThreshold(segments[step + 1], 10u);
+    checkSegmentArrays(c, segments);
+  }
+
+  Connections loaded;
+  {
+    stringstream ss;
+    c.save(ss);
+    loaded.load(ss);
+  }
+  ASSERT_EQ(c, loaded);
+  checkSegmentArrays(loaded, segments);
+  for(const auto seg : segments) {
+    ASSERT_EQ(c.dataForSegment(seg).permanences, loaded.dataForSegment(seg).permanences);
+  }
+}
+
 TEST(ConnectionsTest, testCreateSegmentOverflow) {
     const auto LIMIT = std::numeric_limits<Segment>::max();
     if(LIMIT <= 256) { //connections::Segment is too large (likely uint32), so this test would run, but memory 
@@ -1195,6 +1195,37 @@ TEST(SpatialPoolerTest, testInhibitColumnsGlobal) {
 }
 
 
+TEST(SpatialPoolerTest, testInhibitColumnsGlobalSparse) {
+  // Compare against selecting from all of the columns, on sparse overlaps
+  // with many ties and both with and without a stimulusThreshold.
+  const UInt numColumns = 2000;
+  SpatialPooler sp;
+  setup(sp, 100, numColumns);
+  Random rng(11);
+
+  for(const UInt threshold : {0u, 2u}) {
+    sp.setStimulusThreshold(threshold);
+    for(const Real fraction : {0.001f, 0.01f, 0.3f}) { //fewer and more nonzero columns than desired
+      vector<Real> overlaps(numColumns, 0.0f);
+      for(auto &o : overlaps) {
+        if(rng.getReal64() < fraction) o = static_cast<Real>(rng.getUInt32(5u) + 1u);
+      }
+      const Real density = 0.02f;
+      const UInt numDesired = static_cast<UInt>(density * numColumns);
+
+      vector<CellIdx> expected(numColumns);
+      std::iota(expected.begin(), expected.end(), 0u);
+      std::sort(expected.begin(), expected.end(), [&](const UInt a, const UInt b) {
+        return (overlaps[a] == overlaps[b]) ? (a > b) : (overlaps[a] > overlaps[b]); });
+      expected.resize(numDesired);
+      while(!expected.empty() && overlaps[expected.back()] < threshold) expected.pop_back();
+
+      ASSERT_EQ(expected, sp.inhibitColumnsGlobal_(overlaps, density));
+    }
+  }
+}
+
+
 TEST(SpatialPoolerTest, testValidateGlobalInhibitionParameters) {
   // With 10 columns the minimum sparsity for global inhibition is 10%
   // Setting sparsity to 2% should throw an exception
@@ -1360,6 +1391,31 @@ TEST(SpatialPoolerTest, testInhibitColumnsLocal) {
   }
 }
 
+
+TEST(SpatialPoolerTest, testInhibitColumnsLocalBox) {
+  // The box algorithm for 1D/2D topologies must select exactly the same
+  // columns as the neighbor walk, including the tie-breaking.
+  Random rng(5);
+  for(const auto &dims : vector<vector<UInt>>{ {37}, {9, 13} }) {
+    for(const bool wrap : {false, true}) {
+      SpatialPooler sp(dims, dims, /*potentialRadius*/ 4, /*potentialPct*/ 0.5f,
+                       /*globalInhibition*/ false, /*localAreaDensity*/ 0.1f,
+                       /*numActiveColumnsPerInhArea*/ 0, /*stimulusThreshold*/ 1,
+                       0.008f, 0.05f, 0.1f, 0.001f, 1000, 10.0f, /*seed*/ 1, 0, wrap);
+      for(const UInt radius : {1u, 3u, 7u, 20u}) {
+        sp.setInhibitionRadius(radius);
+        for(const Real density : {0.1f, 0.3f}) {
+          vector<Real> overlaps(sp.getNumColumns());
+          for(auto &o : overlaps) o = static_cast<Real>(rng.getUInt32(4u)); //many ties
+          ASSERT_EQ(sp.inhibitColumnsLocal_(overlaps, density),
+                    sp.inhibitColumnsLocalBox_(overlaps, density))
+            << "dims " << dims.size() << "D, wrap " << wrap << ", radius " << radius;
+        }
+      }
+    }
+  }
+}
+
 TEST(SpatialPoolerTest, testIsUpdateRound) {
   SpatialPooler sp;
   sp.setUpdatePeriod(50);
@@ -1831,6 +1887,47 @@ TEST(SpatialPoolerTest, ZeroOverlap_StimulusThreshold_LocalInhibition) {
 }
 
 
+TEST(SpatialPoolerTest, testComputeBatch) {
+  for(const bool global : {true, false}) {
+    SpatialPooler sp({100}, {200}, /*potentialRadius*/ 20, 0.5f, global, 0.1f, 0,
+                     /*stimulusThreshold*/ 1, 0.01f, 0.1f, 0.1f, 0.001f, 1000, /*boost*/ 1.0f);
+    SDR input({100});
+    SDR active({200});
+    Random rng(17);
+    for(int i = 0; i < 20; i++) { //learn a little, so boosting and permanences are not uniform
+      input.randomize(0.1f, rng);
+      sp.compute(input, true, active);
+    }
+
+    vector<SDR> inputs(37, SDR({100}));
+    for(auto &in : inputs) in.randomize(0.1f, rng);
+
+    const UInt iteration = sp.getIterationNum();
+    vector<Real> dutyBefore(200), dutyAfter(200);
+    sp.getActiveDutyCycles(dutyBefore.data());
+    vector<SDR> batch;
+    sp.setThreadPool(std::make_shared<ThreadPool>(4));
+    sp.computeBatch(inputs, batch);
+    sp.setThreadPool(nullptr);
+    ASSERT_EQ(inputs.size(), batch.size());
+    ASSERT_EQ(iteration + inputs.size(), sp.getIterationNum());
+    sp.getActiveDutyCycles(dutyAfter.data());
+    ASSERT_EQ(dutyBefore, dutyAfter) << "inference does not update the duty cycles";
+    const vector<Real> boostedAfterBatch = sp.getBoostedOverlaps();
+
+    for(size_t i = 0; i < inputs.size(); i++) {
+      sp.compute(inputs[i], false, active);
+      ASSERT_EQ(active, batch[i]) << "sample " << i;
+    }
+    ASSERT_EQ(sp.getBoostedOverlaps(), boostedAfterBatch);
+
+    vector<SDR> serial;
+    sp.computeBatch(inputs, serial);
+    ASSERT_EQ(batch, serial);
+  }
+}
+
+
 TEST(SpatialPoolerTest, testSaveLoad) {
   const char *filename = "SpatialPoolerSerialization.tmp";
   SpatialPooler sp1, sp2;
@@ -1940,6 +2037,34 @@ TEST(SpatialPoolerTest, testSaveLoad_ar) {
 }
 
 
+TEST(SpatialPoolerTest, testSnapshot) {
+  const char *filename = "SpatialPoolerSnapshot.tmp";
+  SpatialPooler sp1({ 100 }, { 200 });
+  SpatialPooler sp2;
+  SDR input({ 100 });
+  SDR out1({ 200 });
+  SDR out2({ 200 });
+  Random rng(7);
+  for(UInt i = 0; i < 20; i++) {
+    input.randomize(0.1f, rng);
+    sp1.compute(input, true, out1);
+  }
+
+  sp1.saveSnapshot(filename);
+  sp2.loadSnapshot(filename);
+  int ret = ::remove(filename);
+  ASSERT_TRUE(ret == 0) << "Failed to delete " << filename;
+  check_spatial_eq(sp1, sp2);
+
+  for(UInt i = 0; i < 5; i++) {
+    input.randomize(0.1f, rng);
+    sp1.compute(input, true, out1);
+    sp2.compute(input, true, out2);
+    ASSERT_EQ(out1, out2);
+  }
+}
+
+
 
 TEST(SpatialPoolerTest, testSerialization_ar) {
   Random random(10);
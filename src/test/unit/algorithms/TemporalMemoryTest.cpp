@@ -1536,6 +1536,33 @@ TEST(TemporalMemoryTest, testSaveLoad) {
   serializationTestVerify(tm2);
 }
 
+TEST(TemporalMemoryTest, testSnapshot) {
+  const char *filename = "TemporalMemorySnapshot.tmp";
+  TemporalMemory tm1(
+      /*columnDimensions*/ {32},
+      /*cellsPerColumn*/ 4,
+      /*activationThreshold*/ 3,
+      /*initialPermanence*/ 0.21f,
+      /*connectedPermanence*/ 0.50f,
+      /*minThreshold*/ 2,
+      /*maxNewSynapseCount*/ 3,
+      /*permanenceIncrement*/ 0.10f,
+      /*permanenceDecrement*/ 0.10f,
+      /*predictedSegmentDecrement*/ 0.0f,
+      /*seed*/ 42);
+
+  serializationTestPrepare(tm1);
+
+  tm1.saveSnapshot(filename);
+  TemporalMemory tm2;
+  tm2.loadSnapshot(filename);
+  int ret = ::remove(filename);
+  ASSERT_TRUE(ret == 0) << "Failed to delete " << filename;
+
+  ASSERT_TRUE(tm1 == tm2);
+  serializationTestVerify(tm2);
+}
+
 TEST(TemporalMemoryTest, testSaveArLoadAr) {
   TemporalMemory tm1(
       /*columnDimensions*/ {32},
@@ -1660,6 +1687,62 @@ TEST(TemporalMemoryTest, testEquals) {
   ASSERT_EQ(tm, tmCopy);
 }
 
+/**
+ * The parallel mode of activateCells() learns a sequence like the serial
+ * mode does, and its results do not depend on the number of threads.
+ */
+TEST(TemporalMemoryTest, testActivateCellsParallel) {
+  SDR columns({200});
+  vector<SDR> pattern( 10, columns.dimensions );
+  for(auto i = 0u; i < pattern.size(); i++) {
+    Random rng( i + 99u );
+    pattern[i].randomize( 0.10f, rng );
+  }
+
+  const auto makeTM = [&](shared_ptr<ThreadPool> pool) {
+    TemporalMemory tm(columns.dimensions,
+      /* cellsPerColumn */               8,
+      /* activationThreshold */          13,
+      /* initialPermanence */            0.21f,
+      /* connectedPermanence */          0.50f,
+      /* minThreshold */                 10,
+      /* maxNewSynapseCount */           20,
+      /* permanenceIncrement */          0.10f,
+      /* permanenceDecrement */          0.03f,
+      /* predictedSegmentDecrement */    0.01f,
+      /* seed */                         42);
+    tm.setThreadPool(pool);
+    return tm;
+  };
+  auto tm1 = makeTM(make_shared<ThreadPool>(1u));
+  auto tm4 = makeTM(make_shared<ThreadPool>(4u));
+  ASSERT_EQ(tm4.getThreadPool()->numThreads(), 4u);
+  ASSERT_EQ(tm4.connections.getThreadPool(), tm4.getThreadPool());
+
+  for(UInt trial = 0; trial < 20; trial++) {
+    tm1.reset();
+    tm4.reset();
+    for(size_t i = 0; i < pattern.size(); i++) {
+      tm1.compute(pattern[i], true);
+      tm4.compute(pattern[i], true);
+      ASSERT_EQ(tm1.getActiveCells(), tm4.getActiveCells());
+      ASSERT_EQ(tm1.getWinnerCells(), tm4.getWinnerCells());
+      if( trial >= 19 and i > 0 ) {
+        ASSERT_LT( tm4.anomaly, 0.05f ) << "step " << i;
+      }
+    }
+  }
+  EXPECT_EQ(tm1.connections, tm4.connections);
+
+  // Without learning the connections never change.
+  const Connections before = tm4.connections;
+  tm4.reset();
+  for(const auto &x : pattern) {
+    tm4.compute(x, false);
+  }
+  EXPECT_EQ(before, tm4.connections);
+}
+
 TEST(TemporalMemoryTest, testIncorrectDefaultConstructor) {
   TemporalMemory tmFail; //default empty constructor is only used for deserialization
   SDR data1({0});
@@ -242,6 +242,67 @@ TEST(LinkTest, DelayedLink) {
 
 
 
+TEST(LinkTest, DelayedSDRLink) {
+  // A delayed link between SDR buffers recycles the slots of its ring buffer.
+  Network net;
+  std::shared_ptr<Region> encoder = net.addRegion("encoder", "RDSEEncoderRegion", "{size: 1000, sparsity: 0.05, radius: 1, seed: 42}");
+  std::shared_ptr<Region> sp = net.addRegion("sp", "SPRegion", "{columnCount: 100, learningMode: 0}");
+  net.link("encoder", "sp", "", "", "encoded", "bottomUpIn", 3);
+  net.initialize();
+
+  std::vector<SDR> sent;
+  for (UInt i = 0; i < 10; i++) {
+    encoder->setParameterReal64("sensedValue", static_cast<Real64>(i * 5));
+    net.run(1);
+    sent.push_back(encoder->getOutputData("encoded").getSDR());
+
+    const Array &in = sp->getInputData("bottomUpIn");
+    ASSERT_EQ(in.getType(), NTA_BasicType_SDR);
+    if (i < 3) {
+      ASSERT_EQ(in.getSDR().getSum(), 0u) << "initial delayed values are all 0's";
+    } else {
+      ASSERT_EQ(in.getSDR(), sent[i - 3]) << "iteration " << i;
+    }
+  }
+}
+
+
+
+TEST(LinkTest, SparseFanIn) {
+  // Two SDR outputs, one of them delayed, concatenated into one SDR input.
+  Network net;
+  std::shared_ptr<Region> enc1 = net.addRegion("enc1", "RDSEEncoderRegion", "{size: 1000, sparsity: 0.05, radius: 1, seed: 42}");
+  std::shared_ptr<Region> enc2 = net.addRegion("enc2", "RDSEEncoderRegion", "{size: 1000, sparsity: 0.02, radius: 1, seed: 43}");
+  std::shared_ptr<Region> sp = net.addRegion("sp", "SPRegion", "{columnCount: 100, learningMode: 0}");
+  net.link("enc1", "sp", "", "", "encoded", "bottomUpIn");
+  net.link("enc2", "sp", "", "", "encoded", "bottomUpIn", 1);
+  net.initialize();
+
+  SDR previous2({1000u});
+  for (UInt i = 0; i < 5; i++) {
+    enc1->setParameterReal64("sensedValue", static_cast<Real64>(i * 7));
+    enc2->setParameterReal64("sensedValue", static_cast<Real64>(i * 3));
+    net.run(1);
+
+    const SDR &in = sp->getInputData("bottomUpIn").getSDR();
+    ASSERT_EQ(in.size, 2000u);
+    SDR_sparse_t expected = enc1->getOutputData("encoded").getSDR().getSparse();
+    for (const UInt idx : previous2.getSparse())
+      expected.push_back(idx + 1000u);
+    ASSERT_EQ(in.getSparse(), expected) << "iteration " << i;
+
+    // The dense form agrees with the sparse form.
+    SDR dense({2000u});
+    const SDR_dense_t &inDense = in.getDense();
+    dense.setDense(inDense);  // copies, does not swap.
+    ASSERT_EQ(dense.getSparse(), expected);
+
+    previous2 = enc2->getOutputData("encoded").getSDR();
+  }
+}
+
+
+
 TEST(LinkTest, DelayedLinkSerialization) {
   // serialization test of delayed link.
 
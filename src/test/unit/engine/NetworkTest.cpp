@@ -785,4 +785,167 @@ TEST(NetworkTest, Configure) {
 
 
 
+TEST(NetworkTest, ParallelRun) {
+  // Several encoder -> SP -> TM chains, with delayed links between the SPs of
+  // neighbouring chains. Running on a thread pool must give exactly the same
+  // results as running serially.
+  const UInt numChains = 4u;
+  auto build = [&](Network &net) {
+    for (UInt i = 0u; i < numChains; i++) {
+      const std::string n = std::to_string(i);
+      net.addRegion("encoder" + n, "RDSEEncoderRegion", "{size: 1000, sparsity: 0.05, radius: 0.5, seed: " + std::to_string(42 + i) + "}");
+      net.addRegion("sp" + n, "SPRegion", "{columnCount: 256, globalInhibition: true}");
+      net.addRegion("tm" + n, "TMRegion", "{cellsPerColumn: 4, orColumnOutputs: true}");
+      net.link("encoder" + n, "sp" + n, "", "", "encoded", "bottomUpIn");
+      net.link("sp" + n, "tm" + n, "", "", "bottomUpOut", "bottomUpIn");
+    }
+    for (UInt i = 0u; i < numChains; i++) {
+      net.link("sp" + std::to_string(i), "sp" + std::to_string((i + 1u) % numChains),
+               "", "", "bottomUpOut", "bottomUpIn", 1);
+    }
+    net.initialize();
+  };
+
+  Network serial;
+  build(serial);
+  Network parallel;
+  build(parallel);
+  parallel.setThreadPool(std::make_shared<ThreadPool>(4u));
+  ASSERT_NE(parallel.getThreadPool(), nullptr);
+
+  for (UInt iter = 0u; iter < 20u; iter++) {
+    for (UInt i = 0u; i < numChains; i++) {
+      const Real64 value = static_cast<Real64>((iter * (i + 1u)) % 10u);
+      serial.getRegion("encoder" + std::to_string(i))->setParameterReal64("sensedValue", value);
+      parallel.getRegion("encoder" + std::to_string(i))->setParameterReal64("sensedValue", value);
+    }
+    serial.run(1);
+    parallel.run(1);
+    for (UInt i = 0u; i < numChains; i++) {
+      const std::string tm = "tm" + std::to_string(i);
+      ASSERT_EQ(serial.getRegion(tm)->getOutputData("bottomUpOut").getSDR(),
+                parallel.getRegion(tm)->getOutputData("bottomUpOut").getSDR())
+          << "iteration " << iter << ", " << tm;
+    }
+  }
+}
+
+
+TEST(NetworkTest, PipelinedRun) {
+  // Encoder -> SP -> TM chains fed by the noise of the encoders, with a
+  // delayed feedback link from each TM to its SP. Overlapping the
+  // iterations must give exactly the same results as running serially.
+  const UInt numChains = 2u;
+  auto build = [&](Network &net) {
+    for (UInt i = 0u; i < numChains; i++) {
+      const std::string n = std::to_string(i);
+      net.addRegion("encoder" + n, "RDSEEncoderRegion", "{size: 1000, sparsity: 0.05, radius: 0.5, noise: 0.2, seed: " + std::to_string(42 + i) + "}");
+      net.addRegion("sp" + n, "SPRegion", "{columnCount: 256, globalInhibition: true}");
+      net.addRegion("tm" + n, "TMRegion", "{numberOfCols: 256, cellsPerColumn: 4, orColumnOutputs: true}");
+      net.link("encoder" + n, "sp" + n, "", "", "encoded", "bottomUpIn");
+      net.link("sp" + n, "tm" + n, "", "", "bottomUpOut", "bottomUpIn");
+      net.link("tm" + n, "sp" + n, "", "", "bottomUpOut", "bottomUpIn", 1);
+      net.getRegion("encoder" + n)->setParameterReal64("sensedValue", static_cast<Real64>(i));
+    }
+    net.initialize();
+  };
+
+  Network serial;
+  build(serial);
+  Network pipelined;
+  build(pipelined);
+  pipelined.setThreadPool(std::make_shared<ThreadPool>(4u));
+  pipelined.setPipelineDepth(3u);
+  ASSERT_EQ(pipelined.getPipelineDepth(), 3u);
+
+  auto compare = [&]() {
+    for (UInt i = 0u; i < numChains; i++) {
+      for (const std::string name : {"sp", "tm"}) {
+        const std::string r = name + std::to_string(i);
+        ASSERT_EQ(serial.getRegion(r)->getOutputData("bottomUpOut").getSDR(),
+                  pipelined.getRegion(r)->getOutputData("bottomUpOut").getSDR()) << r;
+      }
+    }
+  };
+
+  serial.enableProfiling();
+  pipelined.enableProfiling();
+  serial.run(25);
+  pipelined.run(25);
+  compare();
+
+  // A queued link records each transfer once, when it is pulled, and delivers
+  // the same bytes as in the serial run.
+  const auto serialLinks = serial.getLinks();
+  const auto pipelinedLinks = pipelined.getLinks();
+  ASSERT_EQ(serialLinks.size(), pipelinedLinks.size());
+  for (size_t i = 0u; i < serialLinks.size(); i++) {
+    ASSERT_EQ(serialLinks[i]->getMoniker(), pipelinedLinks[i]->getMoniker());
+    EXPECT_EQ(pipelinedLinks[i]->getTransferHistogram().getCount(), 25u) << pipelinedLinks[i]->getMoniker();
+    EXPECT_EQ(pipelinedLinks[i]->getBytesMoved(), serialLinks[i]->getBytesMoved()) << pipelinedLinks[i]->getMoniker();
+  }
+  serial.disableProfiling();
+  pipelined.disableProfiling();
+
+  // The links are back to normal afterwards, with their delayed data.
+  for (const auto &in : pipelined.getRegion("sp0")->getInputs()) {
+    for (const auto &link : in.second->getLinks()) {
+      ASSERT_FALSE(link->isQueued());
+    }
+  }
+  serial.run(1);
+  pipelined.run(1);
+  compare();
+}
+
+TEST(NetworkTest, Profile) {
+  Network net;
+  net.addRegion("encoder", "RDSEEncoderRegion", "{size: 1000, sparsity: 0.05, radius: 0.5, seed: 42}");
+  net.addRegion("sp", "SPRegion", "{columnCount: 256, globalInhibition: true}");
+  net.link("encoder", "sp", "", "", "encoded", "bottomUpIn", 1);
+  net.initialize();
+  net.run(3); // not profiled
+
+  net.enableProfiling();
+  net.run(10);
+  const auto link = net.getLinks().at(0);
+  EXPECT_EQ(net.getRegion("sp")->getComputeHistogram().getCount(), 10u);
+  EXPECT_EQ(link->getTransferHistogram().getCount(), 10u);
+  // The delayed link delivers the active bits of each step once (at most 50,
+  // fewer when the encoder's hashes collide). Its buffer is allocated once
+  // at initialization.
+  const UInt64 bytes = link->getBytesMoved();
+  EXPECT_LE(bytes, 10u * 50u * sizeof(ElemSparse));
+  EXPECT_GT(bytes, 10u * 40u * sizeof(ElemSparse));
+  EXPECT_EQ(bytes % sizeof(ElemSparse), 0u);
+  EXPECT_EQ(link->getAllocations(), 0u);
+
+  const std::string json = net.getProfile();
+  EXPECT_NE(json.find("\"sp\": {\"count\": 10, \"total\": "), std::string::npos) << json;
+  EXPECT_NE(json.find("{\"link\": \"encoder.encoded-->sp.bottomUpIn\""), std::string::npos) << json;
+  EXPECT_NE(json.find("\"bytes\": " + std::to_string(bytes) + ", \"allocations\": 0}"), std::string::npos) << json;
+
+  const std::string prom = net.getProfile("PROMETHEUS");
+  EXPECT_NE(prom.find("# TYPE htm_region_compute_seconds summary\n"), std::string::npos) << prom;
+  EXPECT_NE(prom.find("htm_region_compute_seconds_count{region=\"encoder\"} 10\n"), std::string::npos) << prom;
+  EXPECT_NE(prom.find("htm_region_compute_seconds{region=\"sp\",quantile=\"0.99\"} "), std::string::npos) << prom;
+  EXPECT_NE(prom.find("htm_link_bytes_total{src=\"encoder.encoded\",dest=\"sp.bottomUpIn\"} " + std::to_string(bytes) + "\n"), std::string::npos) << prom;
+  // The maxima are a gauge family of their own, not samples of the summary.
+  EXPECT_EQ(prom.find("htm_region_compute_seconds_max"),
+            prom.find("# HELP htm_region_compute_seconds_max ")
+            + std::string("# HELP ").size()) << prom;
+  EXPECT_NE(prom.find("# TYPE htm_region_compute_seconds_max gauge\n"
+                      "htm_region_compute_seconds_max{region="), std::string::npos) << prom;
+  EXPECT_NE(prom.find("# TYPE htm_link_transfer_seconds_max gauge\n"), std::string::npos) << prom;
+
+  EXPECT_ANY_THROW(net.getProfile("XML"));
+
+  net.resetProfiling();
+  net.disableProfiling();
+  net.run(1);
+  EXPECT_EQ(net.getRegion("sp")->getComputeHistogram().getCount(), 0u);
+  EXPECT_EQ(link->getBytesMoved(), 0u);
+}
+
+
 } // namespace testing
@@ -304,6 +304,52 @@ TEST_F(RESTapiTest, test_delete) {
 }
 
 
+TEST_F(RESTapiTest, profile) {
+  char message[1000];
+  Value vm;
+
+  std::string config = R"(
+   {network: [
+       {addRegion: {name: "encoder", type: "RDSEEncoderRegion", params: {size: 1000, sparsity: 0.2, radius: 0.03, seed: 2019}}},
+       {addRegion: {name: "sp", type: "SPRegion", params: {columnCount: 2048, globalInhibition: true}}},
+       {addLink:   {src: "encoder.encoded", dest: "sp.bottomUpIn"}}
+    ]})";
+  auto res = client->Post("/network", config, "application/json");
+  ASSERT_TRUE(res && res->status / 100 == 2) << "Failed Response to POST /network request.";
+  vm.parse(res->body);
+  ASSERT_FALSE(vm.contains("err")) << "An error returned. " << vm["err"].str();
+  std::string id = vm["result"].str();
+
+  snprintf(message, sizeof(message), "/network/%s/profile?action=enable", id.c_str());
+  res = client->Put(message, "", "text/plain");
+  ASSERT_TRUE(res && res->status / 100 == 2) << " PUT profile message failed.";
+  vm.parse(res->body);
+  ASSERT_FALSE(vm.contains("err")) << "An error returned. " << vm["err"].str();
+
+  snprintf(message, sizeof(message), "/network/%s/run?iterations=5", id.c_str());
+  res = client->Get(message);
+  ASSERT_TRUE(res && res->status / 100 == 2) << " GET run message failed.";
+
+  snprintf(message, sizeof(message), "/network/%s/profile", id.c_str());
+  res = client->Get(message);
+  ASSERT_TRUE(res && res->status / 100 == 2) << " GET profile message failed.";
+  vm.parse(res->body);
+  ASSERT_FALSE(vm.contains("err")) << "An error returned. " << vm["err"].str();
+  EXPECT_EQ(vm["result"]["regions"]["sp"]["count"].as<UInt32>(), 5u);
+  EXPECT_EQ(vm["result"]["links"][0]["link"].str(), "encoder.encoded-->sp.bottomUpIn");
+
+  snprintf(message, sizeof(message), "/network/%s/profile?format=PROMETHEUS", id.c_str());
+  res = client->Get(message);
+  ASSERT_TRUE(res && res->status / 100 == 2) << " GET profile message failed.";
+  EXPECT_NE(res->body.find("htm_region_compute_seconds_count{region=\"sp\"} 5\n"), std::string::npos) << res->body;
+
+  snprintf(message, sizeof(message), "/network/%s/profile?action=restart", id.c_str());
+  res = client->Put(message, "", "text/plain");
+  ASSERT_TRUE(res && res->status / 100 == 2) << " PUT profile message failed.";
+  vm.parse(res->body);
+  EXPECT_TRUE(vm.contains("err")) << "Expected an error for an unknown action.";
+}
+
 TEST_F(RESTapiTest, alternative_ids) {
 
   // Client thread.
@@ -29,6 +29,8 @@
 #include <htm/utils/Log.hpp>
 #include <htm/ntypes/Value.hpp>
 #include <htm/regions/DatabaseRegion.hpp>
+#include <htm/os/Directory.hpp>
+#include <fstream>
 
 namespace testing {
 
@@ -101,6 +103,100 @@ TEST(DatabaseRegionTest, overall)
 }
 
 
+TEST(DatabaseRegionTest, blobsAndBatches)
+{
+	const UInt EPOCHS = 10;
+	const UInt DIM_INPUT = 1000;
+	std::string output_file = "TestOutputDir/blobs.db";
+	if (!Directory::exists("TestOutputDir")) Directory::create("TestOutputDir", false, true);
+
+	Network net;
+	std::shared_ptr<Region> encoder = net.addRegion("encoder", "RDSEEncoderRegion",
+	    "{size: " + std::to_string(DIM_INPUT) + ", sparsity: 0.02, radius: 0.03, seed: 2019}");
+	std::shared_ptr<Region> output = net.addRegion("output", "DatabaseRegion",
+	    "{outputFile: '" + output_file + "', commitInterval: 5}");
+	net.link("encoder", "output", "", "", "bucket", "dataIn0");
+	net.link("encoder", "output", "", "", "encoded", "dataIn1");
+	net.link("encoder", "output", "", "", "encoded", "sdrIn0");
+	net.initialize();
+
+	std::vector<size_t> activeBits;
+	for (UInt e = 0; e < EPOCHS; e++) {
+		encoder->setParameterReal64("sensedValue", std::sin(0.1 * e));
+		net.run(1);
+		activeBits.push_back(encoder->getOutputData("encoded").getSDR().getSum());
+	}
+	// The last commitInterval committed everything, there is nothing left to commit.
+	EXPECT_THROW(output->executeCommand({ "commitTransaction" }), htm::Exception);
+	EXPECT_EQ(std::stoi(output->executeCommand({ "getRowCount" })), 3 * EPOCHS);
+	output->executeCommand({ "closeFile" });
+
+	// Read back the blobs.
+	sqlite3 *db = nullptr;
+	ASSERT_EQ(sqlite3_open(output_file.c_str(), &db), SQLITE_OK);
+	sqlite3_stmt *stmt = nullptr;
+	ASSERT_EQ(sqlite3_prepare_v2(db, "SELECT length(value) FROM dataStream_dataIn1 ORDER BY iteration;", -1, &stmt, nullptr), SQLITE_OK);
+	for (UInt e = 0; e < EPOCHS; e++) {
+		ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+		EXPECT_EQ(sqlite3_column_int(stmt, 0), static_cast<int>(DIM_INPUT * sizeof(Real32)));
+	}
+	sqlite3_finalize(stmt);
+	ASSERT_EQ(sqlite3_prepare_v2(db, "SELECT value FROM sdrStream_sdrIn0 ORDER BY iteration;", -1, &stmt, nullptr), SQLITE_OK);
+	for (UInt e = 0; e < EPOCHS; e++) {
+		ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+		EXPECT_EQ(static_cast<size_t>(sqlite3_column_bytes(stmt, 0)), activeBits[e] * sizeof(UInt32));
+	}
+	EXPECT_EQ(sqlite3_step(stmt), SQLITE_DONE);
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	Directory::removeTree("TestOutputDir", true);
+}
+
+TEST(DatabaseRegionTest, restoreAndReopen)
+{
+	if (!Directory::exists("TestOutputDir")) Directory::create("TestOutputDir", false, true);
+	const std::string encoder_params = "{size: 1000, sparsity: 0.02, radius: 0.03, seed: 2019}";
+	std::stringstream ss;
+	{
+		Network net;
+		std::shared_ptr<Region> encoder = net.addRegion("encoder", "RDSEEncoderRegion", encoder_params);
+		net.addRegion("output", "DatabaseRegion", "{outputFile: 'TestOutputDir/restore1.db'}");
+		net.link("encoder", "output", "", "", "bucket", "dataIn0");
+		net.initialize();
+		encoder->setParameterReal64("sensedValue", 0.5);
+		net.run(2);
+		net.save(ss);
+	}
+
+	// The restored network is not initialized again, but still writes rows.
+	Network net;
+	net.load(ss);
+	std::shared_ptr<Region> output = net.getRegion("output");
+	net.run(3);
+	output->executeCommand({ "commitTransaction" });
+	EXPECT_EQ(std::stoi(output->executeCommand({ "getRowCount" })), 3);
+
+	// So does a reopened file, stale journal files of an older database are removed.
+	for (const std::string journal : {"TestOutputDir/restore2.db-wal", "TestOutputDir/restore2.db-shm"}) {
+		std::ofstream stale(journal);
+		stale << "stale journal";
+	}
+	output->setParameterString("outputFile", "TestOutputDir/restore2.db");
+	for (const std::string journal : {"TestOutputDir/restore2.db-wal", "TestOutputDir/restore2.db-shm"}) {
+		std::ifstream in(journal);
+		std::string content;
+		std::getline(in, content);
+		EXPECT_NE(content, "stale journal") << journal;
+	}
+	net.run(4);
+	output->executeCommand({ "commitTransaction" });
+	EXPECT_EQ(std::stoi(output->executeCommand({ "getRowCount" })), 4);
+	output->executeCommand({ "closeFile" });
+
+	Directory::removeTree("TestOutputDir", true);
+}
+
 TEST(DatabaseRegionTest, getSpecJSON) {
   std::string expected = R"({"spec": "DatabaseRegion",
   "description": "DatabaseRegion is a node that writes multiple scalar streams to a SQLite3 database file (.db). The target filename is specified using the 'outputFile' parameter at run time. On each compute, all inputs are written to the database.",
@@ -111,6 +207,20 @@ TEST(DatabaseRegionTest, getSpecJSON) {
       "count": 1,
       "access": "ReadWrite",
       "defaultValue": ""
+    },
+    "commitInterval": {
+      "description": "Number of computes per transaction. If 0 the transaction is only committed by the commitTransaction command or closing the file.",
+      "type": "UInt32",
+      "count": 1,
+      "access": "ReadWrite",
+      "defaultValue": "0"
+    },
+    "journalMode": {
+      "description": "SQLite journal_mode of the database, set when it is opened. WAL is the fastest for a single writer.",
+      "type": "String",
+      "count": 1,
+      "access": "ReadWrite",
+      "defaultValue": "WAL"
     }
   },
   "commands": {
@@ -198,6 +308,38 @@ TEST(DatabaseRegionTest, getSpecJSON) {
       "required": 0,
       "regionLevel": 1,
       "isDefaultInput": 1
+    },
+    "sdrIn0": {
+      "description": "SDR to be written to the database as the indices of its active bits",
+      "type": "SDR",
+      "count": 0,
+      "required": 0,
+      "regionLevel": 1,
+      "isDefaultInput": 0
+    },
+    "sdrIn1": {
+      "description": "SDR to be written to the database as the indices of its active bits",
+      "type": "SDR",
+      "count": 0,
+      "required": 0,
+      "regionLevel": 1,
+      "isDefaultInput": 0
+    },
+    "sdrIn2": {
+      "description": "SDR to be written to the database as the indices of its active bits",
+      "type": "SDR",
+      "count": 0,
+      "required": 0,
+      "regionLevel": 1,
+      "isDefaultInput": 0
+    },
+    "sdrIn3": {
+      "description": "SDR to be written to the database as the indices of its active bits",
+      "type": "SDR",
+      "count": 0,
+      "required": 0,
+      "regionLevel": 1,
+      "isDefaultInput": 0
     }
   },
   "outputs": {
@@ -210,7 +352,7 @@ TEST(DatabaseRegionTest, getSpecJSON) {
 } // namespace testing
 
 TEST(DatabaseRegionTest, getParameters) {
-  std::string expected = "{\n  \"outputFile\": \":memory:\"\n}";
+  std::string expected = "{\n  \"outputFile\": \":memory:\",\n  \"commitInterval\": 0,\n  \"journalMode\": \"WAL\"\n}";
   Network net1;
   std::string output_file = ":memory:"; // in memory for this unit test. or could be physical file like: NapiOutputDir/Output.db
   std::shared_ptr<Region> region1 = net1.addRegion("db", "DatabaseRegion", "{outputFile: '" + output_file + "'}");
@@ -49,6 +49,7 @@
 #include <htm/os/Timer.hpp>
 #include <htm/os/Directory.hpp>
 #include <htm/regions/SPRegion.hpp>
+#include <htm/regions/VectorFile.hpp>
 
 
 #include <string>
@@ -71,7 +72,7 @@
 static bool verbose = false;  // turn this on to print extra stuff for debugging the test.
 
 // The following string should contain a valid expected Spec - manually verified. 
-#define EXPECTED_EFFECTOR_SPEC_COUNT  1   // The number of parameters expected in the FileOutputRegion Spec
+#define EXPECTED_EFFECTOR_SPEC_COUNT  3   // The number of parameters expected in the FileOutputRegion Spec
 #define EXPECTED_SENSOR_SPEC_COUNT  11    // The number of parameters expected in the FileInputRegion Spec
 
 using namespace htm;
@@ -268,6 +269,162 @@ TEST(VectorFileTest, testSerialization)
 
 	}
 	
+  TEST(VectorFileTest, MappedFile)
+  {
+    // Convert a csv file to the binary vector format and replay it from
+    // the mapped file.
+    std::string test_input_file = "TestOutputDir/TestInput.csv";
+    std::string test_output_file = "TestOutputDir/TestOutput.csv";
+    std::string test_mapped_file = "TestOutputDir/TestInput.htmv";
+    size_t dataWidth = 10;
+    size_t dataRows = 10;
+    createTestData(dataRows, dataWidth, test_input_file, test_output_file);
+
+    std::string params = "{activeOutputCount: " + std::to_string(dataWidth) + "}";
+    Network net1;
+    std::shared_ptr<Region> csv = net1.addRegion("region1", "FileInputRegion", params);
+    csv->executeCommand({ "loadFile", test_input_file });
+    csv->executeCommand({ "saveFile", test_mapped_file, "7" });
+    EXPECT_EQ(Path::getFileSize(test_mapped_file), 32u + dataRows * dataWidth * sizeof(Real64));
+
+    Network net2;
+    std::shared_ptr<Region> mapped = net2.addRegion("region1", "FileInputRegion", params);
+    mapped->executeCommand({ "loadFile", test_mapped_file });
+    EXPECT_EQ(mapped->getParameterUInt32("vectorCount"), dataRows);
+    EXPECT_THROW(mapped->executeCommand({ "appendFile", test_input_file }), htm::Exception);
+
+    net1.initialize();
+    net2.initialize();
+    for (size_t i = 0; i < dataRows + 2; i++) {
+      net1.run(1);
+      net2.run(1);
+      EXPECT_EQ(csv->getOutputData("dataOut"), mapped->getOutputData("dataOut")) << "row " << i;
+    }
+
+    // A saved network refers to the mapped file.
+    net2.saveToFile("TestOutputDir/MappedFile.stream");
+    Network net3;
+    net3.loadFromFile("TestOutputDir/MappedFile.stream");
+    std::shared_ptr<Region> restored = net3.getRegion("region1");
+    EXPECT_EQ(restored->getParameterUInt32("vectorCount"), dataRows);
+    net2.run(1);
+    net3.run(1);
+    EXPECT_EQ(mapped->getOutputData("dataOut"), restored->getOutputData("dataOut"));
+
+    // Headers which do not match the file size are rejected, including
+    // ones where rows * elements * sizeof(Real64) overflows to the size.
+    std::string corrupt_file = "TestOutputDir/Corrupt.htmv";
+    const std::vector<std::pair<UInt64, UInt64>> corrupt = {
+      {UInt64(1) << 61, 8u},  // elements, rows
+      {0u, 5u},
+      {dataWidth, dataRows},
+    };
+    for (const auto &c : corrupt) {
+      VectorFile::MappedHeader header;
+      header.elements = c.first;
+      header.rows = c.second;
+      std::ofstream out(corrupt_file, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof header);
+      out.close();
+      VectorFile vf;
+      EXPECT_THROW(vf.appendFile(corrupt_file, 0, 7), htm::Exception) << c.first << " x " << c.second;
+    }
+
+    // cleanup
+    Directory::removeTree("TestOutputDir", true);
+  }
+
+  TEST(VectorFileTest, OutputFormats)
+  {
+    // Write the same vectors in each output format, buffered on the writer
+    // thread except for the sparse file.
+    std::string test_input_file = "TestOutputDir/TestInput.csv";
+    std::string test_output_file = "TestOutputDir/TestOutput.csv";
+    std::string test_binary_file = "TestOutputDir/TestOutput.htmv";
+    std::string test_sparse_file = "TestOutputDir/TestOutput.sparse";
+    size_t dataWidth = 10;
+    size_t dataRows = 10;
+    createTestData(dataRows, dataWidth, test_input_file, test_output_file);
+
+    Network net;
+    std::shared_ptr<Region> region1 = net.addRegion("region1", "FileInputRegion", "{activeOutputCount: 10}");
+    std::shared_ptr<Region> csv = net.addRegion("csv", "FileOutputRegion",
+        "{outputFile: '" + test_output_file + "', flushInterval: 3}");
+    std::shared_ptr<Region> binary = net.addRegion("binary", "FileOutputRegion",
+        "{outputFile: '" + test_binary_file + "', outputFormat: binary, flushInterval: 4}");
+    std::shared_ptr<Region> sparse = net.addRegion("sparse", "FileOutputRegion",
+        "{outputFile: '" + test_sparse_file + "', outputFormat: sparse}");
+    net.link("region1", "csv", "", "", "dataOut", "dataIn");
+    net.link("region1", "binary", "", "", "dataOut", "dataIn");
+    net.link("region1", "sparse", "", "", "dataOut", "dataIn");
+    region1->executeCommand({ "loadFile", test_input_file });
+    net.initialize();
+    net.run(static_cast<int>(dataRows));
+    EXPECT_THROW(binary->executeCommand({ "echo", "text" }), htm::Exception);
+
+    csv->executeCommand({ "closeFile" });
+    binary->executeCommand({ "closeFile" });
+    sparse->executeCommand({ "closeFile" });
+
+    EXPECT_TRUE(compareFiles(test_input_file, test_output_file)) << "Files should be the same.";
+    {
+      VectorFile vf;
+      vf.appendFile(test_binary_file, dataWidth, 7);
+      ASSERT_EQ(vf.vectorCount(), dataRows);
+      std::vector<Real64> row(dataWidth);
+      for (UInt i = 0; i < dataRows; i++) {
+        vf.getRawVector(i, row.data(), 0, dataWidth);
+        for (size_t j = 0; j < dataWidth; j++)
+          EXPECT_EQ(row[j], (j == i) ? 1.0 : 0.0) << "row " << i << " element " << j;
+      }
+    }
+    {
+      // With no expected element count the mapped file supplies its own.
+      VectorFile vf;
+      vf.appendFile(test_binary_file, 0, 7);
+      ASSERT_EQ(vf.getElementCount(), dataWidth);
+      std::vector<Real64> row(dataWidth);
+      vf.getScaledVector(2, row.data(), 0, dataWidth);
+      EXPECT_EQ(row[2], 1.0);
+      EXPECT_EQ(row[3], 0.0);
+    }
+    {
+      std::ifstream in(test_sparse_file, std::ios::binary);
+      for (UInt32 i = 0; i < dataRows; i++) {
+        UInt32 record[2] = {0u, 0u};
+        in.read(reinterpret_cast<char *>(record), sizeof record);
+        EXPECT_EQ(record[0], 1u);
+        EXPECT_EQ(record[1], i);
+      }
+      EXPECT_EQ(in.peek(), EOF);
+    }
+
+    // Reopening a binary file appends to it.
+    binary->setParameterString("outputFile", test_binary_file);
+    net.run(2);
+    binary->executeCommand({ "flushFile" });
+    {
+      VectorFile vf;
+      vf.appendFile(test_binary_file, dataWidth, 7);
+      EXPECT_EQ(vf.vectorCount(), dataRows + 2u);
+    }
+    binary->executeCommand({ "closeFile" });
+
+    // A file whose header does not match its size is not appended to, even
+    // when rows * elements * sizeof(Real64) overflows to the size.
+    {
+      VectorFile::MappedHeader header;
+      header.elements = UInt64(1) << 61;
+      header.rows = 8u;
+      std::ofstream out(test_binary_file, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof header);
+    }
+    EXPECT_THROW(binary->setParameterString("outputFile", test_binary_file), htm::Exception);
+
+    // cleanup
+    Directory::removeTree("TestOutputDir", true);
+  }
+
 	//////////////////////////////////////////////////////////////////////////////////
 
 	static bool compareFiles(const std::string& p1, const std::string& p2) {
@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * ---------------------------------------------------------------------- */
+
+#include <gtest/gtest.h>
+#include <htm/types/SdrIndex.hpp>
+#include <sstream>
+#include <vector>
+
+namespace testing {
+
+using namespace std;
+using namespace htm;
+
+TEST(SdrIndexTest, ExampleUsage) {
+    SdrIndex index({ 10 });
+    SDR A({ 10 });
+    SDR B({ 10 });
+    SDR C({ 10 });
+    A.setSparse(SDR_sparse_t{ 0, 1, 2, 3 });
+    B.setSparse(SDR_sparse_t{ 2, 3, 4, 5 });
+    C.setSparse(SDR_sparse_t{ 6, 7 });
+    EXPECT_EQ( index.add( A ), 0u );
+    EXPECT_EQ( index.add( B ), 1u );
+    EXPECT_EQ( index.add( C ), 2u );
+    EXPECT_EQ( index.size(), 3u );
+
+    SDR Q({ 10 });
+    Q.setSparse(SDR_sparse_t{ 1, 2, 3, 4 });
+    // Ties are broken by id.
+    auto matches = index.query( Q, 10 );
+    ASSERT_EQ( matches, vector<SdrIndex::Match>({ { 0, 3 }, { 1, 3 } }) );
+    matches = index.query( Q, 1 );
+    ASSERT_EQ( matches, vector<SdrIndex::Match>({ { 0, 3 } }) );
+    matches = index.query( Q, 10, 4 );
+    ASSERT_TRUE( matches.empty() );
+
+    // Remove keeps the ids of the other SDRs.
+    index.remove( 0 );
+    EXPECT_FALSE( index.contains( 0 ) );
+    EXPECT_EQ( index.size(), 2u );
+    EXPECT_THROW( index.remove( 0 ), htm::Exception );
+    matches = index.query( Q, 10 );
+    ASSERT_EQ( matches, vector<SdrIndex::Match>({ { 1, 3 } }) );
+    EXPECT_EQ( index.add( A ), 3u );
+    EXPECT_EQ( index.getSparse( 3 ), A.getSparse() );
+
+    SDR wrongSize({ 11 });
+    EXPECT_THROW( index.add( wrongSize ), htm::Exception );
+}
+
+TEST(SdrIndexTest, MatchesBruteForce) {
+    const UInt N = 500u;
+    SdrIndex index({ 32, 32 });
+    vector<SDR> stored( N, SDR({ 32, 32 }) );
+    Random rng( 42 );
+    for( auto &sdr : stored ) {
+        sdr.randomize( 0.05f, rng );
+        index.add( sdr );
+    }
+    for( UInt id = 0u; id < N; id += 3u )
+        index.remove( id );
+
+    vector<SDR> queries( 20, SDR({ 32, 32 }) );
+    for( auto &q : queries )
+        q.randomize( 0.05f, rng );
+
+    index.setThreadPool( std::make_shared<ThreadPool>( 4u ) );
+    const auto batch = index.queryBatch( queries, 5u );
+    ASSERT_EQ( batch.size(), queries.size() );
+    for( size_t q = 0u; q < queries.size(); q++ ) {
+        vector<SdrIndex::Match> expected;
+        for( UInt id = 0u; id < N; id++ ) {
+            const UInt overlap = queries[q].getOverlap( stored[id] );
+            if( index.contains( id ) && overlap > 0u )
+                expected.push_back({ id, overlap });
+        }
+        std::stable_sort( expected.begin(), expected.end(),
+            [](const SdrIndex::Match &a, const SdrIndex::Match &b) { return a.overlap > b.overlap; });
+        expected.resize( std::min<size_t>( expected.size(), 5u ) );
+        EXPECT_EQ( batch[q], expected );
+        EXPECT_EQ( index.query( queries[q], 5u ), expected );
+    }
+}
+
+TEST(SdrIndexTest, Serialization) {
+    SdrIndex index({ 100 });
+    SDR A({ 100 });
+    Random rng( 7 );
+    for( UInt i = 0u; i < 10u; i++ ) {
+        A.randomize( 0.1f, rng );
+        index.add( A );
+    }
+    index.remove( 4 );
+
+    std::stringstream ss;
+    index.save( ss );
+    SdrIndex loaded;
+    loaded.load( ss );
+    ASSERT_EQ( index, loaded );
+    EXPECT_EQ( loaded.size(), 9u );
+    EXPECT_FALSE( loaded.contains( 4 ) );
+    EXPECT_EQ( loaded.query( A, 3 ), index.query( A, 3 ) );
+    EXPECT_EQ( loaded.add( A ), 10u );
+
+    // A copy has its own scratch space.
+    const SdrIndex copy = index;
+    EXPECT_EQ( copy.query( A, 3 ), index.query( A, 3 ) );
+}
+
+} // namespace testing
@@ -437,6 +437,70 @@ TEST(SdrTest, TestGetCoordinatesFromDense) {
     ASSERT_EQ( a.getCoordinates()[1].size(), 0ul );
 }
 
+TEST(SdrTest, TestBitset) {
+    // Size is not a multiple of 64.
+    SDR a({10, 10});
+    a.setSparse(SDR_sparse_t({ 0, 1, 63, 64, 99 }));
+    const SDR_bitset_t expected({ 0x8000000000000003ull, 0x0000000800000001ull });
+    ASSERT_EQ( a.getBitset(), expected );
+    // Copy & swap
+    SDR b({10, 10});
+    b.setBitset( expected );
+    ASSERT_EQ( b.getSparse(), SDR_sparse_t({ 0, 1, 63, 64, 99 }) );
+    ASSERT_EQ( b.getCoordinates(), vector<vector<UInt>>({{ 0, 0, 6, 6, 9 }, { 0, 1, 3, 4, 9 }}) );
+    SDR_bitset_t swap({ 4ull, 0ull });
+    b.setBitset( swap );
+    ASSERT_EQ( b.getDense()[2], 1u );
+    ASSERT_EQ( b.getSum(), 1u );
+    // From dense
+    auto dense = a.getDense();
+    b.setDense( dense );
+    ASSERT_EQ( b.getBitset(), expected );
+    ASSERT_TRUE( a == b );
+    // Modify inplace
+    b.getBitset()[1] = 0u;
+    b.setBitset( b.getBitset() );
+    ASSERT_EQ( b.getSparse(), SDR_sparse_t({ 0, 1, 63 }) );
+    // Overlap of the bitsets matches the overlap of the sparse data.
+    SDR c({ 1000u });
+    SDR d({ 1000u });
+    c.randomize( 0.3f );
+    d.randomize( 0.3f );
+    const UInt ovlp = c.getOverlap( d );
+    c.getBitset();
+    d.getBitset();
+    ASSERT_EQ( c.getOverlap( d ), ovlp );
+}
+
+TEST(SdrTest, TestSetOperationsCallbacks) {
+    // The set operations mark their result valid before notifying, a
+    // callback which modifies the result is not undone by them.
+    SDR a({ 1000u });
+    SDR b({ 1000u });
+    SDR c({ 1000u });
+    a.randomize( 0.5f );
+    b.randomize( 0.5f );
+    a.getBitset();
+    b.getBitset();
+    bool zeroed = false;
+    c.addCallback( [&]() {
+        if( not zeroed ) {
+            zeroed = true;
+            c.zero();
+        }
+    });
+    c.intersection( a, b );
+    ASSERT_TRUE( zeroed );
+    ASSERT_EQ( c.getSum(), 0u );
+    ASSERT_EQ( c.getBitset(), SDR_bitset_t( c.getBitset().size(), 0u ) );
+
+    zeroed = false;
+    c.set_union( a, b );
+    ASSERT_TRUE( zeroed );
+    ASSERT_EQ( c.getSum(), 0u );
+    ASSERT_EQ( c.getBitset(), SDR_bitset_t( c.getBitset().size(), 0u ) );
+}
+
 TEST(SdrTest, TestAt) {
     SDR a({3, 3});
     a.setSparse(SDR_sparse_t( {4, 5, 8} ));
@@ -658,6 +722,53 @@ TEST(SdrTest, TestUnion) {
     ASSERT_EQ( U.getSparsity(), .5 );
 }
 
+TEST(SdrTest, TestSetOperationPaths) {
+    // Compare intersection & union against a dense reference, for inputs
+    // which select each of the sparse, galloping and bitmap paths.
+    Random rng( 42 );
+    for( const Real sparsity : { 0.001f, 0.02f, 0.3f } ) {
+    for( const size_t nInputs : { 2u, 3u, 20u } ) {
+    for( const int format : { 0, 1, 2 } ) { // sparse, dense only, bitset only
+        std::vector<SDR> inputs( nInputs, SDR({ 10000u }) );
+        std::vector<const SDR*> ptrs;
+        for( auto &inp : inputs ) {
+            inp.randomize( sparsity, rng );
+            ptrs.push_back( &inp );
+        }
+        // The first input is much larger than the rest, to gallop over it.
+        inputs[0].randomize( 0.5f, rng );
+        if( format == 1 ) {
+            // Only the dense data is valid.
+            auto dense = inputs[1].getDense();
+            inputs[1].setDense( dense );
+        }
+        else if( format == 2 ) {
+            // Only the bitsets are valid.
+            for( auto &inp : inputs ) {
+                auto bitset = inp.getBitset();
+                inp.setBitset( bitset );
+            }
+        }
+        SDR_dense_t inter( 10000u, 1u );
+        SDR_dense_t uni( 10000u, 0u );
+        for( const auto &inp : inputs ) {
+            const auto &dense = inp.getDense();
+            for( size_t i = 0; i < dense.size(); i++ ) {
+                inter[i] = inter[i] && dense[i];
+                uni[i]   = uni[i]   || dense[i];
+            }
+        }
+        SDR X({ 10000u });
+        X.intersection( ptrs );
+        ASSERT_EQ( X.getDense(), inter );
+        X.set_union( ptrs );
+        ASSERT_EQ( X.getDense(), uni );
+        // Inplace
+        inputs[1].set_union( ptrs );
+        ASSERT_EQ( inputs[1].getDense(), uni );
+    }}}
+}
+
 TEST(SdrTest, TestConcatenationExampleUsage) {
     SDR A({ 10 });
     SDR B({ 10 });
@@ -871,6 +982,50 @@ TEST(SdrTest, TestCallbacks) {
 }
 
 
+TEST(SdrTest, TestSuspendCallbacks) {
+    SDR A({ 100 });
+    int count = 0;
+    vector<UInt> seen;
+    A.addCallback( [&](){ count++; seen = A.getSparse(); });
+
+    // Several changes are reported once, with the final value.
+    {
+        SDR::SuspendCallbacks guard( A );
+        A.setSparse(SDR_sparse_t{ 1, 2, 3 });
+        A.addNoise( 0.5f );
+        A.setSparse(SDR_sparse_t{ 4, 5 });
+        ASSERT_EQ( count, 0 );
+    }
+    ASSERT_EQ( count, 1 );
+    ASSERT_EQ( seen, vector<UInt>({ 4, 5 }) );
+
+    // Nested suspensions only notify when the outer one ends.
+    A.suspendCallbacks();
+    {
+        SDR::SuspendCallbacks guard( A );
+        A.zero();
+    }
+    ASSERT_EQ( count, 1 );
+    A.resumeCallbacks();
+    ASSERT_EQ( count, 2 );
+    ASSERT_TRUE( seen.empty() );
+
+    // No notification if nothing was assigned.
+    {
+        SDR::SuspendCallbacks guard( A );
+    }
+    ASSERT_EQ( count, 2 );
+    ASSERT_ANY_THROW( A.resumeCallbacks() );
+
+    // Assigning the same value is reported, as it is without a suspension.
+    {
+        SDR::SuspendCallbacks guard( A );
+        A.zero();
+    }
+    ASSERT_EQ( count, 3 );
+}
+
+
 TEST(SdrTest, TestAssignmentOperator) 
 {
   SDR a({10, 10});
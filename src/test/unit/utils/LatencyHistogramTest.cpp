@@ -0,0 +1,75 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+
+#include "gtest/gtest.h"
+
+#include <limits>
+
+#include "htm/types/Types.hpp"
+#include "htm/utils/LatencyHistogram.hpp"
+
+namespace testing {
+
+using namespace htm;
+
+TEST(LatencyHistogramTest, Buckets) {
+  size_t previous = 0u;
+  for(UInt64 ns = 1u; ns < 100000u; ns++) {
+    const size_t b = LatencyHistogram::bucket(ns);
+    ASSERT_LT(b, LatencyHistogram::numBuckets);
+    ASSERT_LE(ns, LatencyHistogram::bucketLimit(b));
+    ASSERT_TRUE(b == previous or b == previous + 1u) << ns;
+    if(b != previous) {
+      ASSERT_EQ(LatencyHistogram::bucketLimit(previous), ns - 1u);
+    }
+    // Relative error of at most one in eight.
+    ASSERT_LE(LatencyHistogram::bucketLimit(b) - ns, ns / 8u) << ns;
+    previous = b;
+  }
+  const UInt64 largest = std::numeric_limits<UInt64>::max();
+  ASSERT_EQ(LatencyHistogram::bucket(largest), LatencyHistogram::numBuckets - 1u);
+  ASSERT_EQ(LatencyHistogram::bucketLimit(LatencyHistogram::numBuckets - 1u), largest);
+}
+
+TEST(LatencyHistogramTest, Quantiles) {
+  LatencyHistogram h;
+  ASSERT_EQ(h.getCount(), 0u);
+  ASSERT_EQ(h.getQuantile(0.5), 0.0);
+
+  for(UInt64 us = 1u; us <= 1000u; us++) {
+    h.record(us * 1000u);
+  }
+  ASSERT_EQ(h.getCount(), 1000u);
+  ASSERT_NEAR(h.getSum(), 500500.0e-6, 1.0e-9);
+  ASSERT_DOUBLE_EQ(h.getMax(), 1.0e-3);
+
+  const Real64 p50 = h.getQuantile(0.5);
+  ASSERT_GE(p50, 500.0e-6);
+  ASSERT_LE(p50, 500.0e-6 * 1.125);
+  const Real64 p99 = h.getQuantile(0.99);
+  ASSERT_GE(p99, 990.0e-6);
+  ASSERT_LE(p99, 1.0e-3) << "capped at the maximum";
+  ASSERT_DOUBLE_EQ(h.getQuantile(1.0), h.getMax());
+
+  h.reset();
+  ASSERT_EQ(h.getCount(), 0u);
+  ASSERT_EQ(h.getMax(), 0.0);
+  ASSERT_EQ(h.getQuantile(0.99), 0.0);
+}
+
+} // namespace testing
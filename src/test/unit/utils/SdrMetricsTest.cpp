@@ -314,6 +314,53 @@ TEST(SdrMetricsTest, TestAF_Entropy) {
     EXPECT_LT( last_entropy, tolerance );
 }
 
+/*
+ * ActivationFrequency
+ * Verify that the sparse updates match the straight forward exponential moving
+ * average, including after the internal scale factor has been renormalized.
+ */
+TEST(SdrMetricsTest, TestAF_SparseUpdates) {
+    const UInt size   = 50u;
+    const UInt period = 7u;
+    SDR A({ size });
+    ActivationFrequency F( A, period );
+    ActivationFrequency G( A, period, 0.25f );
+    vector<double> expectF( size, 0.0 );
+    vector<double> expectG( size, 0.25 );
+    Random rng( 42 );
+    for(UInt sample = 1u; sample <= 2000u; sample++) {
+        A.randomize( 0.1f, rng );
+        const double alphaF = 1.0 / std::min( period, sample );
+        const double alphaG = 1.0 / period;
+        for(auto &x : expectF) x *= 1.0 - alphaF;
+        for(auto &x : expectG) x *= 1.0 - alphaG;
+        for(const auto idx : A.getSparse()) {
+            expectF[idx] += alphaF;
+            expectG[idx] += alphaG;
+        }
+        if( sample % 97u == 0u ) {
+            for(UInt i = 0u; i < size; i++) {
+                ASSERT_NEAR( F.activationFrequency[i], expectF[i], 1.0e-4 );
+                ASSERT_NEAR( G.activationFrequency[i], expectG[i], 1.0e-4 );
+            }
+        }
+    }
+}
+
+TEST(SdrMetricsTest, TestSuspendedCallbacks) {
+    SDR A({ 100u });
+    Metrics M( A, 10u );
+    {
+        // Metrics only see the final value.
+        SDR::SuspendCallbacks guard( A );
+        A.randomize( 0.5f );
+        A.randomize( 0.1f );
+    }
+    ASSERT_EQ( M.sparsity.samples, 1u );
+    ASSERT_NEAR( M.sparsity.mean(), 0.1f, 0.001f );
+    ASSERT_NEAR( M.activationFrequency.mean(), 0.1f, 0.001f );
+}
+
 TEST(SdrMetricsTest, TestAF_Print) {
     // Test passes if it does not crash.  The exact strings are checked by
     // python unit tests.
@@ -0,0 +1,115 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+
+#include "gtest/gtest.h"
+
+#include <numeric>
+
+#include "htm/types/Types.hpp"
+#include "htm/utils/SlabAllocator.hpp"
+
+namespace testing {
+
+using namespace htm;
+
+TEST(SlabAllocatorTest, SizeClasses) {
+  size_t previousClass = 0u, previousSize = 8u; //class 0, 1 to 8 bytes
+  for(size_t bytes = 1u; bytes <= SlabArena::maxBlockSize; bytes++) {
+    size_t blockSize;
+    const size_t cls = SlabArena::sizeClass(bytes, blockSize);
+    ASSERT_LT(cls, SlabArena::numClasses);
+    ASSERT_GE(blockSize, bytes);
+    ASSERT_EQ(blockSize % 8u, 0u);
+    if(bytes > 64u) {
+      ASSERT_LE(blockSize - bytes, bytes / 4u) << "rounding wastes at most a quarter";
+    }
+    // Classes are numbered in order of their block size, without gaps.
+    ASSERT_TRUE(cls == previousClass or cls == previousClass + 1u) << bytes;
+    ASSERT_TRUE(cls != previousClass or blockSize == previousSize) << bytes;
+    previousClass = cls;
+    previousSize  = blockSize;
+  }
+  ASSERT_EQ(previousClass, SlabArena::numClasses - 1u);
+  ASSERT_EQ(previousSize,  SlabArena::maxBlockSize);
+
+  size_t blockSize;
+  ASSERT_EQ(SlabArena::sizeClass(SlabArena::maxBlockSize + 1u, blockSize), SlabArena::numClasses);
+  ASSERT_EQ(blockSize, SlabArena::maxBlockSize + 1u);
+}
+
+TEST(SlabAllocatorTest, ReusesFreedBlocks) {
+  SlabAllocator<UInt32> alloc(new SlabArena());
+  const SlabArena &arena = *alloc.arena();
+
+  UInt32 *a = alloc.allocate(10u);
+  ASSERT_EQ(arena.bytesInUse(), 40u);
+  ASSERT_EQ(arena.bytesReserved(), SlabArena::chunkSize);
+  alloc.deallocate(a, 10u);
+  ASSERT_EQ(arena.bytesInUse(), 0u);
+  ASSERT_EQ(arena.bytesFree(),  40u);
+
+  UInt32 *b = alloc.allocate(9u); // same size class
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(arena.bytesFree(), 0u);
+  alloc.deallocate(b, 9u);
+}
+
+TEST(SlabAllocatorTest, Vectors) {
+  SlabAllocator<char> alloc(new SlabArena());
+  std::vector<SlabVector<UInt32>> lists(100, SlabVector<UInt32>(alloc));
+  for(UInt32 i = 0u; i < 5000u; i++) {
+    lists[(i * 7u) % lists.size()].push_back(i);
+  }
+  UInt32 sum = 0u;
+  for(const auto &list : lists) {
+    ASSERT_EQ(list.get_allocator(), alloc);
+    ASSERT_EQ(list.size(), 50u);
+    sum = std::accumulate(list.begin(), list.end(), sum);
+  }
+  ASSERT_EQ(sum, 4999u * 5000u / 2u);
+
+  // Copies and copy assignment share the arena.
+  SlabVector<UInt32> copy = lists[0];
+  ASSERT_EQ(copy.get_allocator(), alloc);
+  SlabVector<UInt32> assigned;
+  assigned = lists[1];
+  ASSERT_EQ(assigned.get_allocator(), alloc);
+  ASSERT_EQ(assigned, lists[1]);
+
+  // Move assignment takes the arena along.
+  SlabVector<UInt32> onHeap;
+  onHeap = std::move(copy);
+  ASSERT_EQ(onHeap.get_allocator(), alloc);
+}
+
+TEST(SlabAllocatorTest, ArenaLivesWithItsAllocators) {
+  SlabVector<UInt32> list;
+  {
+    SlabAllocator<char> alloc(new SlabArena());
+    SlabVector<UInt32> tmp(alloc);
+    tmp.assign(1000u, 7u);
+    list = std::move(tmp);
+  } // the arena is still referenced by list
+  ASSERT_NE(list.get_allocator().arena(), nullptr);
+  ASSERT_EQ(list.size(), 1000u);
+  ASSERT_EQ(list[999], 7u);
+  list.push_back(8u); // grow within the arena
+  ASSERT_EQ(list.back(), 8u);
+}
+
+} // namespace testing
@@ -0,0 +1,77 @@
+/* ---------------------------------------------------------------------
+ * HTM Community Edition of NuPIC
+ * Copyright (C) 2020, Numenta, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ * --------------------------------------------------------------------- */
+
+
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <stdexcept>
+
+#include "htm/utils/ThreadPool.hpp"
+
+namespace testing {
+
+using namespace htm;
+
+TEST(ThreadPoolTest, ParallelForRunsEveryTaskOnce) {
+  for(UInt threads : {1u, 2u, 4u}) {
+    ThreadPool pool(threads);
+    ASSERT_EQ(pool.numThreads(), threads);
+    for(int repeat = 0; repeat < 20; repeat++) {
+      std::vector<UInt> hits(97, 0u);
+      pool.parallelFor(hits.size(), [&](size_t task) { hits[task]++; });
+      ASSERT_EQ(hits, std::vector<UInt>(97, 1u));
+    }
+  }
+}
+
+TEST(ThreadPoolTest, Split) {
+  const size_t size = 10u, parts = 3u;
+  size_t expectedBegin = 0u;
+  for(size_t part = 0u; part < parts; part++) {
+    const auto r = ThreadPool::split(size, parts, part);
+    ASSERT_EQ(r.first, expectedBegin);
+    expectedBegin = r.second;
+  }
+  ASSERT_EQ(expectedBegin, size);
+}
+
+TEST(ThreadPoolTest, NestedCallRunsInline) {
+  ThreadPool pool(3);
+  std::vector<std::vector<UInt>> hits(4, std::vector<UInt>(5, 0u));
+  pool.parallelFor(hits.size(), [&](size_t outer) {
+    pool.parallelFor(hits[outer].size(), [&](size_t inner) { hits[outer][inner]++; });
+  });
+  for(const auto &h : hits) {
+    ASSERT_EQ(h, std::vector<UInt>(5, 1u));
+  }
+}
+
+TEST(ThreadPoolTest, ExceptionIsRethrown) {
+  ThreadPool pool(4);
+  std::vector<UInt> hits(16, 0u);
+  EXPECT_THROW(pool.parallelFor(hits.size(), [&](size_t task) {
+    hits[task]++;
+    if( task == 5u ) throw std::runtime_error("task failed");
+  }), std::runtime_error);
+  ASSERT_EQ(hits, std::vector<UInt>(16, 1u)) << "remaining tasks still run";
+  // the pool stays usable
+  pool.parallelFor(hits.size(), [&](size_t task) { hits[task]++; });
+  ASSERT_EQ(hits, std::vector<UInt>(16, 2u));
+}
+
+} // namespace testing
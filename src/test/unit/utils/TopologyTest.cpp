@@ -413,4 +413,24 @@ ASSERT_TRUE(centerFound_) << "Center was not included in hood!";
 
 }
 
+TEST(TopologyTest, NeighborListsMatchUpdateAllNeighbors) {
+  for(const auto &dims : vector<vector<UInt>>{ {12}, {5, 7}, {3, 4, 5}, {6, 1} }) {
+    for(const UInt radius : {1u, 2u, 5u, 8u}) {
+      for(const bool wrap : {false, true}) {
+        for(const bool skipCenter : {false, true}) {
+          const auto cached = Neighborhood::updateAllNeighbors(radius, dims, wrap, skipCenter);
+          const NeighborLists lists(radius, dims, wrap, skipCenter);
+          ASSERT_EQ(cached.size(), lists.size());
+          vector<CellIdx> hood;
+          for(CellIdx point = 0; point < lists.size(); point++) {
+            lists.neighbors(point, hood);
+            ASSERT_EQ(cached.at(point), hood) << "point " << point << " radius " << radius
+              << " wrap " << wrap << " skipCenter " << skipCenter;
+          }
+        }
+      }
+    }
+  }
+}
+
 } // namespace